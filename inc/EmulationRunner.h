@@ -46,10 +46,12 @@ class EmulationRunner
 
   private:
 
-    static uint32_t LoopTimer(Uint32 interval, void* param);
+    static void ClockTick(void);
+    static void setWindowTitle(bool bWarp);
     static bool convertKeyEvent(SDL_KeyboardEvent *ev);
     static void HandleUserEvents(SDL_Event* event);
     static void EmulatorWindowUpdate(void);
+    static void UploadLines(int yStart, int yEnd);
     static void _OpenWindow(void);
     static void _StartEmulatorThread(void);
     static int EmulatorThread(void *param);
@@ -61,7 +63,8 @@ class EmulationRunner
 
     static char m_window_title[256];
     static uint32_t m_counter;
-    static bool m_visible;
+    static std::atomic_bool m_visible;              // window is shown and not minimised
+    static std::atomic_bool m_bUpdatePending;       // screen update event is in the SDL queue
 
     static SDL_Window  *m_sdl_window;
     static SDL_Renderer *m_sdl_renderer;
@@ -71,7 +74,8 @@ class EmulationRunner
     static SDL_Thread *m_EmulatorThread;
     static bool m_EmulatorRunning;
 
-    static SDL_TimerID m_timer;
     static bool m_bQuitLoop;
-    static unsigned m_200HzCnt;
+    static bool m_bEndReported;
+    static unsigned m_vblCnt;
+    static unsigned m_lastUpdateCnt;                // m_vblCnt of the last screen update
 };
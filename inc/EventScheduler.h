@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Event scheduler of the emulator thread
+*
+*/
+
+#ifndef _EVENTSCHEDULER_H
+#define _EVENTSCHEDULER_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define SCHED_WHEEL_SLOTS       256         // number of timing wheel slots, power of two
+#define SCHED_SLOT_SHIFT        16          // slot granularity 2^16 ns, i.e. 65.5 us
+#define SCHED_POLL_INSNS        2000        // look at the clock at least after this many instructions
+#define SCHED_WARP_NS_PER_INSN  100         // warp mode: emulated time per instruction, i.e. 10 MIPS
+#define SCHED_CATCHUP_MAX       200         // late periods beyond this are dropped even in catch-up mode
+#define SCHED_NS_PER_SEC        1000000000ULL
+#define SCHED_TICK_BUCKETS      (1 + 24 * 4)    // logarithmic, four per power of two microseconds
+
+// called in the emulator thread, at an instruction boundary
+//  nLost:  number of periods that were dropped before this one
+typedef void (*SchedHandler)(void *param, unsigned nLost);
+
+struct SchedEvent
+{
+    SchedEvent *next;                   // wheel slot list
+    SchedEvent **pprev;                 // nullptr: not queued
+    uint64_t when;                      // emulated time in ns when the handler is called
+    uint64_t due;                       // regular time of the current period
+    uint64_t period;                    // 0: one-shot, may be changed by the handler
+    bool bCatchUp;                      // periodic: deliver late periods later, otherwise drop them
+    bool bDeferrable;                   // may be delayed while the emulated CPU is idle, see idle()
+    SchedHandler handler;
+    void *param;
+};
+
+struct SchedStats
+{
+    uint64_t polls;                     // calls from the 68k core
+    uint64_t fired;                     // handler calls
+    uint64_t caughtUp;                  // late periods delivered later
+    uint64_t lost;                      // late periods dropped
+    uint64_t lateMaxNs;                 // maximum delay of a handler call
+    uint64_t skippedNs;                 // warp mode: idle time skipped
+    uint64_t waits;                     // real time: idle waits, i.e. host wakeups of the emulator thread
+    uint64_t ticklessWaits;             // ... with deferrable events delayed
+    uint64_t hostNs;                    // host time since init()
+    uint64_t ticks;                     // handler calls of the tick event, see setTickEvent()
+    uint64_t tickP50Ns;                 // lateness against the regular period, upper bound of the histogram bucket
+    uint64_t tickP99Ns;
+    uint64_t tickMaxNs;
+};
+
+class CEventScheduler
+{
+  public:
+    static void init(void (*wakeup)(void));
+    static void setup(SchedEvent *ev, SchedHandler handler, void *param, bool bCatchUp = false, bool bDeferrable = false);
+    static void schedule(SchedEvent *ev, uint64_t delay, uint64_t period = 0);
+    static void cancel(SchedEvent *ev);
+    static bool isQueued(const SchedEvent *ev) { return ev->pprev != nullptr; }
+    static uint64_t now();
+    static uint64_t hostNow();
+    static void setWarp(bool bWarp);
+    static bool isWarp() { return m_bWarp; }
+    static void setTickless(unsigned maxMs);
+    static void setTickEvent(const SchedEvent *ev) { m_tickEvent = ev; }
+    static bool idle(uint64_t *pHostDeadline, bool bTickless);
+    static uint64_t nextHostDeadline();
+    static void postIrq(unsigned level);
+    static void postStop();
+    static void getStats(SchedStats *stats);
+    static void logStats();
+
+  private:
+    static void poll();
+    static void run(uint64_t t);
+    static void fire(SchedEvent *ev, uint64_t t);
+    static void enqueue(SchedEvent *ev);
+    static void dequeue(SchedEvent *ev);
+    static uint64_t nextDue();
+    static void setBudget(uint64_t t);
+    static unsigned tickBucket(uint64_t ns);
+    static uint64_t tickBucketEndNs(unsigned b);
+
+    static SchedEvent *m_wheel[SCHED_WHEEL_SLOTS];
+    static uint64_t m_cursor;           // slot number (time >> SCHED_SLOT_SHIFT) of the last run
+    static uint64_t m_nextDue;          // cache for nextDue()
+    static bool m_bNextDueValid;
+    static bool m_bWarp;
+    static int64_t m_offset;            // real time: emulated time - host time
+    static uint64_t m_warpBase;         // warp mode: emulated time at m_warpInsns
+    static uint64_t m_warpInsns;
+    static uint64_t m_ticklessNs;       // longest delay of deferrable events, 0: off
+    static uint64_t m_hostStart;
+    static std::atomic_uint m_postedIrqs;    // bit n: interrupt level n, bit 0: leave the 68k core
+    static void (*m_wakeup)(void);
+    static SchedStats m_stats;
+    static const SchedEvent *m_tickEvent;    // lateness recorded as histogram, e.g. 200 Hz
+    static uint64_t m_tickHist[SCHED_TICK_BUCKETS];
+};
+
+#endif
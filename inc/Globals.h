@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #ifdef __APPLE__
 #include "macos_endian.h"
 #else
@@ -34,10 +35,14 @@
 #endif
 
 
+#ifdef __cplusplus
 extern "C" {
+#endif
 // Musashi 68k emulator ('C')
 #include "m68k.h"
+#ifdef __cplusplus
 } // end extern "C"
+#endif
 
 
 // compile time switches
@@ -49,26 +54,43 @@ extern "C" {
 //#define _DEBUG_NO_ATARI_VBL_INTERRUPTS
 #endif
 
-// endian conversion helpers
+// endian conversion helpers, also for unaligned addresses
 
-#define getAtariBE16(addr) \
-    be16toh(*((uint16_t *) (addr)))
-#define getAtariBE32(addr) \
-    be32toh(*((uint32_t *) (addr)))
-#define setAtariBE16(addr, val) \
-    *((uint16_t *) (addr)) = htobe16(val);
-#define setAtariBE32(addr, val) \
-    *((uint32_t *) (addr)) = htobe32(val);
-#define setAtari32(addr, val) \
-    *((uint32_t *) (addr)) = val;
+static inline uint16_t getAtariBE16(const void *addr)
+{
+    uint16_t val;
+    memcpy(&val, addr, sizeof(val));
+    return be16toh(val);
+}
+static inline uint32_t getAtariBE32(const void *addr)
+{
+    uint32_t val;
+    memcpy(&val, addr, sizeof(val));
+    return be32toh(val);
+}
+static inline void setAtariBE16(void *addr, uint16_t val)
+{
+    val = htobe16(val);
+    memcpy(addr, &val, sizeof(val));
+}
+static inline void setAtariBE32(void *addr, uint32_t val)
+{
+    val = htobe32(val);
+    memcpy(addr, &val, sizeof(val));
+}
+static inline void setAtari32(void *addr, uint32_t val)
+{
+    memcpy(addr, &val, sizeof(val));
+}
 
 //
 // global variables and functions
 //
 
+#ifdef __cplusplus
 // -> MagiC.cpp
 void sendBusError(uint32_t addr, const char *AccessMode);
 void getActAtariPrg(const char **pName, uint32_t *pact_pd);
-void sendVBL(void);
+#endif
 
 #endif
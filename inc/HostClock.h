@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Clock thread for the host screen update
+*
+*/
+
+#ifndef _HOSTCLOCK_H
+#define _HOSTCLOCK_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "HostEvent.h"
+
+#define HOSTCLOCK_LATE_BUCKETS  8       // see getStats()
+
+// called in the clock thread for each tick
+typedef void (*HostClockTick)(void);
+
+struct HostClockStats
+{
+    uint64_t ticks;                     // ticks on time or late
+    uint64_t missed;                    // ticks that were due while the thread was not running, dropped
+    uint64_t lateSumNs;                 // sum of wakeup latencies
+    uint32_t lateMaxNs;                 // maximum wakeup latency
+    uint64_t late[HOSTCLOCK_LATE_BUCKETS];  // histogram, see lateBucketUs[]
+};
+
+class CHostClock
+{
+  public:
+    static int start(HostClockTick tick, unsigned hz);
+    static void stop();
+    static void getStats(HostClockStats *stats);
+    static void logStats();
+    static const unsigned lateBucketUs[HOSTCLOCK_LATE_BUCKETS];
+
+  private:
+    static void *_thread(void *param);
+    static void thread();
+    static uint64_t now();
+
+    static pthread_t m_thread;
+    static std::atomic_bool m_bRun;
+    static CHostEvent m_stopEvent;      // set by stop()
+    static HostClockTick m_tick;
+    static uint64_t m_periodNs;
+    static HostClockStats m_stats;
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Event flags, set by any thread, waited for by one thread
+*
+*/
+
+#ifndef _HOSTEVENT_H
+#define _HOSTEVENT_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+
+struct HostEventStats
+{
+    uint64_t waits;                     // calls of wait() that had to sleep
+    uint64_t wakeups;                   // ... and were woken up by set(), not by timeout
+    uint64_t wakeSumNs;                 // sum of the times from set() to the return of wait()
+    uint64_t wakeMaxNs;                 // maximum of these
+};
+
+class CHostEvent
+{
+  public:
+    CHostEvent();
+    ~CHostEvent();
+    void set(uint32_t flags);
+    uint32_t ask(uint32_t flags) const { return m_flags & flags; }
+    void clear() { m_flags = 0; }
+    uint32_t wait(uint64_t deadline = UINT64_MAX);
+    void getStats(HostEventStats *stats);
+    static uint64_t now();
+
+  private:
+    std::atomic<uint32_t> m_flags;      // futex word on Linux
+    std::atomic_bool m_bWaiting;        // the waiting thread may sleep
+    std::atomic<uint64_t> m_setNs;      // host time of the set() that woke it
+#if !defined(__linux__)
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+#endif
+    HostEventStats m_stats;
+};
+
+#endif
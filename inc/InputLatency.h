@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Latency of keyboard and mouse input, from the host event to the Atari
+*
+*/
+
+#ifndef _INPUTLATENCY_H
+#define _INPUTLATENCY_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define INPUTLAT_BUCKETS    (1 + 32 * 4)    // logarithmic, four per power of two microseconds
+
+enum
+{
+    INPUTLAT_KEY_TO_GUEST,              // host event until the Atari reads the byte
+    INPUTLAT_MOUSE_TO_GUEST,
+    INPUTLAT_TO_SCREEN,                 // host event until the next changed frame is presented
+    INPUTLAT_KINDS
+};
+
+struct InputLatencyStats
+{
+    uint64_t count;
+    uint64_t p50Ns;                     // upper bound of the histogram bucket
+    uint64_t p99Ns;
+    uint64_t maxNs;
+};
+
+class CInputLatency
+{
+  public:
+    static uint64_t now();
+    static void consumed(unsigned kind, uint64_t eventNs);
+    static uint64_t beginFrame();
+    static void endFrame(uint64_t eventNs, bool bPresented);
+    static bool isUnseen() { return m_unseenNs != 0; }
+    static void getStats(unsigned kind, InputLatencyStats *stats);
+    static void logStats();
+    static const char *kindName[INPUTLAT_KINDS];
+
+  private:
+    static void record(unsigned kind, uint64_t ns);
+    static unsigned bucket(uint64_t ns);
+    static uint64_t bucketEndNs(unsigned b);
+
+    static uint64_t m_hist[INPUTLAT_KINDS][INPUTLAT_BUCKETS];
+    static uint64_t m_count[INPUTLAT_KINDS];
+    static uint64_t m_maxNs[INPUTLAT_KINDS];
+    static std::atomic<uint64_t> m_unseenNs;    // oldest input read by the Atari, not yet on screen
+};
+
+#endif
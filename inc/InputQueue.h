@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Lock-free byte queue from one producer thread to one consumer thread
+*
+*/
+
+#ifndef _INPUTQUEUE_H
+#define _INPUTQUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define INPUTQUEUE_LEN      1024        // power of two, room for a burst of typed or pasted keys
+
+class CInputQueue
+{
+  public:
+    CInputQueue();
+    bool put(const uint8_t *data, unsigned len, uint64_t timeNs = 0);
+    bool get(uint8_t *pData, uint64_t *pTimeNs = nullptr);
+    bool isEmpty() const { return m_read == m_write; }
+    uint64_t getDropped() const { return m_dropped; }
+
+  private:
+    uint8_t m_buf[INPUTQUEUE_LEN];
+    uint64_t m_time[INPUTQUEUE_LEN];            // host time of the event, for the first byte of a packet
+    alignas(64) std::atomic<unsigned> m_write;  // only changed by the producer
+    alignas(64) std::atomic<unsigned> m_read;   // only changed by the consumer
+    std::atomic<uint64_t> m_dropped;            // bytes that did not fit
+};
+
+#endif
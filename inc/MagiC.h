@@ -25,6 +25,7 @@
 #include "config.h"
 // system header files
 #include <pthread.h>
+#include <atomic>
 // program header files
 #include "Globals.h"
 #include "osd_cpu.h"
@@ -33,8 +34,15 @@
 #include "MagiCKeyboard.h"
 #include "MagiCMouse.h"
 #include "MagiCScreen.h"
+#include "EventScheduler.h"
+#include "HostEvent.h"
+#include "InputQueue.h"
 
-#define KEYBOARDBUFLEN  32
+#define MOUSE_MOVE_SCALE    256         // relative mouse movement is accumulated in 1/256 pixels
+#define HZ200_PERIOD_NS (SCHED_NS_PER_SEC / 200)
+#define VBL_PERIOD_NS   (SCHED_NS_PER_SEC / 50)
+#define CPU_SLICE_NS    (SCHED_NS_PER_SEC / 100)    // CPU limit: measuring interval
+#define CPU_DEBT_MAX_NS (SCHED_NS_PER_SEC / 10)     // CPU limit: excess usage that is paid back at most
 
 // SDL user events, messages from emulator thread to GUI thread
 const int USEREVENT_RUN_EMULATOR_WINDOW_UPDATE = 1;
@@ -42,6 +50,16 @@ const int USEREVENT_OPEN_EMULATOR_WINDOW =2;
 const int USEREVENT_RUN_EMULATOR = 3;
 const int USEREVENT_POLL_MOUNT = 4;
 const int USEREVENT_POLL_JOYSTICK_STATE = 5;
+const int USEREVENT_EMULATOR_ENDED = 6;
+
+struct CpuStats
+{
+    unsigned limit;                     // percent of a host core, 0: off
+    unsigned usage;                     // recent usage in percent, moving average of eight measurements
+    unsigned avgUsage;                  // usage since the start of the emulator thread
+    uint64_t throttles;                 // sleeps to meet the limit
+    uint64_t throttledNs;               // ... and their total time
+};
 
 class CMagiC
 {
@@ -55,25 +73,27 @@ class CMagiC
     void startExec(void);           // ... let it run
     void stopExec(void);            // ... pause it
     void terminateThread(void);     // terminate it
+    static void requestDebugCore(int mode);     // production (0), debug (1) or toggle (-1)
+    void requestWarp(int mode);                 // real time (0), warp (1) or toggle (-1)
+    bool isWarp() { return m_bWarpRequested; }
 
-    int sendSdlKeyboard(int sdlScanCode, bool KeyUp);
+    int sendSdlKeyboard(int sdlScanCode, bool KeyUp, uint64_t eventNs = 0);
     void sendKbshift(uint8_t atari_kbshift);
     unsigned getKbshift();
     #if 0
     int SendKeyboardShift(uint32_t modifiers);
     #endif
-    int sendMousePosition(int x, int y);
-    int sendMouseMovement(double xrel, double yrel);
-    int sendMouseButton(unsigned int NumOfButton, bool bIsDown);
+    int sendMousePosition(int x, int y, uint64_t eventNs = 0);
+    int sendMouseMovement(double xrel, double yrel, uint64_t eventNs = 0);
+    int sendMouseButton(unsigned int NumOfButton, bool bIsDown, uint64_t eventNs = 0);
     int sendJoystickState(uint8_t header, uint8_t state0, uint8_t state1);
-    int sendHz200(void);
-    int sendVBL(void);
     void sendBusError(uint32_t addr, const char *AccessMode);
     //void SendAtariFile(const char *pBuf); // remnant from MagicMac(X) and AtariX
     bool sendDragAndDropFile(const char *allocated_path);
     void sendShutdown(void);
     //void ChangeXFSDrive(short drvNr);
     static void GetActAtariPrg(const char **pName, uint32_t *pact_pd);
+    void GetCpuStats(CpuStats *stats);
     bool m_bEmulatorIsRunning;
     bool m_bEmulatorHasEnded;
     bool m_bShutdown;
@@ -89,11 +109,19 @@ class CMagiC
     void initHostCallbacks(struct MacXSysHdr *pMacXSysHdr, CXCmd *pXCmd);
     static int relocate(FILE *f, uint32_t file_size, uint8_t *tbase, const ExeHeader *exehead);
     int LoadReloc(const char *path, uint32_t stackSize, int32_t  reladdr, BasePage **basePage);
-    int GetKbBufferFree(void);
-    void PutKeyToBuffer(uint8_t key);
+    void InputPending(void);
+    void MouseEvent(uint64_t eventNs);
     static void *_EmuThread(void *param);
+    static void sigDebugCore(int sig);
+    static void setDebugCore(bool bDebug);
     int EmuThread(void);
-    static int IRQCallback(int IRQLine);
+    static void IdleLoopCallback(unsigned pc, unsigned count);
+    static void Hz200Event(void *param, unsigned nLost);
+    static void VblEvent(void *param, unsigned nLost);
+    static void SchedulerWakeup(void);
+    static void CpuLimitEvent(void *param, unsigned nLost);
+    static uint64_t ThreadCpuNs(void);
+    void WaitForInterrupt(bool bTickless);
     static uint32_t AtariInit(uint32_t params, uint8_t *addrOffset68k);
     static uint32_t AtariBIOSInit(uint32_t params, uint8_t *addrOffset68k);
     static uint32_t AtariBconin(uint32_t params, uint8_t *addrOffset68k);
@@ -141,12 +169,10 @@ class CMagiC
     BasePage *m_BasePage;           // loaded MagiC Kernel
 
     pthread_t m_EmuTaskID;          // emulation thread
-    pthread_mutex_t m_EventMutex     = PTHREAD_MUTEX_INITIALIZER;
-    pthread_mutex_t m_ConditionMutex = PTHREAD_MUTEX_INITIALIZER;
-    pthread_cond_t m_Cond  = PTHREAD_COND_INITIALIZER;
-    void OS_SetEvent(uint32_t *event, uint32_t flags);
-    uint32_t OS_AskEvent(const uint32_t *event, uint32_t flags);
-    void OS_WaitForEvent(uint32_t *event, uint32_t *flags);
+    void OS_SetEvent(CHostEvent *event, uint32_t flags);
+    uint32_t OS_AskEvent(const CHostEvent *event, uint32_t flags);
+    void OS_WaitForEvent(CHostEvent *event, uint32_t *flags);
+    void OS_WaitForEventUntil(CHostEvent *event, uint32_t *flags, uint64_t deadline);
 
     CHostXFS m_HostXFS;              // XFS
     uint32_t m_CurrModifierKeys;     // current state of Shift/Cmd/Alt...
@@ -154,36 +180,42 @@ class CMagiC
     uint32_t m_BusErrorAddress;
     char m_BusErrorAccessMode[32];
 
-    bool m_bInterrupt200HzPending;
-    bool m_bInterruptVBLPending;
-    bool m_bInterruptMouseKeyboardPending;
-    int m_InterruptMouseWhereX;         // for absolute mouse mode
-    int m_InterruptMouseWhereY;         // for absolute mouse mode
-    double m_InterruptMouseMoveRelX;    // for relative mouse mode
-    double m_InterruptMouseMoveRelY;
-    bool m_bInterruptMouseButton[2];
-    bool m_bInterruptJoystickButtons;
-    bool m_bInterruptPending;
-    bool m_bWaitEmulatorForIRQCallback;
+    std::atomic_bool m_bInterruptMouseKeyboardPending;  // set by the event loop, 200 Hz and VBL see m68k_RaiseIrq()
+    unsigned m_Hz200Count;              // 200 Hz ticks since last leaving the 68k core
+    SchedEvent m_Hz200Event;            // see Hz200Event()
+    SchedEvent m_VblEvent;              // see VblEvent()
+    SchedEvent m_CpuLimitEvent;         // see CpuLimitEvent()
+    uint64_t m_CpuLastNs;               // thread CPU time at the last CpuLimitEvent()
+    uint64_t m_HostLastNs;              // ... and host time
+    uint64_t m_CpuStartNs;              // ... at the start of the emulator thread
+    uint64_t m_HostStartNs;
+    int64_t m_CpuDebtNs;                // CPU time used beyond the limit, negative: unused
+    CpuStats m_CpuStats;
+    std::atomic_bool m_bWarpRequested;  // time from instruction count, see CEventScheduler::setWarp()
+    std::atomic_uint m_InterruptMouseWhere;     // for absolute mouse mode, x in bits 16..31, y in 0..15
+    std::atomic_int m_InterruptMouseMoveX;      // for relative mouse mode, accumulated, see MOUSE_MOVE_SCALE
+    std::atomic_int m_InterruptMouseMoveY;
+    std::atomic_bool m_bInterruptMouseButton[2];
+    std::atomic<uint64_t> m_InputCoalesced;     // input events merged into a pending interrupt
+    std::atomic<uint64_t> m_MouseEventNs;       // host time of the oldest mouse event not yet read, see CInputLatency
 
     #define EMU_EVNT_RUN           0x00000001
     #define EMU_EVNT_TERM          0x00000002
-    uint32_t m_EventId;
+    CHostEvent m_EventId;
     bool m_bCanRun;
     #define EMU_INTPENDING_KBMOUSE 0x00000001
     #define EMU_INTPENDING_200HZ   0x00000002
     #define EMU_INTPENDING_VBL     0x00000004
     #define EMU_INTPENDING_OTHER   0x00000008
-    uint32_t m_InterruptEventsId;
+    CHostEvent m_InterruptEventsId;
 
     bool m_bSpecialExec;
     uint8_t *m_LineAVars;
 
-    // ring buffer for keyboard and mouse
-    uint8_t m_cKeyboardOrMouseData[KEYBOARDBUFLEN];
-    uint8_t *m_pKbRead;           // read pointer
-    uint8_t *m_pKbWrite;          // write pointer
-    pthread_mutex_t m_KbCriticalRegionId;   // mutex for keyboard events
+    // keyboard and joystick data from the GUI thread, mouse packet in the emulator thread
+    CInputQueue m_KbQueue;
+    int8_t m_MousePacket[3];
+    unsigned m_MousePacketPos;          // next byte to be read, 3: none
 
     // Screen data
     bool m_bScreenBufferChanged;
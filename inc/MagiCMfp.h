@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* MFP 68901 interrupt controller and timers
+*
+*/
+
+#ifndef _MAGICMFP_H
+#define _MAGICMFP_H
+
+#include <stdint.h>
+#include "EventScheduler.h"
+
+#define MFP_CLOCK_HZ        2457600     // timer clock
+#define MFP_MIN_PERIOD_NS   20000       // shortest emulated timer period, i.e. 50 kHz
+
+// interrupt channels, the higher the number the higher the priority
+#define MFP_INT_TIMER_D     4
+#define MFP_INT_TIMER_C     5
+#define MFP_INT_ACIA        6           // keyboard and MIDI
+#define MFP_INT_TIMER_B     8
+#define MFP_INT_TIMER_A     13
+
+// registers, offset to 0xfffffa00
+#define MFP_GPIP            0x01
+#define MFP_AER             0x03
+#define MFP_DDR             0x05
+#define MFP_IERA            0x07
+#define MFP_IERB            0x09
+#define MFP_IPRA            0x0b
+#define MFP_IPRB            0x0d
+#define MFP_ISRA            0x0f
+#define MFP_ISRB            0x11
+#define MFP_IMRA            0x13
+#define MFP_IMRB            0x15
+#define MFP_VR              0x17
+#define MFP_TACR            0x19
+#define MFP_TBCR            0x1b
+#define MFP_TCDCR           0x1d
+#define MFP_TADR            0x1f
+#define MFP_TBDR            0x21
+#define MFP_TCDR            0x23
+#define MFP_TDDR            0x25
+
+class CMagiCMfp
+{
+  public:
+    static void init();
+    static uint8_t read(unsigned reg);
+    static void write(unsigned reg, uint8_t val);
+    static void requestInterrupt(unsigned channel);
+    static unsigned ackInterrupt(void);
+
+  private:
+    static void setTimerMode(unsigned timer, unsigned mode);
+    static uint8_t getCount(unsigned timer);
+    static uint64_t ticksToNs(unsigned timer, unsigned ticks);
+    static void timerEvent(void *param, unsigned nLost);
+    static int nextChannel();
+    static void update();
+
+    static uint16_t m_ier;              // bit n: channel n, i.e. register A in bits 8..15
+    static uint16_t m_ipr;
+    static uint16_t m_isr;
+    static uint16_t m_imr;
+    static uint8_t m_gpip;
+    static uint8_t m_aer;
+    static uint8_t m_ddr;
+    static uint8_t m_vr;
+    static uint8_t m_ctrl[4];           // mode of timer A..D
+    static uint8_t m_data[4];           // reload value
+    static uint8_t m_count[4];          // counter of a stopped timer
+    static SchedEvent m_event[4];
+};
+
+#endif
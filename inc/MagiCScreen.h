@@ -26,16 +26,39 @@
 #define _MAGIC_SCREEN_H
 
 #include <SDL2/SDL.h>
+#include <atomic>
 #include "Atari.h"
+#include "emulation_globals.h"
+#include "ScreenConv.h"
 
 #define MAGIC_COLOR_TABLE_LEN 256
+#define MAGIC_DIRTY_LINES_MAX 2048      // ATARI_SCREEN_HEIGHT_MAX
+#define MAGIC_DIRTY_WORDS     (MAGIC_DIRTY_LINES_MAX / 64)
+#define MAGIC_DIRTY_GAP       16        // dirty line ranges with smaller gaps are merged
+
+struct ScreenUpdateStats
+{
+    uint64_t frames;                // screen updates with conversion and upload
+    uint64_t fullFrames;            // ... of which the whole screen was dirty
+    uint64_t bytesConverted;        // Atari surface bytes converted to host format
+    uint64_t bytesUploaded;         // host pixel bytes written to the texture
+    uint64_t bytesFull;             // bytes that whole screen updates would have uploaded
+    uint64_t uploads;               // texture updates, one per line range
+    uint64_t linesRemapped;         // lines only looked up in the index buffer, after a palette change
+};
 
 class CMagiCScreen
 {
   public:
     static int init();
     static void exit();
-    static void convAtari2HostSurface();
+    static void convAtari2Host(int yStart, int yEnd, uint8_t *dst, int dstPitch);
+    static void setAllDirty();
+    static void setPaletteDirty(unsigned index, unsigned count);
+    static unsigned takeDirtyLines();
+    static bool nextDirtyRange(int *pYStart, int *pYEnd);
+    static void countUpload(int yStart, int yEnd);
+    static void logStats();
     static void setColourPaletteEntry(unsigned index, uint16_t val);
     static uint16_t getColourPaletteEntry(unsigned index);
     static uint8_t getAtariScreenMode();
@@ -44,15 +67,71 @@ class CMagiCScreen
     static void *pixels;
     static unsigned pixels_size;
     static SDL_Surface *m_sdl_atari_surface;        // surface in Atari native pixel format or NULL
-    static SDL_Surface *m_sdl_host_surface;         // surface in host native pixel format
 
 	static uint32_t m_pColourTable[MAGIC_COLOR_TABLE_LEN];
     static uint32_t m_logAddr;      // logical 68k address of video memory
     static uint32_t m_physAddr;     // physical 68k address of video memory
     static uint16_t m_res;          // desired resolution, usually 0xffff
+    static ScreenUpdateStats m_stats;
+
+    /** **********************************************************************************************
+     *
+     * @brief Emulator thread: mark the screen lines of a video memory write as dirty
+     *
+     * @param[in] offset    offset in video memory, i.e. 68k address minus addr68kVideo
+     * @param[in] len       number of bytes written, not zero
+     *
+     * @note The bit is set before the "changed" flag, so that the GUI thread, which clears the flag
+     *       before it takes the bits, never loses a line. The flag is only written if a bit was new.
+     *
+     ************************************************************************************************/
+    static inline void setDirty(uint32_t offset, uint32_t len)
+    {
+        uint32_t line = offset / m_dirtyPitch;
+        uint32_t last = (offset + len - 1) / m_dirtyPitch;
+        if (last >= m_dirtyHeight)
+        {
+            if (line >= m_dirtyHeight)
+            {
+                return;     // invisible padding
+            }
+            last = m_dirtyHeight - 1;
+        }
+
+        bool bNew = false;
+        while (line <= last)
+        {
+            uint32_t wordLast = (last < (line | 63)) ? last : (line | 63);
+            uint64_t mask = (~0ULL >> (63 - (wordLast & 63))) & (~0ULL << (line & 63));
+            if ((m_dirtyLines[line >> 6].fetch_or(mask) & mask) != mask)
+            {
+                bNew = true;
+            }
+            line = wordLast + 1;
+        }
+        if (bNew)
+        {
+            atomic_store(&gbAtariVideoBufChanged, true);
+        }
+    }
 
   private:
     static void init_pixmap(uint16_t pixelType, uint16_t cmpCount, uint16_t cmpSize, uint32_t planeBytes);
+
+    static std::atomic<uint64_t> m_dirtyLines[MAGIC_DIRTY_WORDS];   // one bit per line, set by the emulator
+    static std::atomic_bool m_bAllDirty;                            // e.g. screen address changed
+    static std::atomic<uint64_t> m_paletteDirty[MAGIC_COLOR_TABLE_LEN / 64];   // one bit per changed colour
+    static uint64_t m_dirtyTaken[MAGIC_DIRTY_WORDS];                // lines of the current update
+    static uint64_t m_remapTaken[MAGIC_DIRTY_WORDS];                // ... with a changed colour only
+    static unsigned m_dirtyNext;                                    // next line to look at
+    static uint32_t m_dirtyPitch;                                   // bytes per line of the Atari surface
+    static unsigned m_dirtyHeight;                                  // number of lines
+    static uint64_t m_statsStartNs;
+    static ScreenConvFn m_convLines;                                // for the Atari pixel format, or NULL
+    static ScreenConvFn m_remapLines;                               // from m_index to host pixels
+    static unsigned m_paletteColours;                               // 0: direct colour, no palette
+    static uint8_t *m_index;                                        // colour index of each pixel, or NULL
+    static uint16_t m_lineColours[MAGIC_DIRTY_LINES_MAX];           // colours of each line in m_index
 };
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Conversion of Atari screen lines to host ARGB pixels
+*
+*/
+
+#ifndef _SCREENCONV_H
+#define _SCREENCONV_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "HostEvent.h"
+
+#define SCREENCONV_THREADS_MAX      16
+#define SCREENCONV_BAND_PIXELS      (256 * 1024)    // at least this many pixels per thread
+#define SCREENCONV_WIDTH_MAX        4096            // ATARI_SCREEN_WIDTH_MAX
+
+enum ScreenConvFormat
+{
+    SCREENCONV_MONO,            // 1 bit per pixel
+    SCREENCONV_IP2,             // 2 interleaved planes, 4 colours
+    SCREENCONV_PACKED4,         // 4 bits per pixel, packed
+    SCREENCONV_IP4,             // 4 interleaved planes, 16 colours
+    SCREENCONV_PACKED8,         // 8 bits per pixel, 256 colours
+    SCREENCONV_RGB555,          // 16 bits per pixel, big-endian
+    SCREENCONV_INDEX16,         // 8 bits per pixel, but only 16 colours, i.e. an index buffer
+    SCREENCONV_FORMATS
+};
+
+enum ScreenConvIsa
+{
+    SCREENCONV_SCALAR,
+    SCREENCONV_SSE2,
+    SCREENCONV_AVX2,
+    SCREENCONV_NEON,
+    SCREENCONV_ISAS
+};
+
+// convert <lines> lines of <width> pixels, <palette> is used for the indexed formats
+// The formats with up to 16 colours also store the colour index of each pixel to <index>, <width> bytes
+// per line, and the colours used by each line to <used>, one bit per colour. Both may be NULL.
+typedef void (*ScreenConvFn)(const uint8_t *src, unsigned srcPitch, uint8_t *dst, unsigned dstPitch,
+                             unsigned width, unsigned lines, const uint32_t *palette,
+                             uint8_t *index, uint16_t *used);
+
+class CScreenConv
+{
+  public:
+    static ScreenConvIsa bestIsa();
+    static ScreenConvFn get(ScreenConvFormat format, ScreenConvIsa isa);
+    static bool storesIndex(ScreenConvFormat format);
+    static const char *isaName[SCREENCONV_ISAS];
+};
+
+// persistent worker threads that convert horizontal bands of a screen
+class CScreenConvPool
+{
+  public:
+    static int init(unsigned threads);
+    static void exit();
+    static void convert(ScreenConvFn fn, const uint8_t *src, unsigned srcPitch, uint8_t *dst, unsigned dstPitch,
+                        unsigned width, unsigned lines, const uint32_t *palette,
+                        uint8_t *index = nullptr, uint16_t *used = nullptr);
+    static unsigned getThreads() { return m_threads; }
+
+  private:
+    static void *_thread(void *param);
+    static void convertBand(unsigned band);
+
+    static unsigned m_threads;                          // including the calling thread
+    static pthread_t m_thread[SCREENCONV_THREADS_MAX];
+    static CHostEvent m_start[SCREENCONV_THREADS_MAX];  // per worker: a band is ready, or stop
+    static CHostEvent m_done;                           // a worker has finished its band
+    static std::atomic_bool m_bandDone[SCREENCONV_THREADS_MAX];
+    static std::atomic_bool m_bRun;
+
+    // current job
+    static ScreenConvFn m_fn;
+    static const uint8_t *m_src;
+    static unsigned m_srcPitch;
+    static uint8_t *m_dst;
+    static unsigned m_dstPitch;
+    static unsigned m_width;
+    static const uint32_t *m_palette;
+    static uint8_t *m_index;
+    static uint16_t *m_used;
+    static unsigned m_bandStart[SCREENCONV_THREADS_MAX + 1];   // relative to the first line
+};
+
+#endif
@@ -32,15 +32,35 @@ extern const char *exception68k_to_name(uint32_t addr);
 
 /*
 * debugging stuff
+*
+* The debug core of the 68k emulator checks breakpoints and write watches
+* and records a trace. It can be switched on and off at runtime, see
+* CMagiC::requestDebugCore(). These are the table sizes. Defining one of
+* them here starts the emulator with the debug core.
 */
 
 #ifndef NDEBUG
 //#define M68K_BREAKPOINTS   4            // for debugging 68k code
 //#define M68K_WRITE_WATCHES 3            // for debugging 68k code
 // #define M68K_TRACE  256
+#endif
+
+#if defined(M68K_BREAKPOINTS) || defined(M68K_WRITE_WATCHES) || defined(M68K_TRACE)
+#define M68K_DEBUG_CORE_AT_START
+#endif
+#ifndef M68K_BREAKPOINTS
+#define M68K_BREAKPOINTS   4
+#endif
+#ifndef M68K_WRITE_WATCHES
+#define M68K_WRITE_WATCHES 3
+#endif
+#ifndef M68K_TRACE
+#define M68K_TRACE  256
+#endif
 
-#if defined(M68K_TRACE)
 extern uint32_t m68k_trace[M68K_TRACE][3];
+extern uint32_t m68k_breakpoints[M68K_BREAKPOINTS][2];      //  68k start and end address, unused if end is 0
+extern uint32_t m68k_write_watches[M68K_WRITE_WATCHES];     //  68k address, unused if 0
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -48,16 +68,8 @@ extern void m68k_trace_print();
 #if defined(__cplusplus)
 }
 #endif
-#endif
-
-#if defined(M68K_BREAKPOINTS)
-extern uint32_t m68k_breakpoints[M68K_BREAKPOINTS][2];      //  68k address and range, usually 0
-#endif
-
-#if defined(M68K_WRITE_WATCHES)
-extern uint32_t m68k_write_watches[M68K_WRITE_WATCHES];
-#endif
 
+#ifndef NDEBUG
 extern int do_not_interrupt_68k;        // for debugging
 
 #if defined(__cplusplus)
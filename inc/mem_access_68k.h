@@ -21,3 +21,11 @@
 * User provided memory access functions for the 68k emulator
 *
 */
+
+#ifndef _MEM_ACCESS_68K_H
+#define _MEM_ACCESS_68K_H
+
+void initPageTable68k();
+void setDebugMem68k(bool bDebug);
+
+#endif
@@ -0,0 +1,9 @@
+/*
+ * NatFeat to switch the 68k emulator between production and debug core
+ *
+ * GPL
+ */
+
+#include "nf_base.h"
+
+extern NF_Base const nf_debugcore;
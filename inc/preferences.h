@@ -36,6 +36,7 @@
 #define ATARI_SCREEN_WIDTH_MAX      4096
 #define ATARI_SCREEN_HEIGHT_MIN     200
 #define ATARI_SCREEN_HEIGHT_MAX     2048
+#define ATARI_SCREEN_CONV_THREADS_MAX 16
 
 #define ATARI_RAM_SIZE_MIN          (800*1024)          // 800 KiB ..
 #define ATARI_RAM_SIZE_MAX          (2U*1024*1024*1024)  // .. 2 GiB
@@ -88,6 +89,7 @@ class Preferences
                     int width_override, int height_override,
                     int stretch_x_override, int stretch_y_override, bool double_vert,
                     int relative_mouse_override,
+                    int jit_override,
                     int memsize_override,
                     const char *rootfs_override,
                     const char *kernel_override,
@@ -104,6 +106,11 @@ class Preferences
     static bool bHideHostMouse;
     static bool bRelativeMouse;
     static bool bAutoStartMagiC;
+    static bool bJit;                               // translate 68k code to host code
+    static unsigned AtariFpu;                       // 0: none (default), 1: fast, 2: exact 68882 emulation
+    static bool bClockCatchUp;                      // late 200 Hz ticks: deliver later (true) or correct _hz_200
+    static unsigned TicklessIdleMs;                 // idle Atari without 200 Hz and VBL up to this time, 0: off
+    static unsigned CpuLimit;                       // host CPU usage of the emulator thread in percent, 0: off
 	static char AtariKernelPath[1024];              // "MAGICLIN.OS" file
 	static char AtariRootfsPath[PATH_MAX];          // Atari C:
     static bool AtariHostHome;                      // Atari H: is home
@@ -121,11 +128,14 @@ class Preferences
     static unsigned AtariScreenHeight;              // 200..2048
     static unsigned AtariScreenStretchX;            // horizontal stretch
     static unsigned AtariScreenStretchY;            // vertical stretch
-    static unsigned ScreenRefreshFrequency;
+    static unsigned ScreenRefreshFrequency;         // maximum host screen update rate in Hz
+    static unsigned ScreenConvThreads;              // threads for the screen conversion, 0: automatic
+    static bool bScreenVsync;                       // present synchronised to the display refresh
     //static bool m_bPPC_VDI_Patch;                 // used for native VDI output on PPC
     static struct ethernet_options eth[MAX_ETH];
     static const char *AtariStartApplications[MAX_START_APPS];
     static const char *mountDriveParameter;
+    static bool bWarp;                              // start in warp mode, command line only
 
     static const char *drvPath[NDRIVES];
     static unsigned drvFlags[NDRIVES];              // see above (read-only, ...)
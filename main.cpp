@@ -48,7 +48,9 @@ static void print_opt(const struct option *options)
         "kernel-file",
         "program",
         "atari_txtfile",
-        "host_txtfile"
+        "host_txtfile",
+        nullptr,
+        nullptr
     };
 
     const char *descriptions[] =
@@ -67,7 +69,9 @@ static void print_opt(const struct option *options)
         "       location of kernel file (MAGICLIN.OS)",
         "           choose editor program for -e option, to override xdg-open",
         "  convert text file from Atari to host format",
-        "   convert text file from host to Atari format"
+        "   convert text file from host to Atari format",
+        "                   run 68k code in interpreter only, overrides config file",
+        "                     start in warp mode, toggle with Ctrl-Alt-F12"
     };
 
     puts("Usage: magic-on-linux {options} [atari-programs ..]");
@@ -465,6 +469,8 @@ int main(int argc, char * const argv[])
     bool bRunEditor = false;
     bool bWriteConf = false;
     int relativeMouse = -1;     // -1: default
+    int jit = -1;               // -1: default
+    bool bWarp = false;
 
     /*
     * loop over all arguments
@@ -492,6 +498,8 @@ int main(int argc, char * const argv[])
             {"editor",            required_argument, nullptr,  0 },      // long_option_index 12
             {"tconv-a2h",         required_argument, nullptr,  0 },      // long_option_index 13
             {"tconv-h2a",         required_argument, nullptr,  0 },      // long_option_index 14
+            {"no-jit",            no_argument,       nullptr,  0 },      // long_option_index 15
+            {"warp",              no_argument,       nullptr,  0 },      // long_option_index 16
             {nullptr,             0,                 nullptr,  0 }
         };
         c = getopt_long(argc, argv, "hc:ewa:g:s:m:l:r:k:",
@@ -533,6 +541,16 @@ int main(int argc, char * const argv[])
                 {
                     file_h2a = optarg;
                 }
+                else
+                if (long_option_index == 15)
+                {
+                    jit = 0;
+                }
+                else
+                if (long_option_index == 16)
+                {
+                    bWarp = true;
+                }
                 break;
 
             case 'h':
@@ -686,7 +704,7 @@ int main(int argc, char * const argv[])
             printf("Just writing default values, additional options ignored!\n");
         }
         // just write defaults and ignore all other settings
-        Preferences::init(config, -1, -1, -1, -1, -1, false, -1, -1, nullptr, nullptr, true);
+        Preferences::init(config, -1, -1, -1, -1, -1, false, -1, -1, -1, nullptr, nullptr, true);
         return 0;
     }
 
@@ -729,11 +747,12 @@ int main(int argc, char * const argv[])
     //DebugInit("/tmp/magic-on-linux.log");
     if (Preferences::init(config,
                          colour_mode, width, height, stretch_x, stretch_y, double_vert,
-                         relativeMouse, atari_memsize,
+                         relativeMouse, jit, atari_memsize,
                          arg_rootfs, arg_kernel, false))
     {
         fputs("There were syntax errors in configuration file\n", stderr);
     }
+    Preferences::bWarp = bWarp;
 
     // We must get the preferences first to know the location of the Atari root file system.
     // Also we can set localisation from config file.
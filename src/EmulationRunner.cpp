@@ -28,6 +28,9 @@
 #include "Debug.h"
 #include "Clipboard.h"        // MagiC clipboad handling
 #include "gui.h"
+#include "HostClock.h"
+#include "EventScheduler.h"
+#include "InputLatency.h"
 #include "EmulationRunner.h"
 #include "emulation_globals.h"
 
@@ -62,7 +65,8 @@ double EmulationRunner::m_hostScreenStretchY;
 
 char EmulationRunner::m_window_title[256];
 uint32_t EmulationRunner::m_counter;
-bool EmulationRunner::m_visible;
+std::atomic_bool EmulationRunner::m_visible;
+std::atomic_bool EmulationRunner::m_bUpdatePending;
 
 SDL_Window  *EmulationRunner::m_sdl_window;
 SDL_Renderer *EmulationRunner::m_sdl_renderer;
@@ -72,9 +76,14 @@ CMagiC EmulationRunner::m_Emulator;
 SDL_Thread *EmulationRunner::m_EmulatorThread = nullptr;
 bool EmulationRunner::m_EmulatorRunning = false;
 
-SDL_TimerID EmulationRunner::m_timer;
 bool EmulationRunner::m_bQuitLoop = false;
-unsigned EmulationRunner::m_200HzCnt = 0;
+bool EmulationRunner::m_bEndReported = false;
+unsigned EmulationRunner::m_vblCnt = 0;
+unsigned EmulationRunner::m_lastUpdateCnt = 0;
+
+#define SCREEN_WARP_HZ      10      // screen update rate in warp mode
+#define SCREEN_IDLE_HZ      20      // screen update rate when the screen was static for a while
+#define SCREEN_IDLE_MS      500     // ... i.e. without any update for this time
 
 
 /** **********************************************************************************************
@@ -208,41 +217,50 @@ int EmulationRunner::OpenWindow(void)
 
 /** **********************************************************************************************
  *
- * @brief Helper function to redraw an SDL texture from a rectangle of an SDL surface
+ * @brief Convert lines of the Atari screen directly into the streaming texture
  *
- * @param[in]  txtu         SDL texture
- * @param[in]  srf          SDL surface
- * @param[in]  rect         rectangle, might be nullptr to update whole texture
+ * @param[in]  yStart       first line
+ * @param[in]  yEnd         line after the last one
  *
  * @note The drawing process to the screen is done later, by SDL_RenderCopy().
  *
  ************************************************************************************************/
-static void UpdateTextureFromRect(SDL_Texture *txtu, const SDL_Surface *srf, const SDL_Rect *rect)
+void EmulationRunner::UploadLines(int yStart, int yEnd)
 {
-    const uint8_t *pixels = (const uint8_t *) srf->pixels;
-    if (rect)
-    {
-        pixels += rect->y * srf->pitch;
-        pixels += rect->x * srf->format->BytesPerPixel;
-    }
-    int r = SDL_UpdateTexture(txtu, rect, pixels, srf->pitch);
-    if (r == -1)
+    SDL_Rect r = { 0, yStart, (int) Preferences::AtariScreenWidth, yEnd - yStart };
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(m_sdl_texture, &r, &pixels, &pitch) != 0)
     {
         DebugError2("() - SDL error %s", SDL_GetError());
+        return;
     }
+    CMagiCScreen::convAtari2Host(yStart, yEnd, (uint8_t *) pixels, pitch);
+    SDL_UnlockTexture(m_sdl_texture);
+    CMagiCScreen::countUpload(yStart, yEnd);
 }
 
 
 /** **********************************************************************************************
  *
- * @brief Create 200 Hz SDL timer and start the 68k emulation thread
+ * @brief Start the screen update clock thread and the 68k emulation thread
  *
  * @note The 68k emulator thread will be started indirectly, via a short-life helper thread.
  *
  ************************************************************************************************/
 void EmulationRunner::_StartEmulatorThread(void)
 {
-    m_timer = SDL_AddTimer(5 /* 5 milliseconds, 200 Hz */, LoopTimer, nullptr);
+    // the clock runs with the maximum update rate, but not faster than the display with vsync
+    unsigned hz = Preferences::ScreenRefreshFrequency;
+    SDL_DisplayMode mode;
+    if ((Preferences::bScreenVsync) && (m_sdl_window != nullptr) &&
+        (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(m_sdl_window), &mode) == 0) &&
+        (mode.refresh_rate > 0) && ((unsigned) mode.refresh_rate < hz))
+    {
+        hz = (unsigned) mode.refresh_rate;
+    }
+    DebugInfo2("() : Screen update with up to %u Hz%s", hz, Preferences::bScreenVsync ? ", vsync" : "");
+    (void) CHostClock::start(ClockTick, hz);
     // create a short-life helper thread that will later start the CMagiC
     // thread. TODO: Why?
     m_EmulatorThread = SDL_CreateThread(EmulatorThread, "EmulatorThread", nullptr);
@@ -270,9 +288,7 @@ void EmulationRunner::_StartEmulatorThread(void)
  ************************************************************************************************/
 void EmulationRunner::_OpenWindow(void)
 {
-    sprintf(m_window_title, PROGRAM_NAME " (%ux%ux%s)",
-                            Preferences::AtariScreenWidth, Preferences::AtariScreenHeight,
-                            Preferences::videoModeToShortString(Preferences::atariScreenColourMode));
+    setWindowTitle(Preferences::bWarp);
     m_visible = false;
 
     // get initial screen size
@@ -298,7 +314,13 @@ void EmulationRunner::_OpenWindow(void)
                                     SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
     assert(m_sdl_window);
 
-    m_sdl_renderer = SDL_CreateRenderer(m_sdl_window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 flags = SDL_RENDERER_ACCELERATED;
+    if (Preferences::bScreenVsync)
+    {
+        // SDL_RenderPresent() waits for the display refresh, no tearing
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    m_sdl_renderer = SDL_CreateRenderer(m_sdl_window, -1, flags);
     assert(m_sdl_renderer);
     if (m_sdl_renderer == nullptr)
     {
@@ -306,15 +328,33 @@ void EmulationRunner::_OpenWindow(void)
         return;     // fatal
     }
 
-    // initially fill whole window with white colour
-    (void) SDL_FillRect(CMagiCScreen::m_sdl_host_surface, NULL, 0x00ffffff);
-    m_sdl_texture = SDL_CreateTextureFromSurface(m_sdl_renderer, CMagiCScreen::m_sdl_host_surface);    // seems not to work with non-native format?!?
+    // The Atari screen is converted directly into the texture memory, see UploadLines()
+    m_sdl_texture = SDL_CreateTexture(m_sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                      Preferences::AtariScreenWidth, Preferences::AtariScreenHeight);
     assert(m_sdl_texture);
     if (m_sdl_texture == nullptr)
     {
         DebugError2("() : SDL error %s", SDL_GetError());
         return;     // fatal
     }
+    // we do not deal with the alpha channel, otherwise we always must make sure that each pixel is 0xff******
+    SDL_SetTextureBlendMode(m_sdl_texture, SDL_BLENDMODE_NONE);
+
+    // initially fill whole window with white colour
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(m_sdl_texture, nullptr, &pixels, &pitch) == 0)
+    {
+        for (unsigned y = 0; y < Preferences::AtariScreenHeight; y++)
+        {
+            uint32_t *p32 = (uint32_t *) ((uint8_t *) pixels + y * pitch);
+            for (unsigned x = 0; x < Preferences::AtariScreenWidth; x++)
+            {
+                p32[x] = 0x00ffffff;
+            }
+        }
+        SDL_UnlockTexture(m_sdl_texture);
+    }
 
 #if 0
     /*
@@ -350,36 +390,70 @@ void EmulationRunner::_OpenWindow(void)
 
 /** **********************************************************************************************
  *
- * @brief Timer function for simulated Atari and for screen update to host
+ * @brief Show the Atari screen mode and, if active, warp mode in the window title
  *
- * @param[in]  interval     timer interval in milliseconds, here 5 for 200 Hz
- * @param[in]  param        user data, here points to EmulationRunner object
+ * @param[in]  bWarp        emulator runs in warp mode
  *
- * @return the next interval
+ ************************************************************************************************/
+void EmulationRunner::setWindowTitle(bool bWarp)
+{
+    sprintf(m_window_title, PROGRAM_NAME " (%ux%ux%s)%s",
+                            Preferences::AtariScreenWidth, Preferences::AtariScreenHeight,
+                            Preferences::videoModeToShortString(Preferences::atariScreenColourMode),
+                            bWarp ? " - warp" : "");
+    if (m_sdl_window != nullptr)
+    {
+        SDL_SetWindowTitle(m_sdl_window, m_window_title);
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Clock tick for screen update to host, with Preferences::ScreenRefreshFrequency
  *
- * @note Triggers 200 Hz timer for simulated Atari
- * @note Triggers VBL timer for simulated Atari with 50 Hz
- * @note Triggers host screen update with 25 Hz, if <gbAtariVideoBufChanged>  is set
+ * @note Triggers host screen update, if <gbAtariVideoBufChanged> is set. The rate adapts:
+ *       Every tick while the Atari keeps drawing, SCREEN_IDLE_HZ for the first change
+ *       after a static screen, and SCREEN_WARP_HZ in warp mode.
+ *       Input that the Atari has read is shown with the next tick, regardless.
+ * @note Nothing is done while the window is hidden or minimised, or while the previous
+ *       update has not been handled by the event loop yet.
+ * @note 200 Hz and VBL of the simulated Atari are raised by the emulator thread itself,
+ *       see CEventScheduler
+ * @note Called in the clock thread, see CHostClock, must not block
  *
  ************************************************************************************************/
-uint32_t EmulationRunner::LoopTimer(Uint32 interval, void *param)
+void EmulationRunner::ClockTick(void)
 {
     // too often DebugInfo("%s()", __func__);
-    EmulationRunner *p = (EmulationRunner *) param;
 
-    if (p->m_EmulatorRunning)
+    if (m_EmulatorRunning)
     {
-        p->m_Emulator.sendHz200();
-        p->m_200HzCnt++;
-        if ((p->m_200HzCnt % 4) == 0)
+        unsigned hz = Preferences::ScreenRefreshFrequency;
+        m_vblCnt++;
+
+        // ticks per screen update
+        unsigned divider = 1;
+        if (m_Emulator.isWarp())
+        {
+            // leave the host CPU to the warping emulator
+            divider = hz / SCREEN_WARP_HZ;
+        }
+        else
+        if ((m_vblCnt - m_lastUpdateCnt > hz * SCREEN_IDLE_MS / 1000) && !CInputLatency::isUnseen())
+        {
+            // static screen, collect the first changes for a moment
+            divider = hz / SCREEN_IDLE_HZ;
+        }
+        if (divider == 0)
         {
-            // VBL interrupt runs with 50 Hz
-            p->m_Emulator.sendVBL();
+            divider = 1;
         }
 
-        if (((p->m_200HzCnt % 8) == 0) && (gbAtariVideoBufChanged))
+        if (((m_vblCnt % divider) == 0) && (gbAtariVideoBufChanged) && (m_visible) && !m_bUpdatePending)
         {
-            // screen update runs with 25 Hz
+            m_lastUpdateCnt = m_vblCnt;
+            m_bUpdatePending = true;
 
             // Create a user event to call the application loop.
             SDL_Event event;
@@ -393,24 +467,35 @@ uint32_t EmulationRunner::LoopTimer(Uint32 interval, void *param)
         }
     }
 
-    if ((p->m_Emulator.m_bEmulatorHasEnded) && !p->m_bQuitLoop)
+    if ((m_Emulator.m_bEmulatorHasEnded) && !m_bEndReported)
     {
-        (void) showAlert("The virtual machine has ended", "The application window will be closed");
-        p->m_bQuitLoop = true;
-    }
+        // the alert box is opened by the event loop
+        m_bEndReported = true;
 
-    return interval;
+        SDL_Event event;
+
+        event.type = SDL_USEREVENT;
+        event.user.code = USEREVENT_EMULATOR_ENDED;
+        event.user.data1 = 0;
+        event.user.data2 = 0;
+
+        SDL_PushEvent(&event);
+    }
 }
 
 
 /** **********************************************************************************************
  *
- * @brief Cleanup, removes SDL timer and quits SDL
+ * @brief Cleanup, stops the clock thread and quits SDL
  *
  ************************************************************************************************/
 void EmulationRunner::Cleanup(void)
 {
-    (void) SDL_RemoveTimer(m_timer);
+    CHostClock::stop();
+    CHostClock::logStats();
+    CEventScheduler::logStats();
+    CInputLatency::logStats();
+    CMagiCScreen::logStats();
     SDL_Quit();
 }
 
@@ -472,6 +557,20 @@ bool EmulationRunner::convertKeyEvent(SDL_KeyboardEvent *ev)
         return true;   // continue processing with the changed scancode
     }
 
+    //
+    // Ctrl-Alt-F12 toggles warp mode, not passed to the emulated system
+    //
+
+    if ((ev->keysym.scancode == SDL_SCANCODE_F12) &&  (kbshift_masked == KBSHIFT_CTRL + KBSHIFT_ALT))
+    {
+        if ((ev->type == SDL_KEYDOWN) && !ev->repeat)
+        {
+            m_Emulator.requestWarp(-1);
+            setWindowTitle(m_Emulator.isWarp());
+        }
+        return false;   // no further handling
+    }
+
     //
     // Alt-Cursor for mouse move emulation in absolute mode
     // Note that the key-release event is ignored here.
@@ -529,6 +628,13 @@ void EmulationRunner::EventLoop(void)
 
     while((!m_bQuitLoop) && (SDL_WaitEvent(&event)))
     {
+        // host time of the event, including the time it spent in the SDL queue (ms resolution)
+        uint64_t eventNs = CInputLatency::now();
+        uint32_t queuedMs = SDL_GetTicks() - event.common.timestamp;
+        if (queuedMs < 1000)
+        {
+            eventNs -= (uint64_t) queuedMs * 1000000;
+        }
 
 #ifndef NDEBUG
         while(do_not_interrupt_68k)
@@ -551,7 +657,17 @@ void EmulationRunner::EventLoop(void)
                     switch(ev->event)
                     {
                         case SDL_WINDOWEVENT_SHOWN:
+                        case SDL_WINDOWEVENT_EXPOSED:
+                        case SDL_WINDOWEVENT_RESTORED:
+                            // the dirty lines have been collected meanwhile, present them
                             m_visible = true;
+                            gbAtariVideoBufChanged = true;
+                            break;
+
+                        case SDL_WINDOWEVENT_HIDDEN:
+                        case SDL_WINDOWEVENT_MINIMIZED:
+                            // no screen updates until visible again
+                            m_visible = false;
                             break;
 
                         case SDL_WINDOWEVENT_FOCUS_GAINED:
@@ -637,7 +753,7 @@ void EmulationRunner::EventLoop(void)
 
                     if (convertKeyEvent(ev))
                     {
-                        (void) m_Emulator.sendSdlKeyboard(ev->keysym.scancode, ev->type == SDL_KEYUP);
+                        (void) m_Emulator.sendSdlKeyboard(ev->keysym.scancode, ev->type == SDL_KEYUP, eventNs);
                     }
                 }
                 break;
@@ -651,7 +767,7 @@ void EmulationRunner::EventLoop(void)
                     {
                         double xrel = (double) (ev->xrel) / m_hostScreenStretchX;
                         double yrel = (double) (ev->yrel) / m_hostScreenStretchY;
-                        m_Emulator.sendMouseMovement(xrel, yrel);
+                        m_Emulator.sendMouseMovement(xrel, yrel, eventNs);
                     }
                     else
                     {
@@ -659,7 +775,7 @@ void EmulationRunner::EventLoop(void)
                         double yd = (double) (ev->y) / m_hostScreenStretchY;
                         int x = (int) (xd + 0.5);   // rounding
                         int y = (int) (yd + 0.5);
-                        m_Emulator.sendMousePosition(x, y);
+                        m_Emulator.sendMousePosition(x, y, eventNs);
                     }
                 }
                 break;
@@ -679,7 +795,7 @@ void EmulationRunner::EventLoop(void)
                     if (atariMouseButton >= 0)
                     {
                         // left button is 0, right button is 1
-                        m_Emulator.sendMouseButton(atariMouseButton, ev->type == SDL_MOUSEBUTTONDOWN);
+                        m_Emulator.sendMouseButton(atariMouseButton, ev->type == SDL_MOUSEBUTTONDOWN, eventNs);
                     }
                 }
                 break;
@@ -816,6 +932,11 @@ void EmulationRunner::HandleUserEvents(SDL_Event* event)
             break;
         }
 
+        case USEREVENT_EMULATOR_ENDED:
+            (void) showAlert("The virtual machine has ended", "The application window will be closed");
+            m_bQuitLoop = true;
+            break;
+
         default:
             DebugWarning2("() - unhandled SDL user event %u", event->user.code);
             break;
@@ -828,13 +949,10 @@ void EmulationRunner::HandleUserEvents(SDL_Event* event)
  * @brief SDL event loop: Special user event to update the emulation window
  *
  * @note Only called from HandleUserEvents()
- * @note If the Atari graphics format differs from host format, i.e. is not 32-bit RGB,
- *       we have m_sdl_atari_surface. The emulated Atari will then change this surface
- *       directly, via writing data to surface->pixels,
- *       and we convert m_sdl_atari_surface to m_sdl_surface. The m_sdl_surface is then
- *       drawn to texture and this one will be drawn to screen.
- *       If the Atari graphics format is the same as host, the emulated Atari directly
- *       writes to m_sdl_surface.
+ * @note The emulated Atari writes to m_sdl_atari_surface, in its own pixel format.
+ *       The dirty lines are converted directly into the streaming texture, see UploadLines(),
+ *       and the texture is drawn to screen.
+ * @note Does nothing while the window is not visible, the dirty lines are kept until then.
  *
  ************************************************************************************************/
 void EmulationRunner::EmulatorWindowUpdate(void)
@@ -845,23 +963,36 @@ void EmulationRunner::EmulatorWindowUpdate(void)
     SDL_Rect rc = { 0, 0, (int) m_hostScreenW, (int) m_hostScreenH };        // dst
     SDL_Rect rc2 = { 0, 0, (int) Preferences::AtariScreenWidth, (int) Preferences::AtariScreenHeight };    // src
 
+    // the clock may push the next update from now on
+    m_bUpdatePending = false;
+    if (!m_visible)
+    {
+        // keep the dirty lines for later
+        return;
+    }
+
+    // input that the Atari had read before this frame
+    uint64_t inputNs = CInputLatency::beginFrame();
+    bool bPresented = false;
+
     if (atomic_exchange(&gbAtariVideoBufChanged, false))
     {
         // too often DebugInfo2("() - Atari Screen dirty");
-        if (CMagiCScreen::m_sdl_atari_surface != CMagiCScreen::m_sdl_host_surface)
+        // only convert and upload the lines the Atari has written to
+        (void) CMagiCScreen::takeDirtyLines();
+        int yStart, yEnd;
+        while (CMagiCScreen::nextDirtyRange(&yStart, &yEnd))
         {
-            // convert Atari graphics format to host graphics format RGB
-            CMagiCScreen::convAtari2HostSurface();
+            // convert Atari graphics format to host graphics format RGB, directly into the texture
+            UploadLines(yStart, yEnd);
         }
 
-        UpdateTextureFromRect(m_sdl_texture, CMagiCScreen::m_sdl_host_surface, nullptr);
-
-        if (m_visible)
-        {
-            (void) SDL_RenderCopy(m_sdl_renderer, m_sdl_texture, &rc2, &rc);
-            SDL_RenderPresent(m_sdl_renderer);
-        }
+        (void) SDL_RenderCopy(m_sdl_renderer, m_sdl_texture, &rc2, &rc);
+        SDL_RenderPresent(m_sdl_renderer);
+        bPresented = true;
     }
+
+    CInputLatency::endFrame(inputNs, bPresented);
 }
 
 
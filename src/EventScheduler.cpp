@@ -0,0 +1,710 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Event scheduler of the emulator thread
+*
+* Timed events (200 Hz, VBL, MFP timers) are kept in a hashed timing wheel
+* and run by the emulator thread itself, at an instruction boundary, when
+* the 68k core has executed the instruction budget set by the scheduler, see
+* m68k_SetEventBudget(). So there is no other thread that stops the 68k core.
+*
+* The emulated time follows the host clock in real time mode. In warp mode it
+* is derived from the number of executed instructions, and idle phases are
+* skipped up to the next event. The time is continuous across mode changes.
+*
+* Tickless idle: while the guest waits for events, deferrable events (200 Hz,
+* VBL) may be delayed up to a maximum, so that an idle emulator sleeps with
+* few host wakeups. Afterwards they are late and are caught up or dropped,
+* as for any late event.
+*
+* All functions except postIrq() and postStop() must be called from the
+* emulator thread.
+*
+*/
+
+#include "config.h"
+// system headers
+#include <string.h>
+#include <time.h>
+// program headers
+#include "Debug.h"
+#include "Globals.h"
+#include "EventScheduler.h"
+
+#define SCHED_SLOT_MASK         (SCHED_WHEEL_SLOTS - 1)
+
+SchedEvent *CEventScheduler::m_wheel[SCHED_WHEEL_SLOTS];
+uint64_t CEventScheduler::m_cursor;
+uint64_t CEventScheduler::m_nextDue;
+bool CEventScheduler::m_bNextDueValid;
+bool CEventScheduler::m_bWarp;
+int64_t CEventScheduler::m_offset;
+uint64_t CEventScheduler::m_warpBase;
+uint64_t CEventScheduler::m_warpInsns;
+uint64_t CEventScheduler::m_ticklessNs;
+uint64_t CEventScheduler::m_hostStart;
+std::atomic_uint CEventScheduler::m_postedIrqs;
+void (*CEventScheduler::m_wakeup)(void);
+SchedStats CEventScheduler::m_stats;
+const SchedEvent *CEventScheduler::m_tickEvent;
+uint64_t CEventScheduler::m_tickHist[SCHED_TICK_BUCKETS];
+
+
+/** **********************************************************************************************
+ *
+ * @brief Initialise the scheduler and install it as event callback of the 68k core
+ *
+ * @param[in]  wakeup       called by postIrq(), to wake up the idle emulator thread
+ *
+ * @note The emulated time starts with 0.
+ *
+ ************************************************************************************************/
+void CEventScheduler::init(void (*wakeup)(void))
+{
+    memset(m_wheel, 0, sizeof(m_wheel));
+    memset(&m_stats, 0, sizeof(m_stats));
+    memset(m_tickHist, 0, sizeof(m_tickHist));
+    m_tickEvent = nullptr;
+    m_cursor = 0;
+    m_bNextDueValid = false;
+    m_bWarp = false;
+    m_hostStart = hostNow();
+    m_offset = -(int64_t) m_hostStart;
+    m_postedIrqs = 0;
+    m_wakeup = wakeup;
+    m68k_SetEventCallback(poll);
+    m68k_SetEventBudget(SCHED_POLL_INSNS);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Initialise an event
+ *
+ * @param[out] ev           event
+ * @param[in]  handler      called when the event is due
+ * @param[in]  param        passed to handler
+ * @param[in]  bCatchUp     periodic: deliver late periods later, otherwise drop them
+ * @param[in]  bDeferrable  may be delayed in tickless idle, see idle()
+ *
+ ************************************************************************************************/
+void CEventScheduler::setup(SchedEvent *ev, SchedHandler handler, void *param, bool bCatchUp, bool bDeferrable)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->handler = handler;
+    ev->param = param;
+    ev->bCatchUp = bCatchUp;
+    ev->bDeferrable = bDeferrable;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Schedule an event, replaces a previous schedule
+ *
+ * @param[in]  ev           event
+ * @param[in]  delay        ns from now
+ * @param[in]  period       ns, 0 for a one-shot event
+ *
+ ************************************************************************************************/
+void CEventScheduler::schedule(SchedEvent *ev, uint64_t delay, uint64_t period)
+{
+    uint64_t t = now();
+
+    if (isQueued(ev))
+    {
+        dequeue(ev);
+    }
+    ev->due = ev->when = t + delay;
+    ev->period = period;
+    enqueue(ev);
+    if (m_bWarp)
+    {
+        // the event might be due before the current budget ends
+        setBudget(t);
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Remove an event from the schedule, if queued
+ *
+ ************************************************************************************************/
+void CEventScheduler::cancel(SchedEvent *ev)
+{
+    if (isQueued(ev))
+    {
+        dequeue(ev);
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Monotonic host time in ns
+ *
+ ************************************************************************************************/
+uint64_t CEventScheduler::hostNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * SCHED_NS_PER_SEC + (uint64_t) ts.tv_nsec;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emulated time in ns
+ *
+ ************************************************************************************************/
+uint64_t CEventScheduler::now()
+{
+    if (m_bWarp)
+    {
+        return m_warpBase + (m68k_GetInsnCount() - m_warpInsns) * SCHED_WARP_NS_PER_INSN;
+    }
+    return hostNow() + (uint64_t) m_offset;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Switch between real time and warp mode
+ *
+ * @param[in]  bWarp        true: time is derived from the number of executed instructions
+ *
+ ************************************************************************************************/
+void CEventScheduler::setWarp(bool bWarp)
+{
+    if (bWarp != m_bWarp)
+    {
+        uint64_t t = now();
+        if (bWarp)
+        {
+            m_warpBase = t;
+            m_warpInsns = m68k_GetInsnCount();
+        }
+        else
+        {
+            m_offset = (int64_t) (t - hostNow());
+        }
+        m_bWarp = bWarp;
+        setBudget(t);
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Set the longest delay of deferrable events in tickless idle
+ *
+ * @param[in]  maxMs        ms, 0: tickless idle is off
+ *
+ ************************************************************************************************/
+void CEventScheduler::setTickless(unsigned maxMs)
+{
+    m_ticklessNs = maxMs * 1000000ULL;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief The emulated CPU is idle until the next interrupt
+ *
+ * @param[out] pHostDeadline    host time of the next event, UINT64_MAX for none
+ * @param[in]  bTickless        the guest waits for events, deferrable events may be delayed
+ *
+ * @return true: wait for a wakeup or the deadline, false: continue immediately
+ *
+ * @note The next instruction boundary runs the scheduler. In warp mode the time up to
+ *       the next event is skipped. Late periods of catch-up events are delivered at once,
+ *       the guest has acknowledged the previous interrupt when it is idle.
+ *
+ ************************************************************************************************/
+bool CEventScheduler::idle(uint64_t *pHostDeadline, bool bTickless)
+{
+    m68k_SetEventBudget(0);
+    if (m_postedIrqs != 0)
+    {
+        return false;
+    }
+
+    uint64_t t = now();
+    bTickless = bTickless && !m_bWarp && (m_ticklessNs != 0);
+    uint64_t due = UINT64_MAX;
+    for (unsigned slot = 0; slot < SCHED_WHEEL_SLOTS; slot++)
+    {
+        for (SchedEvent *ev = m_wheel[slot]; ev != nullptr; ev = ev->next)
+        {
+            if ((ev->due < ev->when) && (ev->due <= t))
+            {
+                // catch-up, no need to wait
+                dequeue(ev);
+                ev->when = t;
+                enqueue(ev);
+                return false;
+            }
+            if (!(bTickless && ev->bDeferrable) && (ev->when < due))
+            {
+                due = ev->when;
+            }
+        }
+    }
+
+    if (due <= t)
+    {
+        return false;
+    }
+    if (m_bWarp)
+    {
+        if (due != UINT64_MAX)
+        {
+            m_warpBase += due - t;
+            m_stats.skippedNs += due - t;
+        }
+        return false;
+    }
+
+    if (bTickless)
+    {
+        if (due - t > m_ticklessNs)
+        {
+            due = t + m_ticklessNs;
+        }
+        m_stats.ticklessWaits++;
+    }
+    m_stats.waits++;
+    *pHostDeadline = (due == UINT64_MAX) ? UINT64_MAX : due - (uint64_t) m_offset;
+    return true;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get the host time of the next event
+ *
+ * @return monotonic host time in ns, UINT64_MAX for none or in warp mode
+ *
+ ************************************************************************************************/
+uint64_t CEventScheduler::nextHostDeadline()
+{
+    uint64_t due = nextDue();
+    if (m_bWarp || (due == UINT64_MAX))
+    {
+        return UINT64_MAX;
+    }
+    return due - (uint64_t) m_offset;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Raise an interrupt from another thread, e.g. for a received network packet
+ *
+ * @param[in]  level        68k interrupt level
+ *
+ * @note The interrupt is raised by the emulator thread at the next scheduler run.
+ *
+ ************************************************************************************************/
+void CEventScheduler::postIrq(unsigned level)
+{
+    m_postedIrqs |= 1U << (level & 7);
+    if (m_wakeup != nullptr)
+    {
+        m_wakeup();
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Leave the 68k core from another thread or a signal handler, e.g. for pending input
+ *
+ * @note m68k_StopExecution() is called by the emulator thread at the next scheduler run,
+ *       i.e. after at most SCHED_POLL_INSNS instructions. An idle emulator thread is not
+ *       woken up, the caller sets its own event for that.
+ *
+ ************************************************************************************************/
+void CEventScheduler::postStop()
+{
+    m_postedIrqs |= 1U;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get statistics
+ *
+ * @param[out] stats        counters since init()
+ *
+ ************************************************************************************************/
+void CEventScheduler::getStats(SchedStats *stats)
+{
+    *stats = m_stats;
+    stats->hostNs = hostNow() - m_hostStart;
+
+    uint64_t count = stats->ticks;
+    uint64_t sum = 0;
+    for (unsigned b = 0; (b < SCHED_TICK_BUCKETS) && (count != 0); b++)
+    {
+        sum += m_tickHist[b];
+        if ((stats->tickP50Ns == 0) && (sum * 2 >= count))
+        {
+            stats->tickP50Ns = tickBucketEndNs(b);
+        }
+        if (sum * 100 >= count * 99)
+        {
+            stats->tickP99Ns = tickBucketEndNs(b);
+            break;
+        }
+    }
+    if (stats->tickP50Ns > stats->tickMaxNs)
+    {
+        stats->tickP50Ns = stats->tickMaxNs;
+    }
+    if (stats->tickP99Ns > stats->tickMaxNs)
+    {
+        stats->tickP99Ns = stats->tickMaxNs;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Write statistics to the debug output
+ *
+ ************************************************************************************************/
+void CEventScheduler::logStats()
+{
+    SchedStats st;
+    getStats(&st);
+    DebugInfo2("() - %llu polls, %llu events, %llu caught up, %llu lost, latency max %llu us, skipped %llu ms",
+                (unsigned long long) st.polls, (unsigned long long) st.fired,
+                (unsigned long long) st.caughtUp, (unsigned long long) st.lost,
+                (unsigned long long) (st.lateMaxNs / 1000), (unsigned long long) (st.skippedNs / 1000000));
+    DebugInfo2("() - %llu idle waits (%llu tickless), %llu wakeups per second",
+                (unsigned long long) st.waits, (unsigned long long) st.ticklessWaits,
+                (unsigned long long) (st.waits * SCHED_NS_PER_SEC / (st.hostNs + 1)));
+    if (st.ticks != 0)
+    {
+        DebugInfo2("() - %llu ticks, late p50 %llu us, p99 %llu us, max %llu us",
+                    (unsigned long long) st.ticks, (unsigned long long) (st.tickP50Ns / 1000),
+                    (unsigned long long) (st.tickP99Ns / 1000), (unsigned long long) (st.tickMaxNs / 1000));
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Histogram bucket of a tick lateness
+ *
+ * @note Bucket 0 is below 1 us. Then there are four buckets per power of two microseconds,
+ *       as in CInputLatency, up to about 16 s.
+ *
+ ************************************************************************************************/
+unsigned CEventScheduler::tickBucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    if (us == 0)
+    {
+        return 0;
+    }
+
+    unsigned log2 = 63 - (unsigned) __builtin_clzll(us);
+    unsigned sub = (log2 >= 2) ? (unsigned) (us >> (log2 - 2)) & 3 : (unsigned) (us << (2 - log2)) & 3;
+    unsigned b = 1 + log2 * 4 + sub;
+    return (b < SCHED_TICK_BUCKETS) ? b : SCHED_TICK_BUCKETS - 1;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Upper end of a tick histogram bucket, in ns
+ *
+ ************************************************************************************************/
+uint64_t CEventScheduler::tickBucketEndNs(unsigned b)
+{
+    unsigned log2 = b / 4;
+    unsigned sub = b % 4;
+    return ((uint64_t) (4 + sub) << log2) * 1000 / 4;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief 68k emulator callback: instruction budget is exhausted
+ *
+ ************************************************************************************************/
+void CEventScheduler::poll()
+{
+    m_stats.polls++;
+
+    unsigned irqs = m_postedIrqs.exchange(0);
+    if (irqs & 1U)
+    {
+        m68k_StopExecution();
+    }
+    for (unsigned level = 1; level < 8; level++)
+    {
+        if (irqs & (1U << level))
+        {
+            m68k_RaiseIrq(level);
+        }
+    }
+
+    uint64_t t = now();
+    run(t);
+    setBudget(t);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Call the handlers of all events that are due at time <t>
+ *
+ * @note The wheel slots from the last run up to <t> are visited, at most one revolution.
+ *       Events in a slot that belong to a later revolution remain.
+ *
+ ************************************************************************************************/
+void CEventScheduler::run(uint64_t t)
+{
+    uint64_t last = t >> SCHED_SLOT_SHIFT;
+    uint64_t slot = m_cursor;
+
+    if (last - slot >= SCHED_WHEEL_SLOTS)
+    {
+        slot = last - SCHED_WHEEL_SLOTS + 1;
+    }
+
+    for (; slot <= last; slot++)
+    {
+        SchedEvent *ev = m_wheel[slot & SCHED_SLOT_MASK];
+        while (ev != nullptr)
+        {
+            if (ev->when <= t)
+            {
+                dequeue(ev);
+                fire(ev, t);
+                // the handler may have changed the list
+                ev = m_wheel[slot & SCHED_SLOT_MASK];
+            }
+            else
+            {
+                ev = ev->next;
+            }
+        }
+    }
+    m_cursor = last;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Call the handler of a due event, and queue its next period
+ *
+ ************************************************************************************************/
+void CEventScheduler::fire(SchedEvent *ev, uint64_t t)
+{
+    unsigned nLost = 0;
+
+    if (t - ev->when > m_stats.lateMaxNs)
+    {
+        m_stats.lateMaxNs = t - ev->when;
+    }
+    m_stats.fired++;
+    if (ev == m_tickEvent)
+    {
+        // against the regular period, i.e. including tickless delays and catch-up
+        uint64_t late = t - ev->due;
+        m_tickHist[tickBucket(late)]++;
+        m_stats.ticks++;
+        if (late > m_stats.tickMaxNs)
+        {
+            m_stats.tickMaxNs = late;
+        }
+    }
+
+    if (ev->period != 0)
+    {
+        // further periods that are already due
+        uint64_t late = (t - ev->due) / ev->period;
+        if (late == 0)
+        {
+            ev->due += ev->period;
+            ev->when = ev->due;
+        }
+        else
+        if (ev->bCatchUp)
+        {
+            if (late > SCHED_CATCHUP_MAX)
+            {
+                nLost = (unsigned) (late - SCHED_CATCHUP_MAX);
+            }
+            ev->due += (nLost + 1) * ev->period;
+            // leave time for the guest to acknowledge the interrupt
+            ev->when = t + ev->period / 10;
+            m_stats.caughtUp++;
+        }
+        else
+        {
+            nLost = (late > UINT32_MAX) ? UINT32_MAX : (unsigned) late;
+            ev->due += (late + 1) * ev->period;
+            ev->when = ev->due;
+        }
+        m_stats.lost += nLost;
+        enqueue(ev);
+    }
+
+    ev->handler(ev->param, nLost);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Insert an event into the wheel slot of its time
+ *
+ * @note Events are never queued in the past, so that the slot is not before the cursor.
+ *
+ ************************************************************************************************/
+void CEventScheduler::enqueue(SchedEvent *ev)
+{
+    uint64_t min = m_cursor << SCHED_SLOT_SHIFT;
+    if (ev->when < min)
+    {
+        ev->when = min;
+    }
+
+    SchedEvent **head = &m_wheel[(ev->when >> SCHED_SLOT_SHIFT) & SCHED_SLOT_MASK];
+    ev->next = *head;
+    if (ev->next != nullptr)
+    {
+        ev->next->pprev = &ev->next;
+    }
+    ev->pprev = head;
+    *head = ev;
+
+    if (m_bNextDueValid && (ev->when < m_nextDue))
+    {
+        m_nextDue = ev->when;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Remove an event from its wheel slot
+ *
+ ************************************************************************************************/
+void CEventScheduler::dequeue(SchedEvent *ev)
+{
+    *ev->pprev = ev->next;
+    if (ev->next != nullptr)
+    {
+        ev->next->pprev = ev->pprev;
+    }
+    ev->next = nullptr;
+    ev->pprev = nullptr;
+
+    if (m_bNextDueValid && (ev->when == m_nextDue))
+    {
+        m_bNextDueValid = false;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get time of the next event
+ *
+ * @return emulated time in ns, UINT64_MAX for none
+ *
+ * @note The first non-empty slot from the cursor on, within one revolution, contains the
+ *       next event, otherwise all slots are searched.
+ *
+ ************************************************************************************************/
+uint64_t CEventScheduler::nextDue()
+{
+    if (m_bNextDueValid)
+    {
+        return m_nextDue;
+    }
+
+    uint64_t due = UINT64_MAX;
+    for (uint64_t slot = m_cursor; (slot < m_cursor + SCHED_WHEEL_SLOTS) && (due == UINT64_MAX); slot++)
+    {
+        for (const SchedEvent *ev = m_wheel[slot & SCHED_SLOT_MASK]; ev != nullptr; ev = ev->next)
+        {
+            if (((ev->when >> SCHED_SLOT_SHIFT) == slot) && (ev->when < due))
+            {
+                due = ev->when;
+            }
+        }
+    }
+    if (due == UINT64_MAX)
+    {
+        for (unsigned slot = 0; slot < SCHED_WHEEL_SLOTS; slot++)
+        {
+            for (const SchedEvent *ev = m_wheel[slot]; ev != nullptr; ev = ev->next)
+            {
+                if (ev->when < due)
+                {
+                    due = ev->when;
+                }
+            }
+        }
+    }
+
+    m_nextDue = due;
+    m_bNextDueValid = true;
+    return due;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Set the instruction budget of the 68k core up to the next scheduler run
+ *
+ * @param[in]  t            current emulated time
+ *
+ * @note In real time mode the number of instructions up to the next event is unknown,
+ *       so the clock is looked at regularly. In warp mode it is exact.
+ *
+ ************************************************************************************************/
+void CEventScheduler::setBudget(uint64_t t)
+{
+    unsigned insns = SCHED_POLL_INSNS;
+
+    if (m_bWarp)
+    {
+        uint64_t due = nextDue();
+        if (due <= t)
+        {
+            insns = 1;
+        }
+        else
+        if (due - t < SCHED_POLL_INSNS * SCHED_WARP_NS_PER_INSN)
+        {
+            insns = (unsigned) ((due - t + SCHED_WARP_NS_PER_INSN - 1) / SCHED_WARP_NS_PER_INSN);
+        }
+    }
+
+    m68k_SetEventBudget(insns);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Clock thread for the host screen update
+*
+* The ticks follow an absolute schedule, i.e. tick n is due at start + n * period,
+* so that late wakeups do not accumulate to a drift. If the thread wakes up
+* after more than one tick was due, the missed ticks are dropped.
+*
+* Between the ticks the thread waits for an event with the deadline of the
+* next tick, so that stop() can wake it at once.
+*
+* The interrupts of the emulated Atari do not depend on this thread, they are
+* raised by the emulator thread itself, see CEventScheduler.
+*
+*/
+
+#include "config.h"
+// system headers
+#include <string.h>
+#include <time.h>
+// program headers
+#include "Debug.h"
+#include "HostClock.h"
+
+pthread_t CHostClock::m_thread;
+std::atomic_bool CHostClock::m_bRun;
+CHostEvent CHostClock::m_stopEvent;
+HostClockTick CHostClock::m_tick;
+uint64_t CHostClock::m_periodNs;
+HostClockStats CHostClock::m_stats;
+const unsigned CHostClock::lateBucketUs[HOSTCLOCK_LATE_BUCKETS] =
+{
+    50, 100, 250, 500, 1000, 2500, 5000, UINT32_MAX
+};
+
+
+/** **********************************************************************************************
+ *
+ * @brief Start the clock thread
+ *
+ * @param[in]  tick         called for each tick, in the clock thread
+ * @param[in]  hz           tick rate
+ *
+ * @return 0 for OK or -1 on error
+ *
+ ************************************************************************************************/
+int CHostClock::start(HostClockTick tick, unsigned hz)
+{
+    m_tick = tick;
+    m_periodNs = 1000000000U / ((hz != 0) ? hz : 1);
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stopEvent.clear();
+    m_bRun = true;
+    if (pthread_create(&m_thread, nullptr, _thread, nullptr))
+    {
+        DebugError2("() : pthread_create() failed");
+        m_bRun = false;
+        return -1;
+    }
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Stop the clock thread and wait for its end
+ *
+ * @note The thread is woken up, there is no further tick.
+ *
+ ************************************************************************************************/
+void CHostClock::stop()
+{
+    if (m_bRun.exchange(false))
+    {
+        m_stopEvent.set(1);
+        pthread_join(m_thread, nullptr);
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get jitter statistics
+ *
+ * @param[out] stats        counters since start()
+ *
+ * @note Only consistent after stop(), otherwise a snapshot of a running clock.
+ *
+ ************************************************************************************************/
+void CHostClock::getStats(HostClockStats *stats)
+{
+    *stats = m_stats;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Write jitter statistics to the debug output
+ *
+ ************************************************************************************************/
+void CHostClock::logStats()
+{
+    HostClockStats st;
+    getStats(&st);
+    if (st.ticks == 0)
+    {
+        return;
+    }
+    DebugInfo2("() - %llu ticks, %llu missed, wakeup latency avg %llu us, max %u us",
+                (unsigned long long) st.ticks, (unsigned long long) st.missed,
+                (unsigned long long) (st.lateSumNs / st.ticks / 1000), st.lateMaxNs / 1000);
+    for (unsigned i = 0; i < HOSTCLOCK_LATE_BUCKETS; i++)
+    {
+        if (st.late[i] != 0)
+        {
+            if (lateBucketUs[i] == UINT32_MAX)
+            {
+                DebugInfo2("() -   latency >= %u us: %llu", lateBucketUs[i - 1], (unsigned long long) st.late[i]);
+            }
+            else
+            {
+                DebugInfo2("() -   latency < %u us: %llu", lateBucketUs[i], (unsigned long long) st.late[i]);
+            }
+        }
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Monotonic host time in ns
+ *
+ * @note The same clock as CHostEvent::now(), used for the wait deadlines.
+ *
+ ************************************************************************************************/
+uint64_t CHostClock::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+}
+
+
+void *CHostClock::_thread(void *param)
+{
+    (void) param;
+    thread();
+    return nullptr;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Clock thread
+ *
+ ************************************************************************************************/
+void CHostClock::thread()
+{
+    uint64_t index = 0;                     // ticks of the schedule that are done
+    uint64_t start = now();
+    uint64_t deadline = start + m_periodNs;
+
+    while (m_bRun)
+    {
+        if (m_stopEvent.wait(deadline) != 0)
+        {
+            break;      // stop(), no further tick
+        }
+        uint64_t n = now();
+        if (n < deadline)
+        {
+            continue;
+        }
+
+        // one or more ticks are due
+        uint64_t late = n - deadline;
+        unsigned due = (unsigned) (late / m_periodNs) + 1;
+        index += due;
+        deadline = start + (index + 1) * m_periodNs;
+
+        m_stats.ticks++;
+        m_stats.missed += due - 1;
+        m_stats.lateSumNs += late;
+        if (late > m_stats.lateMaxNs)
+        {
+            m_stats.lateMaxNs = (late > UINT32_MAX) ? UINT32_MAX : (uint32_t) late;
+        }
+        unsigned i = 0;
+        while ((i < HOSTCLOCK_LATE_BUCKETS - 1) && (late >= lateBucketUs[i] * 1000ULL))
+        {
+            i++;
+        }
+        m_stats.late[i]++;
+
+        m_tick();
+    }
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Event flags, set by any thread, waited for by one thread
+*
+* The flags are an atomic word. Setting them is a single atomic operation,
+* the sleeping thread is only woken up if the flags were clear before. On
+* Linux the thread sleeps on the flag word itself (futex), elsewhere on a
+* condition variable.
+*
+*/
+
+#include "config.h"
+// system headers
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+// program headers
+#include "HostEvent.h"
+
+#define NS_PER_SEC  1000000000ULL
+
+
+/** **********************************************************************************************
+ *
+ * @brief Constructor
+ *
+ ************************************************************************************************/
+CHostEvent::CHostEvent()
+{
+    m_flags = 0;
+    m_bWaiting = false;
+    m_setNs = 0;
+#if !defined(__linux__)
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_cond, nullptr);
+#endif
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Destructor
+ *
+ ************************************************************************************************/
+CHostEvent::~CHostEvent()
+{
+#if !defined(__linux__)
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get monotonic host time
+ *
+ * @return time in ns
+ *
+ ************************************************************************************************/
+uint64_t CHostEvent::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * NS_PER_SEC + (uint64_t) ts.tv_nsec;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Set flags and wake up the waiting thread
+ *
+ * @param[in]  flags        bit mask of flags to be set
+ *
+ * @note May be called from any thread. Costs no system call if the flags were already set
+ *       or if nobody waits.
+ *
+ ************************************************************************************************/
+void CHostEvent::set(uint32_t flags)
+{
+    uint32_t old = m_flags.fetch_or(flags);
+    if ((old != 0) || (flags == 0) || !m_bWaiting)
+    {
+        return;
+    }
+
+    m_setNs = now();
+#if defined(__linux__)
+    syscall(SYS_futex, (uint32_t *) &m_flags, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    pthread_mutex_lock(&m_mutex);
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Wait for flags, and clear them
+ *
+ * @param[in]  deadline     monotonic host time in ns, see now(), UINT64_MAX for none
+ *
+ * @return flags that were set, 0 on timeout
+ *
+ * @note Only one thread may wait.
+ *
+ ************************************************************************************************/
+uint32_t CHostEvent::wait(uint64_t deadline)
+{
+    uint32_t flags = m_flags.exchange(0);
+    if (flags != 0)
+    {
+        return flags;
+    }
+
+    m_stats.waits++;
+    m_setNs = 0;
+    // set() looks at m_bWaiting after setting the flags, we look at the flags after this
+    m_bWaiting = true;
+
+    struct timespec ts;
+#if defined(__linux__)
+    // absolute monotonic time
+    ts.tv_sec = (time_t) (deadline / NS_PER_SEC);
+    ts.tv_nsec = (long) (deadline % NS_PER_SEC);
+    while ((flags = m_flags.exchange(0)) == 0)
+    {
+        if (syscall(SYS_futex, (uint32_t *) &m_flags, FUTEX_WAIT_BITSET_PRIVATE, 0,
+                    (deadline == UINT64_MAX) ? nullptr : &ts, nullptr, FUTEX_BITSET_MATCH_ANY) != 0)
+        {
+            if (errno == ETIMEDOUT)
+            {
+                flags = m_flags.exchange(0);
+                break;
+            }
+            // EAGAIN: flags were set before sleeping, EINTR: signal
+        }
+    }
+#else
+    // the condition variable uses the real time clock, which may be adjusted
+    if (deadline != UINT64_MAX)
+    {
+        uint64_t t = now();
+        uint64_t rest = (deadline > t) ? deadline - t : 0;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        rest += (uint64_t) ts.tv_nsec;
+        ts.tv_sec += (time_t) (rest / NS_PER_SEC);
+        ts.tv_nsec = (long) (rest % NS_PER_SEC);
+    }
+    pthread_mutex_lock(&m_mutex);
+    while ((flags = m_flags.exchange(0)) == 0)
+    {
+        if (deadline == UINT64_MAX)
+        {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        else
+        if (pthread_cond_timedwait(&m_cond, &m_mutex, &ts) == ETIMEDOUT)
+        {
+            flags = m_flags.exchange(0);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    m_bWaiting = false;
+
+    uint64_t setNs = m_setNs;
+    if ((flags != 0) && (setNs != 0))
+    {
+        uint64_t latency = now() - setNs;
+        m_stats.wakeups++;
+        m_stats.wakeSumNs += latency;
+        if (latency > m_stats.wakeMaxNs)
+        {
+            m_stats.wakeMaxNs = latency;
+        }
+    }
+    return flags;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get statistics
+ *
+ * @param[out] stats        counters since construction
+ *
+ * @note Call from the waiting thread, or when it does not run.
+ *
+ ************************************************************************************************/
+void CHostEvent::getStats(HostEventStats *stats)
+{
+    *stats = m_stats;
+}
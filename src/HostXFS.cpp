@@ -4088,6 +4088,11 @@ INT32 CHostXFS::XFSDevFunctions(UINT32 param, uint8_t *addrOffset68k)
                     be32toh(pdevreadparm->count),
                     (char *) (addrOffset68k + be32toh(pdevreadparm->buf))
                     );
+            if (doserr > 0)
+            {
+                // data might be code, e.g. a program that is being loaded
+                m68k_InvalidateCode(be32toh(pdevreadparm->buf), doserr);
+            }
             break;
         }
 
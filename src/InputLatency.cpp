@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Latency of keyboard and mouse input, from the host event to the Atari
+*
+* Each host input event carries the time when the SDL event loop got it,
+* corrected by the time it spent in the SDL queue. Two latencies are measured:
+*
+*  - until the Atari reads the corresponding byte in its IKBD interrupt,
+*    separately for keys and mouse packets,
+*  - until the next frame is presented whose conversion started after
+*    the Atari had read the input, and that contains a screen change.
+*
+* The guest latencies are recorded by the emulator thread, the screen latency
+* by the GUI thread, so that each histogram has a single writer.
+*
+*/
+
+#include "config.h"
+// system headers
+#include <string.h>
+#include <time.h>
+// program headers
+#include "Debug.h"
+#include "InputLatency.h"
+
+uint64_t CInputLatency::m_hist[INPUTLAT_KINDS][INPUTLAT_BUCKETS];
+uint64_t CInputLatency::m_count[INPUTLAT_KINDS];
+uint64_t CInputLatency::m_maxNs[INPUTLAT_KINDS];
+std::atomic<uint64_t> CInputLatency::m_unseenNs;
+const char *CInputLatency::kindName[INPUTLAT_KINDS] =
+{
+    "key to Atari", "mouse to Atari", "input to screen"
+};
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get monotonic host time
+ *
+ * @return time in ns
+ *
+ ************************************************************************************************/
+uint64_t CInputLatency::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emulator thread: the Atari has read a byte of a host input event
+ *
+ * @param[in]  kind         INPUTLAT_KEY_TO_GUEST or INPUTLAT_MOUSE_TO_GUEST
+ * @param[in]  eventNs      time of the host event, see now(), 0: unknown
+ *
+ ************************************************************************************************/
+void CInputLatency::consumed(unsigned kind, uint64_t eventNs)
+{
+    if (eventNs == 0)
+    {
+        return;
+    }
+    record(kind, now() - eventNs);
+
+    // wait for the screen change, keep the oldest
+    uint64_t expected = 0;
+    (void) m_unseenNs.compare_exchange_strong(expected, eventNs);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief GUI thread: the conversion of a frame starts
+ *
+ * @return time of the oldest input event that the Atari had read before, 0: none
+ *
+ ************************************************************************************************/
+uint64_t CInputLatency::beginFrame()
+{
+    return m_unseenNs.exchange(0);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief GUI thread: the frame is done
+ *
+ * @param[in]  eventNs      from beginFrame()
+ * @param[in]  bPresented   the frame contained a screen change and was presented
+ *
+ ************************************************************************************************/
+void CInputLatency::endFrame(uint64_t eventNs, bool bPresented)
+{
+    if (eventNs == 0)
+    {
+        return;
+    }
+    if (bPresented)
+    {
+        record(INPUTLAT_TO_SCREEN, now() - eventNs);
+    }
+    else
+    {
+        // still waiting, unless the emulator thread has stored a newer one meanwhile
+        uint64_t expected = 0;
+        if (!m_unseenNs.compare_exchange_strong(expected, eventNs) && (expected > eventNs))
+        {
+            m_unseenNs = eventNs;
+        }
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Histogram bucket of a latency
+ *
+ * @note Bucket 0 is below 1 us. Then there are four buckets per power of two microseconds,
+ *       i.e. the resolution is about 19 %.
+ *
+ ************************************************************************************************/
+unsigned CInputLatency::bucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    if (us == 0)
+    {
+        return 0;
+    }
+
+    unsigned log2 = 63 - (unsigned) __builtin_clzll(us);
+    unsigned sub = (log2 >= 2) ? (unsigned) (us >> (log2 - 2)) & 3 : (unsigned) (us << (2 - log2)) & 3;
+    unsigned b = 1 + log2 * 4 + sub;
+    return (b < INPUTLAT_BUCKETS) ? b : INPUTLAT_BUCKETS - 1;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Upper end of a histogram bucket, in ns
+ *
+ ************************************************************************************************/
+uint64_t CInputLatency::bucketEndNs(unsigned b)
+{
+    // bucket b + 1 starts at (4 + sub) / 4 * 2^log2 us
+    unsigned log2 = b / 4;
+    unsigned sub = b % 4;
+    return ((uint64_t) (4 + sub) << log2) * 1000 / 4;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Add a latency to a histogram
+ *
+ ************************************************************************************************/
+void CInputLatency::record(unsigned kind, uint64_t ns)
+{
+    m_hist[kind][bucket(ns)]++;
+    m_count[kind]++;
+    if (ns > m_maxNs[kind])
+    {
+        m_maxNs[kind] = ns;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get statistics
+ *
+ * @param[in]  kind         INPUTLAT_...
+ * @param[out] stats        number of events, percentiles and maximum since start
+ *
+ * @note May be called from any thread, the result is approximate while input arrives.
+ *
+ ************************************************************************************************/
+void CInputLatency::getStats(unsigned kind, InputLatencyStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (kind >= INPUTLAT_KINDS)
+    {
+        return;
+    }
+
+    uint64_t hist[INPUTLAT_BUCKETS];
+    uint64_t count = 0;
+    for (unsigned b = 0; b < INPUTLAT_BUCKETS; b++)
+    {
+        hist[b] = m_hist[kind][b];
+        count += hist[b];
+    }
+    stats->count = count;
+    stats->maxNs = m_maxNs[kind];
+
+    uint64_t sum = 0;
+    for (unsigned b = 0; b < INPUTLAT_BUCKETS; b++)
+    {
+        sum += hist[b];
+        if ((stats->p50Ns == 0) && (sum * 2 >= count) && (count != 0))
+        {
+            stats->p50Ns = bucketEndNs(b);
+        }
+        if ((sum * 100 >= count * 99) && (count != 0))
+        {
+            stats->p99Ns = bucketEndNs(b);
+            break;
+        }
+    }
+    if (stats->p50Ns > stats->maxNs)
+    {
+        stats->p50Ns = stats->maxNs;
+    }
+    if (stats->p99Ns > stats->maxNs)
+    {
+        stats->p99Ns = stats->maxNs;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Write statistics to the log
+ *
+ ************************************************************************************************/
+void CInputLatency::logStats()
+{
+    for (unsigned kind = 0; kind < INPUTLAT_KINDS; kind++)
+    {
+        InputLatencyStats st;
+        getStats(kind, &st);
+        DebugInfo2("() - %s: %llu events, p50 %llu us, p99 %llu us, max %llu us", kindName[kind],
+                    (unsigned long long) st.count, (unsigned long long) (st.p50Ns / 1000),
+                    (unsigned long long) (st.p99Ns / 1000), (unsigned long long) (st.maxNs / 1000));
+    }
+}
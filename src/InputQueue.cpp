@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Lock-free byte queue from one producer thread to one consumer thread
+*
+* Used for keyboard and joystick data from the GUI thread to the emulator
+* thread. The indices run freely and are masked on access, so that a full
+* queue can be told from an empty one. Each index is only written by one
+* side, the release store publishes the data written before.
+*
+*/
+
+#include "config.h"
+#include "InputQueue.h"
+
+#define INPUTQUEUE_MASK     (INPUTQUEUE_LEN - 1)
+
+
+/** **********************************************************************************************
+ *
+ * @brief Constructor
+ *
+ ************************************************************************************************/
+CInputQueue::CInputQueue()
+{
+    m_write = 0;
+    m_read = 0;
+    m_dropped = 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Producer: append data
+ *
+ * @param[in]  data         bytes
+ * @param[in]  len          number of bytes
+ * @param[in]  timeNs       host time of the input event, see CInputLatency
+ *
+ * @return true: OK, false: not enough room, nothing appended
+ *
+ * @note All or nothing, so that a multi-byte packet is never split.
+ *
+ ************************************************************************************************/
+bool CInputQueue::put(const uint8_t *data, unsigned len, uint64_t timeNs)
+{
+    unsigned write = m_write.load(std::memory_order_relaxed);
+    unsigned read = m_read.load(std::memory_order_acquire);
+
+    if (INPUTQUEUE_LEN - (write - read) < len)
+    {
+        m_dropped.fetch_add(len, std::memory_order_relaxed);
+        return false;
+    }
+
+    for (unsigned i = 0; i < len; i++)
+    {
+        m_buf[(write + i) & INPUTQUEUE_MASK] = data[i];
+        m_time[(write + i) & INPUTQUEUE_MASK] = (i == 0) ? timeNs : 0;
+    }
+    m_write.store(write + len, std::memory_order_release);
+    return true;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Consumer: remove the oldest byte
+ *
+ * @param[out] pData        the byte
+ * @param[out] pTimeNs      host time of the input event, 0: not the first byte, or unknown
+ *
+ * @return true: OK, false: queue is empty
+ *
+ ************************************************************************************************/
+bool CInputQueue::get(uint8_t *pData, uint64_t *pTimeNs)
+{
+    unsigned read = m_read.load(std::memory_order_relaxed);
+    unsigned write = m_write.load(std::memory_order_acquire);
+
+    if (read == write)
+    {
+        return false;
+    }
+
+    *pData = m_buf[read & INPUTQUEUE_MASK];
+    if (pTimeNs != nullptr)
+    {
+        *pTimeNs = m_time[read & INPUTQUEUE_MASK];
+    }
+    m_read.store(read + 1, std::memory_order_release);
+    return true;
+}
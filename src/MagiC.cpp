@@ -29,12 +29,17 @@
 #include <sys/stat.h>
 #include <sys/param.h>
 #include <time.h>
+#include <math.h>
+#include <float.h>
+#include <signal.h>
 #include "emulation_globals.h"
 #include "Debug.h"
 #include "Globals.h"
 #include "MagiC.h"
 #include "MagiCSerial.h"
 #include "MagiCPrint.h"
+#include "MagiCMfp.h"
+#include "InputLatency.h"
 #include "Atari.h"
 #include "volume_images.h"
 #include "network.h"
@@ -55,16 +60,14 @@
 
 static CMagiC *pTheMagiC = nullptr;
 
+// debug core shall be running, see CMagiC::requestDebugCore()
+static volatile sig_atomic_t sDebugCoreRequested = 0;
 
-#ifndef NDEBUG
-#if defined(M68K_BREAKPOINTS)
-uint32_t m68k_breakpoints[M68K_BREAKPOINTS][2];      //  68k address and range, usually 0
-#endif
+uint32_t m68k_breakpoints[M68K_BREAKPOINTS][2];      //  68k start and end address, unused if end is 0
+uint32_t m68k_write_watches[M68K_WRITE_WATCHES];     //  68k address, unused if 0
 
-#if defined(M68K_WRITE_WATCHES)
-uint32_t m68k_write_watches[M68K_WRITE_WATCHES];
-#endif
 
+#ifndef NDEBUG
 int do_not_interrupt_68k = 0;       // for debugging
 // disable interrupts, essential for debugging
 extern "C" {
@@ -116,10 +119,6 @@ void sendBusError(uint32_t addr, const char *AccessMode)
 {
     pTheMagiC->sendBusError(addr, AccessMode);
 }
-void sendVBL(void)
-{
-    pTheMagiC->sendVBL();
-}
 void getActAtariPrg(const char **pName, uint32_t *pact_pd)
 {
     pTheMagiC->GetActAtariPrg(pName, pact_pd);
@@ -152,9 +151,9 @@ static inline void OS_ExitCriticalRegion(pthread_mutex_t *criticalRegion)
     pthread_mutex_unlock(criticalRegion);
 }
 
-static inline void OS_CreateEvent(uint32_t *eventId)
+static inline void OS_CreateEvent(CHostEvent *eventId)
 {
-    *eventId = 0;
+    eventId->clear();
 }
 
 
@@ -272,24 +271,24 @@ CMagiC::CMagiC()
     m_BasePage = nullptr;
     memset(&m_EmuTaskID, 0, sizeof(m_EmuTaskID));
 
-    m_EventId = 0;
-    m_InterruptEventsId = 0;
-
-    m_KbCriticalRegionId = PTHREAD_MUTEX_INITIALIZER;
     // m_AECriticalRegionId = PTHREAD_MUTEX_INITIALIZER;    // remnant from MagicMac(X) and AtariX
     m_ScrCriticalRegionId = PTHREAD_MUTEX_INITIALIZER;
 
     //m_iNoOfAtariFiles = 0;  // remnant from MagicMac(X) and AtariX
-    m_pKbWrite = m_pKbRead = m_cKeyboardOrMouseData;
+    m_MousePacketPos = sizeof(m_MousePacket);
     m_bShutdown = false;
     m_bBusErrorPending = false;
-    m_bInterrupt200HzPending = false;
-    m_bInterruptVBLPending = false;
     m_bInterruptMouseKeyboardPending = false;
     m_bInterruptMouseButton[0] = m_bInterruptMouseButton[1] = false;
-    m_InterruptMouseWhereY = m_InterruptMouseWhereX = 0;
-    m_InterruptMouseMoveRelX = m_InterruptMouseMoveRelY = 0.0;
-    m_bInterruptPending = false;
+    m_InterruptMouseWhere = 0;
+    m_InterruptMouseMoveX = m_InterruptMouseMoveY = 0;
+    m_InputCoalesced = 0;
+    m_MouseEventNs = 0;
+    m_Hz200Count = 0;
+    m_bWarpRequested = false;
+    m_CpuLastNs = m_HostLastNs = m_CpuStartNs = m_HostStartNs = 0;
+    m_CpuDebtNs = 0;
+    memset(&m_CpuStats, 0, sizeof(m_CpuStats));
     m_LineAVars = nullptr;
 //    m_PrintFileRefNum = 0;
     pTheMagiC = this;
@@ -297,11 +296,6 @@ CMagiC::CMagiC()
     m_bScreenBufferChanged = false;
     m_bEmulatorIsRunning = false;
 
-    // inter-thread synchronisation
-    m_EventMutex = PTHREAD_MUTEX_INITIALIZER;
-    m_ConditionMutex = PTHREAD_MUTEX_INITIALIZER;
-    m_Cond = PTHREAD_COND_INITIALIZER;
-
     atomic_init(&gbAtariVideoBufChanged, false);
 }
 
@@ -338,18 +332,9 @@ CMagiC::~CMagiC()
  * @param[in] flags        bit mask of flags to be set
  *
  ************************************************************************************************/
-void CMagiC::OS_SetEvent(uint32_t *event, uint32_t flags)
+void CMagiC::OS_SetEvent(CHostEvent *event, uint32_t flags)
 {
-    pthread_mutex_lock(&m_EventMutex);
-    *event |= flags;
-    pthread_mutex_unlock(&m_EventMutex);
-
-    pthread_mutex_lock(&m_ConditionMutex);
-    if (*event != 0)
-    {
-        pthread_cond_signal(&m_Cond);
-    }
-    pthread_mutex_unlock(&m_ConditionMutex);
+    event->set(flags);
 }
 
 
@@ -363,9 +348,9 @@ void CMagiC::OS_SetEvent(uint32_t *event, uint32_t flags)
  * @return masked bit vector with arrived '1' bits
  *
  ************************************************************************************************/
-uint32_t CMagiC::OS_AskEvent(const uint32_t *event, uint32_t flags)
+uint32_t CMagiC::OS_AskEvent(const CHostEvent *event, uint32_t flags)
 {
-    return *event & flags;
+    return event->ask(flags);
 }
 
 
@@ -377,20 +362,25 @@ uint32_t CMagiC::OS_AskEvent(const uint32_t *event, uint32_t flags)
  * @param[out]     flags        bit vector with '1' and '0' flags
  *
  ************************************************************************************************/
-void CMagiC::OS_WaitForEvent(uint32_t *event, uint32_t *flags)
+void CMagiC::OS_WaitForEvent(CHostEvent *event, uint32_t *flags)
 {
-    pthread_mutex_lock(&m_ConditionMutex);
-    while (*event == 0)
-    {
-        // pthread_cond_timedwait() provides additional timeout
-        pthread_cond_wait(&m_Cond, &m_ConditionMutex);
-    }
-    pthread_mutex_unlock(&m_ConditionMutex);
+    *flags = event->wait();
+}
+
 
-    pthread_mutex_lock(&m_EventMutex);
-    *flags = *event;
-    *event = 0;
-    pthread_mutex_unlock(&m_EventMutex);
+/** **********************************************************************************************
+ *
+ * @brief 68k emulator waits for a message, with timeout
+ *
+ * @param[in,out]  event        bit vector to wait for, is cleared on arrival
+ * @param[out]     flags        bit vector with '1' and '0' flags, 0 on timeout
+ * @param[in]      deadline     monotonic host time in ns, see CEventScheduler::hostNow(),
+ *                              UINT64_MAX for none
+ *
+ ************************************************************************************************/
+void CMagiC::OS_WaitForEventUntil(CHostEvent *event, uint32_t *flags, uint64_t deadline)
+{
+    *flags = event->wait(deadline);
 }
 
 
@@ -848,6 +838,7 @@ int CMagiC::init(CXCmd *pXCmd)
     */
 
     DebugInfo2("() - MultiThread version for Linux");
+    DebugInfo2("() - Send SIGUSR1 to switch between production and debug core (breakpoints, trace, all checks below)");
 #ifdef _DEBUG_WRITEPROTECT_ATARI_OS
     DebugInfo2("() - 68k ROM is write-protected (slows down the emulator a bit)");
 #else
@@ -987,7 +978,7 @@ int CMagiC::init(CXCmd *pXCmd)
     pMacXSysHdr->MacSysX_pMMXCookie = htobe32((uint32_t) (((uint64_t) &pAtari68kData->m_CookieData) - (uint64_t) mem68k));
     pMacXSysHdr->MacSysX_verMac = htobe32(10);       // must be 10, checked by kernel in HOSTBIOS.S, mismatch -> 68k illegal instruction
     pMacXSysHdr->MacSysX_cpu = htobe16(20);          // 68020
-    pMacXSysHdr->MacSysX_fpu = htobe16(0);           // no FPU -- yet -- unfortunately
+    pMacXSysHdr->MacSysX_fpu = htobe16(Preferences::AtariFpu ? 6 : 0);  // 68882, the kernel creates the _FPU cookie
     pMacXSysHdr->MacSysX_PPCAddr = 0;                // on 32-bit host: mem68k
     pMacXSysHdr->MacSysX_VideoAddr = 0x80000000;     // on 32-bit host: CMagiCScreen::m_PixMap.baseAddr
     initHostCallbacks(pMacXSysHdr, pXCmd);
@@ -1021,6 +1012,10 @@ int CMagiC::init(CXCmd *pXCmd)
     addrOsRomStart = be32toh((uint32_t) m_BasePage->p_tbase);
     addrOsRomEnd = be32toh((uint32_t) m_BasePage->p_tbase) + be32toh(m_BasePage->p_tlen) + be32toh(m_BasePage->p_dlen);
     DebugInfo2("() - OS ROM range from 0x%08x..0x%08x (68k)", addrOsRomStart, addrOsRomEnd);
+
+    // attributes for fast 68k memory access, depend on the address ranges
+    initPageTable68k();
+
     do
     {
         chksum += htobe32(*fromptr++);
@@ -1069,11 +1064,43 @@ int CMagiC::init(CXCmd *pXCmd)
     // start 68k emulator
 
     addrOpcodeROM = mem68k;    // ROM == RAM
-    m68k_set_int_ack_callback(IRQCallback);
+    m68k_SetIrqVector(M68K_IRQ_5, 69);      // 200 Hz, MFP vector of Timer C
+    m68k_SetIdleCallback(IdleLoopCallback);
+    CEventScheduler::init(SchedulerWakeup);
+    CMagiCMfp::init();                      // level 6: keyboard and mouse, MFP timers
+    CEventScheduler::setup(&m_Hz200Event, Hz200Event, this, Preferences::bClockCatchUp, true);
+    CEventScheduler::setTickEvent(&m_Hz200Event);
+    CEventScheduler::setup(&m_VblEvent, VblEvent, this, false, true);
+    CEventScheduler::setTickless(Preferences::TicklessIdleMs);
+    CEventScheduler::setup(&m_CpuLimitEvent, CpuLimitEvent, this, false, true);
+    m_CpuStats.limit = Preferences::CpuLimit;
     m68k_SetBaseAddr(mem68k);
     m68k_SetHiMem(mem68kSize);
+    unsigned fpuMode = Preferences::AtariFpu;
+#if LDBL_MANT_DIG != 64
+    if (fpuMode == M68K_FPU_EXACT)
+    {
+        // e.g. IEEE quad precision on aarch64 Linux, or double on macOS arm64
+        DebugWarning2("() - host long double has no 64-bit mantissa, FPU uses double precision");
+        fpuMode = M68K_FPU_FAST;
+    }
+#endif
+    m68k_SetFpu(fpuMode);
+    m68k_SetJit(Preferences::bJit);
+#if defined(M68K_DEBUG_CORE_AT_START)
+    sDebugCoreRequested = 1;
+#endif
+    setDebugCore(sDebugCoreRequested != 0);
+    m_bWarpRequested = Preferences::bWarp;
     m_bSpecialExec = false;
 
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigDebugCore;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, nullptr);
+
     // Reset Musashi 68k emulator
     m68k_pulse_reset();
 
@@ -1209,9 +1236,8 @@ int CMagiC::createThread( void )
 
     OS_CreateEvent(&m_InterruptEventsId);
 
-    // CriticalRegion für Tastaturpuffer und Bildschirmpufferadressen erstellen
+    // CriticalRegion für Bildschirmpufferadressen erstellen
 
-    OS_CreateCriticalRegion(&m_KbCriticalRegionId);
     //OS_CreateCriticalRegion(&m_AECriticalRegionId);// remnant from MagicMac(X) and AtariX
     OS_CreateCriticalRegion(&m_ScrCriticalRegionId);
 
@@ -1253,6 +1279,7 @@ void CMagiC::startExec( void )
 *
 * Hält den Ausführungs-Thread an
 * => 0 = OK, sonst = Fehler
+* Wird im Emulator-Thread aufgerufen
 *
 **********************************************************************/
 
@@ -1274,15 +1301,313 @@ void CMagiC::terminateThread(void)
 {
     DebugInfo2("()");
     //dumpAtariMem();
-    #if defined(M68K_TRACE)
+    unsigned idlePc, idleCount;
+    for (unsigned i = 0; m68k_GetIdleLoop(i, &idlePc, &idleCount); i++)
+    {
+        DebugInfo2("() - 68k idle loop at 0x%08x: waited %u times for interrupt", idlePc, idleCount);
+    }
+    unsigned irqCount, irqMerged, irqAvgNs, irqMaxNs;
+    for (unsigned level = 1; level <= 7; level++)
+    {
+        if (m68k_GetIrqStats(level, &irqCount, &irqMerged, &irqAvgNs, &irqMaxNs))
+        {
+            DebugInfo2("() - 68k interrupt level %u: %u times, %u merged, latency avg %u us, max %u us",
+                        level, irqCount, irqMerged, irqAvgNs / 1000, irqMaxNs / 1000);
+        }
+    }
+    CpuStats cpuStats;
+    GetCpuStats(&cpuStats);
+    DebugInfo2("() - host CPU limit %u %%, usage %u %% (current %u %%), throttled %llu times for %llu ms",
+                cpuStats.limit, cpuStats.avgUsage, cpuStats.usage,
+                (unsigned long long) cpuStats.throttles, (unsigned long long) (cpuStats.throttledNs / 1000000));
+    DebugInfo2("() - input: %llu bytes dropped, %llu events merged into a pending interrupt",
+                (unsigned long long) m_KbQueue.getDropped(), (unsigned long long) m_InputCoalesced);
+    HostEventStats evStats;
+    m_InterruptEventsId.getStats(&evStats);
+    DebugInfo2("() - emulator thread waited %llu times, woken %llu times, wake latency avg %llu us, max %llu us",
+                (unsigned long long) evStats.waits, (unsigned long long) evStats.wakeups,
+                (unsigned long long) (evStats.wakeSumNs / (evStats.wakeups ? evStats.wakeups : 1) / 1000),
+                (unsigned long long) (evStats.wakeMaxNs / 1000));
+    if (m68k_GetDebugCore())
+    {
         DebugWarning(" == FINAL TRACE ==");
         m68k_trace_print();
+        #ifndef NDEBUG
         dumpAtariMem();
-    #endif
+        #endif
+    }
     OS_SetEvent(
             &m_EventId,
             EMU_EVNT_TERM);
-    stopExec();
+    m_bCanRun = false;        // darf nicht laufen
+    CEventScheduler::postStop();    // leave inner emulation loop
+}
+
+
+/**********************************************************************
+*
+* Request the production (0) or debug core (1), or toggle (-1)
+* Is applied by the emulator thread before it continues, may be called
+* from a signal handler or by the emulator thread itself (NatFeat).
+*
+**********************************************************************/
+
+void CMagiC::requestDebugCore(int mode)
+{
+    sDebugCoreRequested = (mode < 0) ? !sDebugCoreRequested : (mode != 0);
+    CEventScheduler::postStop();
+}
+
+void CMagiC::sigDebugCore(int sig)
+{
+    (void) sig;
+    requestDebugCore(-1);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Request real time (0) or warp mode (1), or toggle (-1)
+ *
+ * @param[in]  mode     0, 1 or -1
+ *
+ * @note In warp mode the emulated time, i.e. 200 Hz, VBL and MFP timers, is derived from
+ *       the number of executed 68k instructions, see CEventScheduler::setWarp(). Applied
+ *       by the emulator thread before it continues.
+ *
+ ************************************************************************************************/
+void CMagiC::requestWarp(int mode)
+{
+    m_bWarpRequested = (mode < 0) ? !m_bWarpRequested : (mode != 0);
+    CEventScheduler::postStop();
+    // wake up emulator, if in "idle task"
+    OS_SetEvent(
+        &m_InterruptEventsId,
+        EMU_INTPENDING_OTHER);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Event scheduler callback: 200 Hz tick
+ *
+ * @param[in]  param    CMagiC object
+ * @param[in]  nLost    number of dropped ticks, see Preferences::bClockCatchUp
+ *
+ * @note Raises 68k interrupt 5 (on the Atari it is interrupt 6, but the interrupt
+ *       vector 69 is the same). Dropped ticks are added to _hz_200 directly, this is
+ *       safe at an instruction boundary.
+ *
+ ************************************************************************************************/
+void CMagiC::Hz200Event(void *param, unsigned nLost)
+{
+    CMagiC *pThis = (CMagiC *) param;
+
+    if (nLost)
+    {
+        setAtariBE32(mem68k + _hz_200, getAtariBE32(mem68k + _hz_200) + nLost);
+    }
+
+#ifdef _DEBUG_NO_ATARI_HZ200_INTERRUPTS
+    return;
+#endif
+#ifndef NDEBUG
+    if (do_not_interrupt_68k)
+    {
+        return;
+    }
+#endif
+    m68k_RaiseIrq(M68K_IRQ_5);
+    if (++pThis->m_Hz200Count >= 200)
+    {
+        // leave the 68k core once per second, for the housekeeping in EmuThread()
+        pThis->m_Hz200Count = 0;
+        m68k_StopExecution();
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Event scheduler callback: VBL, raises 68k interrupt 4
+ *
+ ************************************************************************************************/
+void CMagiC::VblEvent(void *param, unsigned nLost)
+{
+    (void) param;
+    (void) nLost;
+
+#ifdef _DEBUG_NO_ATARI_VBL_INTERRUPTS
+    return;
+#endif
+#ifndef NDEBUG
+    if (do_not_interrupt_68k)
+    {
+        return;
+    }
+#endif
+    m68k_RaiseIrq(M68K_IRQ_4);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Event scheduler callback: wake up the emulator thread, if in "idle task"
+ *
+ * @note Called from other threads, see CEventScheduler::postIrq()
+ *
+ ************************************************************************************************/
+void CMagiC::SchedulerWakeup(void)
+{
+    pTheMagiC->OS_SetEvent(
+        &pTheMagiC->m_InterruptEventsId,
+        EMU_INTPENDING_OTHER);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get the CPU time used by the calling thread
+ *
+ * @return time in ns
+ *
+ ************************************************************************************************/
+uint64_t CMagiC::ThreadCpuNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * SCHED_NS_PER_SEC + (uint64_t) ts.tv_nsec;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Event scheduler callback: limit the host CPU usage of the emulator thread
+ *
+ * @param[in]  param    this
+ * @param[in]  nLost    unused
+ *
+ * @note Runs once per CPU_SLICE_NS and compares the thread CPU time to the host time,
+ *       without a limit only ten times less often, for the statistics.
+ *       Excess usage is paid back by sleeping, but only up to the next scheduled event,
+ *       so that 200 Hz, VBL and MFP timers are delivered in time. While in debt, the
+ *       check is repeated after a short time, when the guest had handled the interrupt.
+ *       Input wakes the thread early, see OS_SetEvent().
+ *
+ ************************************************************************************************/
+void CMagiC::CpuLimitEvent(void *param, unsigned nLost)
+{
+    (void) nLost;
+    CMagiC *pThis = (CMagiC *) param;
+
+    uint64_t cpu = ThreadCpuNs();
+    uint64_t host = CEventScheduler::hostNow();
+    uint64_t dCpu = cpu - pThis->m_CpuLastNs;
+    uint64_t dHost = host - pThis->m_HostLastNs;
+    pThis->m_CpuLastNs = cpu;
+    pThis->m_HostLastNs = host;
+    if (dHost == 0)
+    {
+        dHost = 1;
+    }
+
+    unsigned limit = pThis->m_CpuStats.limit;
+    unsigned usage = (unsigned) (dCpu * 100 / dHost);
+    pThis->m_CpuStats.usage = (pThis->m_CpuStats.usage * 7 + usage) / 8;
+    if (limit == 0)
+    {
+        CEventScheduler::schedule(&pThis->m_CpuLimitEvent, CPU_SLICE_NS * 10);
+        return;
+    }
+
+    // idle time is credited for at most one slice
+    int64_t debt = pThis->m_CpuDebtNs + (int64_t) dCpu - (int64_t) (dHost * limit / 100);
+    if (debt < -(int64_t) CPU_SLICE_NS)
+    {
+        debt = -(int64_t) CPU_SLICE_NS;
+    }
+    else
+    if (debt > (int64_t) CPU_DEBT_MAX_NS)
+    {
+        debt = CPU_DEBT_MAX_NS;
+    }
+    pThis->m_CpuDebtNs = debt;
+
+    uint64_t delay = CPU_SLICE_NS;
+    if (debt > 0)
+    {
+        // sleeping for <t> pays back <t> * limit
+        uint64_t deadline = host + (uint64_t) debt * 100 / limit;
+        uint64_t next = CEventScheduler::nextHostDeadline();
+        if (next < deadline)
+        {
+            deadline = next;
+        }
+        if (deadline > host)
+        {
+            uint32_t eventFlags;
+            pThis->OS_WaitForEventUntil(&pThis->m_InterruptEventsId, &eventFlags, deadline);
+            pThis->m_CpuStats.throttles++;
+            pThis->m_CpuStats.throttledNs += CEventScheduler::hostNow() - host;
+        }
+        delay = CPU_SLICE_NS / 10;
+    }
+    CEventScheduler::schedule(&pThis->m_CpuLimitEvent, delay);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get the host CPU usage of the emulator thread
+ *
+ * @param[out] stats        limit, usage and throttling since the thread start
+ *
+ ************************************************************************************************/
+void CMagiC::GetCpuStats(CpuStats *stats)
+{
+    *stats = m_CpuStats;
+    uint64_t dHost = m_HostLastNs - m_HostStartNs;
+    stats->avgUsage = (dHost != 0) ? (unsigned) ((m_CpuLastNs - m_CpuStartNs) * 100 / dHost) : 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief The 68k code waits for an interrupt, save host CPU
+ *
+ * @param[in] bTickless  the 68k code waits for events, 200 Hz and VBL may be delayed
+ *
+ * @note Returns at the time of the next scheduled event or on a message (keyboard,
+ *       mouse, network, ...). In warp mode the time is skipped instead.
+ *
+ ************************************************************************************************/
+void CMagiC::WaitForInterrupt(bool bTickless)
+{
+    uint32_t eventFlags;
+    uint64_t deadline;
+
+    if (CEventScheduler::idle(&deadline, bTickless))
+    {
+        OS_WaitForEventUntil(
+                    &m_InterruptEventsId,
+                    &eventFlags,
+                    deadline);
+    }
+}
+
+
+/**********************************************************************
+*
+* Switch the 68k emulator between production and debug core
+* The emulator must not be running.
+*
+**********************************************************************/
+
+void CMagiC::setDebugCore(bool bDebug)
+{
+    DebugWarning2("() - 68k emulator runs %s core", bDebug ? "debug" : "production");
+    m68k_SetDebugCore(bDebug);
+    setDebugMem68k(bDebug);
 }
 
 
@@ -1304,11 +1629,19 @@ int CMagiC::EmuThread( void )
     bool bNewBstate[2];
     bool bNewMpos;
     bool bNewKey;
-    bool bNewJoystick;
 
 
     m_bEmulatorIsRunning = true;
 
+    // 200 Hz und VBL, die Interrupts werden im Emulator-Thread ausgelöst
+    CEventScheduler::schedule(&m_Hz200Event, HZ200_PERIOD_NS, HZ200_PERIOD_NS);
+    CEventScheduler::schedule(&m_VblEvent, VBL_PERIOD_NS, VBL_PERIOD_NS);
+
+    // Messung und ggf. Begrenzung der Host-CPU-Last
+    m_CpuLastNs = m_CpuStartNs = ThreadCpuNs();
+    m_HostLastNs = m_HostStartNs = CEventScheduler::hostNow();
+    CEventScheduler::schedule(&m_CpuLimitEvent, CPU_SLICE_NS);
+
     for (;;)
     {
 
@@ -1332,9 +1665,23 @@ int CMagiC::EmuThread( void )
             }
         }
 
-        // längere Ausführungsphase
+        // Wechsel zwischen Produktions- und Debug-Kern
+
+        if ((sDebugCoreRequested != 0) != (m68k_GetDebugCore() != 0))
+        {
+            setDebugCore(sDebugCoreRequested != 0);
+        }
+
+        // Wechsel zwischen Echtzeit und Warp-Modus
+
+        if (m_bWarpRequested != CEventScheduler::isWarp())
+        {
+            DebugWarning2("() - 68k emulator runs in %s", m_bWarpRequested ? "warp mode" : "real time");
+            CEventScheduler::setWarp(m_bWarpRequested);
+        }
+
+        // längere Ausführungsphase, Interrupts werden dabei vom 68k-Kern angenommen
 
-        m_bWaitEmulatorForIRQCallback = false;
         m68k_execute();
 
         // Bildschirmadressen geändert
@@ -1349,15 +1696,6 @@ int CMagiC::EmuThread( void )
         if (do_not_interrupt_68k)
         {
             continue;
-            // TODO: replace with bit vector
-            /*
-            m_bBusErrorPending = false;
-            m_bInterruptPending = false;
-            m_bInterruptMouseKeyboardPending = false;
-            m_bInterruptMouseKeyboardPending = false;
-            m_bInterrupt200HzPending = false;
-            m_bInterruptVBLPending = false;
-            */
         }
 #endif
 
@@ -1368,124 +1706,56 @@ int CMagiC::EmuThread( void )
             m_bBusErrorPending = false;
         }
 
-        // ausstehende Interrupts bearbeiten
-        if (m_bInterruptPending)
+        // aufgelaufene Maus- und Tastatur-Interrupts bearbeiten
+        // Das Flag wird zuerst gelöscht, spätere Eingaben setzen es erneut.
+
+        if (m_bInterruptMouseKeyboardPending.exchange(false))
         {
-            m_bWaitEmulatorForIRQCallback = true;
-            do
-            {
-                m68k_execute();        // warte bis IRQ-Callback
-            }
-            while(m_bInterruptPending && !OS_AskEvent(&m_EventId, EMU_EVNT_TERM));
-        }
+            /*
+            * Mouse buttons
+            */
 
-        // aufgelaufene Maus-Interrupts bearbeiten
+            bNewBstate[0] = CMagiCMouse::setNewButtonState(0, m_bInterruptMouseButton[0]);
+            bNewBstate[1] = CMagiCMouse::setNewButtonState(1, m_bInterruptMouseButton[1]);
 
-        if (m_bInterruptMouseKeyboardPending)
-        {
-            OS_EnterCriticalRegion(&m_KbCriticalRegionId);
-            if (GetKbBufferFree() < 3)
+            /*
+            * Mouse movement, merged since the last interrupt
+            */
+
+            if (Preferences::bRelativeMouse)
             {
-                DebugError2("() --- Tastenpuffer ist voll");
+                bNewMpos = CMagiCMouse::setNewMovement(
+                                (double) m_InterruptMouseMoveX.exchange(0) / MOUSE_MOVE_SCALE,
+                                (double) m_InterruptMouseMoveY.exchange(0) / MOUSE_MOVE_SCALE);
             }
             else
             {
-                /*
-                * Mouse buttons
-                */
-
-                bNewBstate[0] = CMagiCMouse::setNewButtonState(0, m_bInterruptMouseButton[0]);
-                bNewBstate[1] = CMagiCMouse::setNewButtonState(1, m_bInterruptMouseButton[1]);
-
-                /*
-                * Mouse movement
-                */
-
-                if (Preferences::bRelativeMouse)
-                {
-                    bNewMpos = CMagiCMouse::setNewMovement(m_InterruptMouseMoveRelX, m_InterruptMouseMoveRelY);
-                }
-                else
-                {
-                    bNewMpos = CMagiCMouse::setNewPosition(m_InterruptMouseWhereX, m_InterruptMouseWhereY);
-                }
-
-                /*
-                * Keyboard
-                */
-
-                bNewKey = (m_pKbRead != m_pKbWrite);
-
-                /*
-                * Joystick
-                */
-
-                bNewJoystick = m_bInterruptJoystickButtons;
-                m_bInterruptJoystickButtons = false;
-
-                if (bNewBstate[0] || bNewBstate[1] || bNewMpos || bNewKey || bNewJoystick)
-                {
-                    // The "no kbd/mouse data" error occurs with 0 0 1 0:
-                    // DebugInfo2("() -- ikbd pending = %u %u %u %u", bNewBstate[0], bNewBstate[1], bNewMpos, bNewKey);
-                    // Interrupt-Vektor 70 für Tastatur/MIDI mitliefern
-                    m_bInterruptPending = true;
-                    m68k_set_irq(M68K_IRQ_6);    // autovector interrupt 70
-                }
+                unsigned where = m_InterruptMouseWhere;
+                bNewMpos = CMagiCMouse::setNewPosition((int) (where >> 16), (int) (where & 0xffff));
             }
-            m_bInterruptMouseKeyboardPending = false;
 
-/*
-            errl = MPResetEvent(            // kein "pending kb interrupt"
-                    m_InterruptEventsId,
-                    EMU_INTPENDING_KBMOUSE);
-*/
-            OS_ExitCriticalRegion(&m_KbCriticalRegionId);
-            m_bWaitEmulatorForIRQCallback = true;
-            while(m_bInterruptPending && !OS_AskEvent(&m_EventId, EMU_EVNT_TERM))
-            {
-                m68k_execute();        // warte bis IRQ-Callback
-            }
-        }
+            /*
+            * Keyboard and joystick
+            */
 
-        // aufgelaufene 200Hz-Interrupts bearbeiten
+            bNewKey = !m_KbQueue.isEmpty();
 
-        if (m_bInterrupt200HzPending)
-        {
-            m_bInterrupt200HzPending = false;
-/*
-            errl = MPResetEvent(            // kein "pending kb interrupt"
-                    m_InterruptEventsId,
-                    EMU_INTPENDING_200HZ);
-*/
-            m_bInterruptPending = true;
-            m_bWaitEmulatorForIRQCallback = true;
-            m68k_set_irq(M68K_IRQ_5);        // autovector interrupt 69
-            while(m_bInterruptPending && !OS_AskEvent(&m_EventId, EMU_EVNT_TERM))
+            if (!bNewBstate[0] && !bNewBstate[1] && !bNewMpos)
             {
-                m68k_execute();        // warte bis IRQ-Callback
+                // the mouse events did not change anything
+                m_MouseEventNs = 0;
             }
-        }
 
-        // aufgelaufene VBL-Interrupts bearbeiten
-
-        if (m_bInterruptVBLPending)
-        {
-            m_bInterruptVBLPending = false;
-/*
-            errl = MPResetEvent(            // kein "pending kb interrupt"
-                    m_InterruptEventsId,
-                    EMU_INTPENDING_VBL);
-*/
-            m_bInterruptPending = true;
-            m_bWaitEmulatorForIRQCallback = true;
-            m68k_set_irq(M68K_IRQ_4);
-            while(m_bInterruptPending && !OS_AskEvent(&m_EventId, EMU_EVNT_TERM))
+            if (bNewBstate[0] || bNewBstate[1] || bNewMpos || bNewKey)
             {
-                m68k_execute();        // warte bis IRQ-Callback
+                // The "no kbd/mouse data" error occurs with 0 0 1 0:
+                // DebugInfo2("() -- ikbd pending = %u %u %u", bNewBstate[0], bNewBstate[1], bNewMpos, bNewKey);
+                // MFP-Interrupt 6 für Tastatur/MIDI, Vektor 70
+                CMagiCMfp::requestInterrupt(MFP_INT_ACIA);
             }
         }
 
-        // ggf. Druckdatei abschließen
+        // ggf. Druckdatei abschließen, mindestens einmal pro Sekunde, see Hz200Event()
 
         if (*((uint32_t *)(mem68k +_hz_200)) - CMagiCPrint::s_LastPrinterAccess > 200 * 10)
         {
@@ -1504,71 +1774,42 @@ int CMagiC::EmuThread( void )
 }
 
 
-/**********************************************************************
-*
-* (statisch) IRQ-Callback.
-*
-**********************************************************************/
-
-int CMagiC::IRQCallback(int IRQLine)
+/** **********************************************************************************************
+ *
+ * @brief GUI thread: input data have arrived, let the emulator thread raise an interrupt
+ *
+ * @note Only the first event leaves the 68k core and wakes the emulator thread, further ones
+ *       are merged into the same interrupt, e.g. a series of mouse movements.
+ *
+ ************************************************************************************************/
+void CMagiC::InputPending(void)
 {
-    CMagiC *cm = (CMagiC *) pTheMagiC;
-    // Interrupt-Leitungen zurücksetzen
-    m68k_clear_irq(IRQLine);
-    //Asgard68000SetIRQLine(IRQLine, k68000IRQStateClear);
-    // Verarbeitung bestätigen
-    cm->m_bInterruptPending = false;
-    if (cm->m_bWaitEmulatorForIRQCallback)
-        m68k_StopExecution();
-
-    if (IRQLine == M68K_IRQ_5)
-        return 69;        // autovector
-    else
-    if (IRQLine == M68K_IRQ_6)
-        return 70;        // autovector
-    else
-
-    // dieser Rückgabewert sollte die Interrupt-Anforderung löschen
-    return M68K_INT_ACK_AUTOVECTOR;
-}
-
-
-/**********************************************************************
-*
-* privat: Freien Platz in Tastaturpuffer ermitteln
-*
-**********************************************************************/
+    if (m_bInterruptMouseKeyboardPending.exchange(true))
+    {
+        m_InputCoalesced++;
+        return;
+    }
 
-int CMagiC::GetKbBufferFree( void )
-{
-    int nCharsInBuffer;
+    CEventScheduler::postStop();
 
-    nCharsInBuffer = (m_pKbRead <= m_pKbWrite) ?
-                            (m_pKbWrite - m_pKbRead) :
-                            (KEYBOARDBUFLEN - (m_pKbRead - m_pKbWrite));
-    return(KEYBOARDBUFLEN - nCharsInBuffer - 1);
+    // wake up emulator, if in "idle task"
+    OS_SetEvent(
+            &m_InterruptEventsId,
+            EMU_INTPENDING_KBMOUSE);
 }
 
 
-/**********************************************************************
-*
-* Called from both SDL event loop thread and emulation thread.
-* Make sure to before call OS_EnterCriticalRegion(&m_KbCriticalRegionId);
-* and afterwards OS_ExitCriticalRegion(&m_KbCriticalRegionId);
-*
-* privat: Zeichen in Tastaturpuffer einfügen.
-*
-* Es muß VORHER sichergestellt werden, daß genügend Platz ist.
-*
-**********************************************************************/
-
-void CMagiC::PutKeyToBuffer(uint8_t key)
+/** **********************************************************************************************
+ *
+ * @brief GUI thread: remember the time of the oldest mouse event that the Atari has not read
+ *
+ * @param[in]  eventNs      host time of the event, see CInputLatency, 0: now
+ *
+ ************************************************************************************************/
+void CMagiC::MouseEvent(uint64_t eventNs)
 {
-    *m_pKbWrite++ = key;
-    if (m_pKbWrite >= m_cKeyboardOrMouseData + KEYBOARDBUFLEN)
-    {
-        m_pKbWrite = m_cKeyboardOrMouseData;    // wrap
-    }
+    uint64_t expected = 0;
+    (void) m_MouseEventNs.compare_exchange_strong(expected, (eventNs != 0) ? eventNs : CInputLatency::now());
 }
 
 
@@ -1610,13 +1851,14 @@ void CMagiC::sendShutdown(void)
  *
  * @param[in]  sdlScanCode      SDL key scan code
  * @param[in]  KeyUp            true: up, false: down
+ * @param[in]  eventNs          host time of the event, see CInputLatency, 0: now
  *
  * @return non-zero, if keyboard buffer is full
  *
  * @note Called from main event loop
  *
  ************************************************************************************************/
-int CMagiC::sendSdlKeyboard(int sdlScanCode, bool keyUp)
+int CMagiC::sendSdlKeyboard(int sdlScanCode, bool keyUp, uint64_t eventNs)
 {
     unsigned char val;
 
@@ -1629,20 +1871,11 @@ int CMagiC::sendSdlKeyboard(int sdlScanCode, bool keyUp)
     {
         //    CDebug::DebugInfo2("() --- message == %08x, keyUp == %d", message, (int) keyUp);
 
-        OS_EnterCriticalRegion(&m_KbCriticalRegionId);
-        if (GetKbBufferFree() < 1)
-        {
-            OS_ExitCriticalRegion(&m_KbCriticalRegionId);
-            DebugError2("() -- keyboard buffer full. Ignore key press");
-            return 1;
-        }
-
         // Convert from SDL to Atari scancode
 
         val = CMagiCKeyboard::SdlScanCode2AtariScanCode(sdlScanCode);
         if (!val)
         {
-            OS_ExitCriticalRegion(&m_KbCriticalRegionId);
             DebugError2("() -- unknown key. Ignore key press");
             return 0;
         }
@@ -1652,18 +1885,15 @@ int CMagiC::sendSdlKeyboard(int sdlScanCode, bool keyUp)
             val |= 0x80;
         }
 
-        PutKeyToBuffer(val);
+        if (!m_KbQueue.put(&val, 1, (eventNs != 0) ? eventNs : CInputLatency::now()))
+        {
+            DebugError2("() -- keyboard buffer full. Ignore key press");
+            return 1;
+        }
 
         // interrupt vector 70 for keyboard/MIDI
 
-        m_bInterruptMouseKeyboardPending = true;
-        m68k_StopExecution();
-
-        OS_SetEvent(            // wake up if idle
-                    &m_InterruptEventsId,
-                    EMU_INTPENDING_KBMOUSE);
-
-        OS_ExitCriticalRegion(&m_KbCriticalRegionId);
+        InputPending();
     }
 
     return 0;    // OK
@@ -1784,7 +2014,7 @@ int CMagiC::SendKeyboardShift( uint32_t modifiers )
         if (done)
         {
             m_bInterruptMouseKeyboardPending = true;
-            m68k_StopExecution();
+            CEventScheduler::postStop();
         }
 
         OS_SetEvent(            // aufwecken, wenn in "idle task"
@@ -1807,7 +2037,7 @@ int CMagiC::SendKeyboardShift( uint32_t modifiers )
 *
 **********************************************************************/
 
-int CMagiC::sendMousePosition(int x, int y)
+int CMagiC::sendMousePosition(int x, int y, uint64_t eventNs)
 {
 #ifdef _DEBUG_NO_ATARI_MOUSE_INTERRUPTS
     return 0;
@@ -1820,18 +2050,15 @@ int CMagiC::sendMousePosition(int x, int y)
         if (y < 0)
             y = 0;
 
-        OS_EnterCriticalRegion(&m_KbCriticalRegionId);
-        m_InterruptMouseWhereX = x;
-        m_InterruptMouseWhereY = y;
-        m_bInterruptMouseKeyboardPending = true;
-        m68k_StopExecution();
-
-        // wake up emulator, if in "idle task"
-        OS_SetEvent(
-                &m_InterruptEventsId,
-                EMU_INTPENDING_KBMOUSE);
+        if (x > 0xffff)
+            x = 0xffff;
+        if (y > 0xffff)
+            y = 0xffff;
 
-        OS_ExitCriticalRegion(&m_KbCriticalRegionId);
+        // only the last position counts
+        m_InterruptMouseWhere = ((unsigned) x << 16) | (unsigned) y;
+        MouseEvent(eventNs);
+        InputPending();
     }
 
     return 0;    // OK
@@ -1845,22 +2072,15 @@ int CMagiC::sendMousePosition(int x, int y)
 * Rückgabe != 0, wenn die letzte Nachricht noch aussteht.
 *
 **********************************************************************/
-int CMagiC::sendMouseMovement(double xrel, double yrel)
+int CMagiC::sendMouseMovement(double xrel, double yrel, uint64_t eventNs)
 {
     if (m_bEmulatorIsRunning)
     {
-        OS_EnterCriticalRegion(&m_KbCriticalRegionId);
-        m_InterruptMouseMoveRelX = xrel;
-        m_InterruptMouseMoveRelY = yrel;
-        m_bInterruptMouseKeyboardPending = true;
-        m68k_StopExecution();
-
-        // wake up emulator, if in "idle task"
-        OS_SetEvent(
-                &m_InterruptEventsId,
-                EMU_INTPENDING_KBMOUSE);
-
-        OS_ExitCriticalRegion(&m_KbCriticalRegionId);
+        // movements are added up until the emulator thread takes them
+        m_InterruptMouseMoveX += (int) lround(xrel * MOUSE_MOVE_SCALE);
+        m_InterruptMouseMoveY += (int) lround(yrel * MOUSE_MOVE_SCALE);
+        MouseEvent(eventNs);
+        InputPending();
     }
 
     return 0;    // OK
@@ -1878,7 +2098,7 @@ int CMagiC::sendMouseMovement(double xrel, double yrel)
 *
 **********************************************************************/
 
-int CMagiC::sendMouseButton(unsigned int NumOfButton, bool bIsDown)
+int CMagiC::sendMouseButton(unsigned int NumOfButton, bool bIsDown, uint64_t eventNs)
 {
 #ifdef _DEBUG_NO_ATARI_MOUSE_INTERRUPTS
     return 0;
@@ -1892,7 +2112,6 @@ int CMagiC::sendMouseButton(unsigned int NumOfButton, bool bIsDown)
             return 1;
         }
 
-        OS_EnterCriticalRegion(&m_KbCriticalRegionId);
 #if 0
         if (!Preferences::KeyCodeForRightMouseButton)
         {
@@ -1928,15 +2147,8 @@ int CMagiC::sendMouseButton(unsigned int NumOfButton, bool bIsDown)
             m_bInterruptMouseButton[NumOfButton] = bIsDown;
         }
 
-        m_bInterruptMouseKeyboardPending = true;
-        m68k_StopExecution();
-
-        // wake up emulator, if in "idle task"
-        OS_SetEvent(
-                &m_InterruptEventsId,
-                EMU_INTPENDING_KBMOUSE);
-
-        OS_ExitCriticalRegion(&m_KbCriticalRegionId);
+        MouseEvent(eventNs);
+        InputPending();
     }
 
     return 0;    // OK
@@ -1955,111 +2167,22 @@ int CMagiC::sendJoystickState(uint8_t header, uint8_t state0, uint8_t state1)
 {
     if (m_bEmulatorIsRunning)
     {
-        OS_EnterCriticalRegion(&pTheMagiC->m_KbCriticalRegionId);
-
-        pTheMagiC->PutKeyToBuffer(header);    // 0xfd
-        pTheMagiC->PutKeyToBuffer(state0);    // joystick 0: bits 0..3: directions, bit 7: fire
-        pTheMagiC->PutKeyToBuffer(state1);    // joystick 1: bits 0..3: directions, bit 7: fire
-
-        m_bInterruptJoystickButtons = true;
-        m_bInterruptMouseKeyboardPending = true;
-
-        m68k_StopExecution();
-
-        // wake up emulator, if in "idle task"
-        OS_SetEvent(
-                &m_InterruptEventsId,
-                EMU_INTPENDING_KBMOUSE);
-
-        OS_ExitCriticalRegion(&m_KbCriticalRegionId);
-    }
-
-    return 0;    // OK
-}
-
-
-/**********************************************************************
-*
-* 200Hz-Timer auslösen.
-*
-* Wird im Interrupt aufgerufen!
-*
-* Löst einen 68k-Interrupt 5 aus (abweichend vom Atari, da ist es Interrupt 6,
-* der Interruptvektor 69 ist aber derselbe).
-*
-**********************************************************************/
-
-int CMagiC::sendHz200(void)
-{
-#ifdef _DEBUG_NO_ATARI_HZ200_INTERRUPTS
-    return 0;
-#endif
-
-    if (m_bEmulatorIsRunning)
-    {
-        /*
-         is of no use, because guest calls: "jsr v_clswk" to close VDI, no more redraws!
-
-        if (m_AtariShutDownDelay)
+        const uint8_t packet[3] =
         {
-            // delayed shutdown
-            m_AtariShutDownDelay--;
-            //atomic_store(p_bVideoBufChanged, true);
-            if (!m_AtariShutDownDelay)
-            {
-                DebugInfo2("() -- execute delayed shutdown");
+            header,     // 0xfd
+            state0,     // joystick 0: bits 0..3: directions, bit 7: fire
+            state1      // joystick 1: bits 0..3: directions, bit 7: fire
+        };
 
-                // Emulator-Thread anhalten
-                pTheMagiC->m_bCanRun = false;
-                //    pTheMagiC->m_bAtariWasRun = false;    (entf. 4.11.07)
-
-                // setze mir selbst einen Event zum Beenden (4.11.07)
-                &OS_SetEvent(
-                            pTheMagiC->m_EventId,
-                            EMU_EVNT_TERM);
-                return 0;
-            }
+        if (!m_KbQueue.put(packet, sizeof(packet), CInputLatency::now()))
+        {
+            DebugError2("() -- keyboard buffer full. Ignore joystick state");
+            return 1;
         }
-         */
-
-        m_bInterrupt200HzPending = true;
-        m68k_StopExecution();
 
-        // wake up emulator, if in "idle task"
-        OS_SetEvent(
-            &m_InterruptEventsId,
-            EMU_INTPENDING_200HZ);
+        InputPending();
     }
-    return 0;    // OK
-}
-
-
-/**********************************************************************
-*
-* VBL auslösen.
-*
-* Wird im Interrupt aufgerufen!
-*
-* Löst einen 68k-Interrupt 4 aus.
-*
-**********************************************************************/
-
-int CMagiC::sendVBL(void)
-{
-#ifdef _DEBUG_NO_ATARI_VBL_INTERRUPTS
-    return 0;
-#endif
-
-    if (m_bEmulatorIsRunning)
-    {
-        m_bInterruptVBLPending = true;
-        m68k_StopExecution();
 
-        // wake up emulator, if in "idle task"
-        OS_SetEvent(
-            &m_InterruptEventsId,
-            EMU_INTPENDING_VBL);
-    }
     return 0;    // OK
 }
 
@@ -2088,10 +2211,8 @@ uint32_t CMagiC::AtariInit(uint32_t params, uint8_t *addrOffset68k)
 uint32_t CMagiC::AtariBIOSInit(uint32_t params, uint8_t *addrOffset68k)
 {
     DebugInfo2("() - ATARI: BIOS initialisation done.");
-#if defined(M68K_BREAKPOINTS)
-    m68k_breakpoints[0][0] = 0x7c9bf8 + 0x1F5E;   // VsetRGB
-    m68k_breakpoints[0][1] = m68k_breakpoints[0][0] + 16;   // range
-#endif
+    //m68k_breakpoints[0][0] = 0x7c9bf8 + 0x1F5E;   // VsetRGB
+    //m68k_breakpoints[0][1] = m68k_breakpoints[0][0] + 16;   // range
     (void) params;
     (void) addrOffset68k;
     return 0;
@@ -2107,7 +2228,7 @@ uint32_t CMagiC::AtariBIOSInit(uint32_t params, uint8_t *addrOffset68k)
 uint32_t CMagiC::AtariVdiInit(uint32_t params, uint8_t *addrOffset68k)
 {
     DebugInfo2("() - ATARI: VDI initialisation done.");
-#if defined(M68K_BREAKPOINTS)
+#if 0
     //breakpoint = 0x007c9c68 + 0x5cf2;   // Pdkill TODO: remove, if done
     //breakpoint2 = 0x007c9c68 + 0x651c;   // Pexec
     //breakpoint3 = 0x007c9c68 + 0x1e4ee;   // pgml_term
@@ -2313,6 +2434,7 @@ uint32_t CMagiC::AtariSetscreen(uint32_t params, uint8_t *addrOffset68k)
         {
             DebugWarning2("() -- physical screen address reset to 0x%08x", phys);
             CMagiCScreen::m_physAddr = 0;
+            CMagiCScreen::setAllDirty();
         }
         else
         if (phys > mem68kSize - 32000)
@@ -2322,6 +2444,7 @@ uint32_t CMagiC::AtariSetscreen(uint32_t params, uint8_t *addrOffset68k)
         else
         {
             CMagiCScreen::m_physAddr = phys;
+            CMagiCScreen::setAllDirty();
             DebugWarning2("() -- changing of physical screen to 0x%08x is experimental", phys);
         }
     }
@@ -2380,8 +2503,7 @@ uint32_t CMagiC::AtariSetpalette(uint32_t params, uint8_t *addrOffset68k)
         CMagiCScreen::setColourPaletteEntry(i, ac);
     }
 
-    // tell GUI thread to update the screen
-    atomic_store(&gbAtariVideoBufChanged, true);
+    // the GUI thread redraws the lines with changed colours, see setColourPaletteEntry()
     return 0;
 }
 
@@ -2467,7 +2589,7 @@ uint32_t CMagiC::AtariVsetRGB(uint32_t params, uint8_t *addrOffset68k)
 
     uint32_t *pColourTable = CMagiCScreen::m_pColourTable + index;
     unsigned j = MIN(MAGIC_COLOR_TABLE_LEN, index + cnt);
-    for (unsigned i = index; i < j; i++, pValues += 4,pColourTable++)
+    for (unsigned i = index; i < j; i++, pValues += 4, pColourTable++)
     {
         // Atari: 00rrggbb
         // 0xff000000        black
@@ -2488,22 +2610,23 @@ uint32_t CMagiC::AtariVsetRGB(uint32_t params, uint8_t *addrOffset68k)
             DebugWarning2("() -- suppressed setting colour #3 to yellow (NVDI bug workaround, round %u/2)", 2 - bHacked + 1);
             c = *pColourTable;  // value unchanged
             bHacked--;
-            #if defined(M68K_TRACE)
             static int done = 0;
-            if (!done)
+            if (!done && m68k_GetDebugCore())
             {
                 m68k_trace_print();
                 done = 1;
             }
-            #endif
         }
         #endif
-        *pColourTable++ = c | (0xff000000);
+        c |= 0xff000000;
+        if (*pColourTable != c)
+        {
+            *pColourTable = c;
+            // tell GUI thread to redraw the lines with this colour
+            CMagiCScreen::setPaletteDirty(i, 1);
+        }
     }
 
-    // tell GUI thread to update the screen
-    atomic_store(&gbAtariVideoBufChanged, true);
-
     return 0;
 }
 
@@ -3321,7 +3444,6 @@ uint32_t CMagiC::AtariYield(uint32_t params, uint8_t *addrOffset68k)
     {
         uint32_t num;
     } __attribute__((packed));
-    uint32_t eventFlags;
 
 
     /*
@@ -3337,14 +3459,39 @@ uint32_t CMagiC::AtariYield(uint32_t params, uint8_t *addrOffset68k)
 
     // Save host CPU and wait for events (keyboard, mouse, timer, ...)
 
-    pTheMagiC->OS_WaitForEvent(
-                &pTheMagiC->m_InterruptEventsId,
-                &eventFlags);
+    pTheMagiC->WaitForInterrupt(true);
 
     return 0;
 }
 
 
+/** **********************************************************************************************
+ *
+ * @brief 68k emulator callback: CPU spins in an idle loop
+ *
+ * @param[in] pc        68k start address of the loop
+ * @param[in] count     number of calls for this loop, 0: unknown
+ *
+ * @note The loop only tests memory that may be changed by an interrupt, e.g. a
+ *       variable set by a timer handler, so wait for the next one like AtariYield().
+ *
+ ************************************************************************************************/
+void CMagiC::IdleLoopCallback(unsigned pc, unsigned count)
+{
+    (void) pc;
+    if (count == 1)
+    {
+        const char *procName;
+        uint32_t act_pd;
+        GetActAtariPrg(&procName, &act_pd);
+        DebugInfo2("() - 68k idle loop at 0x%08x by process %s", pc, (procName != nullptr) ? procName : "<unknown>");
+    }
+
+    // the loop may poll _hz_200, do not delay it
+    pTheMagiC->WaitForInterrupt(false);
+}
+
+
 /** **********************************************************************************************
  *
  * @brief Emulator callback: get keyboard and mouse data
@@ -3364,31 +3511,28 @@ uint32_t CMagiC::AtariGetKeyboardOrMouseData(uint32_t params, uint8_t *addrOffse
 {
     (void) addrOffset68k;
 
-    OS_EnterCriticalRegion(&m_KbCriticalRegionId);
-    uint32_t ret = m_pKbRead != m_pKbWrite;        // any data in buffer?
+    // the rest of a mouse packet comes first, it must not be interleaved with keys
+    uint32_t ret = (m_MousePacketPos < sizeof(m_MousePacket)) || !m_KbQueue.isEmpty();     // any data?
 
     // If no data in buffer, query mouse buttons and position
     if (!ret)
     {
         // No mouse handling before VDI initialisation
-        int8_t buf[3];
         if (m_LineAVars != nullptr)
         {
-            ret = CMagiCMouse::getNewPositionAndButtonState(buf);
+            ret = CMagiCMouse::getNewPositionAndButtonState(m_MousePacket);
         }
 
         if (ret)
         {
-            PutKeyToBuffer((uint8_t) buf[0]);
-            PutKeyToBuffer((uint8_t) buf[1]);
-            PutKeyToBuffer((uint8_t) buf[2]);
+            m_MousePacketPos = 0;
+            CInputLatency::consumed(INPUTLAT_MOUSE_TO_GUEST, m_MouseEventNs.exchange(0));
         }
     }
 
     if (params)
     {
         // key was processed by kernel, end of interrupt handler
-        OS_ExitCriticalRegion(&m_KbCriticalRegionId);
 
         // Clear "interrupt service bit", if any
         //  if (!ret)
@@ -3398,19 +3542,22 @@ uint32_t CMagiC::AtariGetKeyboardOrMouseData(uint32_t params, uint8_t *addrOffse
 
     if (!ret)
     {
-        OS_ExitCriticalRegion(&m_KbCriticalRegionId);
         // no data to process
         return 0;  // no mouse or keyboard events to process, note that caller must explicitly ignore zeros
     }
 
-    // read byte from mouse/keyboard ringbuffer
-    ret = *m_pKbRead++;
-    if (m_pKbRead >= m_cKeyboardOrMouseData + KEYBOARDBUFLEN)
+    // read byte from mouse packet or keyboard queue
+    if (m_MousePacketPos < sizeof(m_MousePacket))
     {
-        m_pKbRead = m_cKeyboardOrMouseData;
+        return (uint8_t) m_MousePacket[m_MousePacketPos++];
     }
-    OS_ExitCriticalRegion(&m_KbCriticalRegionId);
-    return ret;
+    uint8_t c = 0;
+    uint64_t eventNs = 0;
+    if (m_KbQueue.get(&c, &eventNs))
+    {
+        CInputLatency::consumed(INPUTLAT_KEY_TO_GUEST, eventNs);
+    }
+    return c;
 }
 
 
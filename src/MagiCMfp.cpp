@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* MFP 68901 interrupt controller and timers
+*
+* The MFP channels are delivered on 68k interrupt level 6, the vector is
+* taken from the vector register when the level is acknowledged. Timers A, B
+* and D are emulated in delay mode, driven by the event scheduler. Event
+* count and pulse width mode have no input signal here, so the timer stops.
+* Timer C remains the 200 Hz system clock, which MagiC takes on level 5, see
+* CMagiC::Hz200Event(), its registers are only stored.
+*
+* All functions are called from the emulator thread.
+*
+*/
+
+#include "config.h"
+// system headers
+#include <string.h>
+// program headers
+#include "Debug.h"
+#include "Globals.h"
+#include "MagiCMfp.h"
+
+#define MFP_TIMER_A     0
+#define MFP_TIMER_B     1
+#define MFP_TIMER_C     2
+#define MFP_TIMER_D     3
+
+// interrupt channel of timer A..D
+static const unsigned timerChannel[4] = { MFP_INT_TIMER_A, MFP_INT_TIMER_B, MFP_INT_TIMER_C, MFP_INT_TIMER_D };
+// prescaler for delay mode 1..7
+static const unsigned prescale[8] = { 0, 4, 10, 16, 50, 64, 100, 200 };
+
+uint16_t CMagiCMfp::m_ier;
+uint16_t CMagiCMfp::m_ipr;
+uint16_t CMagiCMfp::m_isr;
+uint16_t CMagiCMfp::m_imr;
+uint8_t CMagiCMfp::m_gpip;
+uint8_t CMagiCMfp::m_aer;
+uint8_t CMagiCMfp::m_ddr;
+uint8_t CMagiCMfp::m_vr;
+uint8_t CMagiCMfp::m_ctrl[4];
+uint8_t CMagiCMfp::m_data[4];
+uint8_t CMagiCMfp::m_count[4];
+SchedEvent CMagiCMfp::m_event[4];
+
+
+/** **********************************************************************************************
+ *
+ * @brief Initialisation, after CEventScheduler::init()
+ *
+ * @note Like the MagiC kernel expects it: vectors from 0x100 on, automatic end of
+ *       interrupt, Timer C and the ACIAs enabled.
+ *
+ ************************************************************************************************/
+void CMagiCMfp::init()
+{
+    m_ier = m_imr = (1 << MFP_INT_TIMER_C) | (1 << MFP_INT_ACIA);
+    m_ipr = m_isr = 0;
+    m_gpip = m_aer = m_ddr = 0;
+    m_vr = 0x40;
+    memset(m_ctrl, 0, sizeof(m_ctrl));
+    memset(m_data, 0, sizeof(m_data));
+    memset(m_count, 0, sizeof(m_count));
+    for (unsigned timer = 0; timer < 4; timer++)
+    {
+        CEventScheduler::setup(&m_event[timer], timerEvent, (void *) (uintptr_t) timer);
+    }
+    m68k_SetIrqAckCallback(M68K_IRQ_6, ackInterrupt);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Read a register
+ *
+ * @param[in]  reg      offset to 0xfffffa00, see MFP_GPIP etc.
+ *
+ ************************************************************************************************/
+uint8_t CMagiCMfp::read(unsigned reg)
+{
+    switch(reg)
+    {
+        case MFP_GPIP:  return m_gpip;
+        case MFP_AER:   return m_aer;
+        case MFP_DDR:   return m_ddr;
+        case MFP_IERA:  return (uint8_t) (m_ier >> 8);
+        case MFP_IERB:  return (uint8_t) m_ier;
+        case MFP_IPRA:  return (uint8_t) (m_ipr >> 8);
+        case MFP_IPRB:  return (uint8_t) m_ipr;
+        case MFP_ISRA:  return (uint8_t) (m_isr >> 8);
+        case MFP_ISRB:  return (uint8_t) m_isr;
+        case MFP_IMRA:  return (uint8_t) (m_imr >> 8);
+        case MFP_IMRB:  return (uint8_t) m_imr;
+        case MFP_VR:    return m_vr;
+        case MFP_TACR:  return m_ctrl[MFP_TIMER_A];
+        case MFP_TBCR:  return m_ctrl[MFP_TIMER_B];
+        case MFP_TCDCR: return (uint8_t) ((m_ctrl[MFP_TIMER_C] << 4) | m_ctrl[MFP_TIMER_D]);
+        case MFP_TADR:  return getCount(MFP_TIMER_A);
+        case MFP_TBDR:  return getCount(MFP_TIMER_B);
+        case MFP_TCDR:  return getCount(MFP_TIMER_C);
+        case MFP_TDDR:  return getCount(MFP_TIMER_D);
+    }
+    // USART is not emulated
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Write a register
+ *
+ * @param[in]  reg      offset to 0xfffffa00, see MFP_GPIP etc.
+ * @param[in]  val      new value
+ *
+ * @note Pending and in-service bits can only be cleared. Disabling a channel also
+ *       clears its pending bit.
+ *
+ ************************************************************************************************/
+void CMagiCMfp::write(unsigned reg, uint8_t val)
+{
+    switch(reg)
+    {
+        case MFP_GPIP:  m_gpip = (uint8_t) ((m_gpip & ~m_ddr) | (val & m_ddr)); break;
+        case MFP_AER:   m_aer = val; break;
+        case MFP_DDR:   m_ddr = val; break;
+        case MFP_IERA:  m_ier = (uint16_t) ((m_ier & 0x00ff) | (val << 8)); m_ipr &= m_ier; break;
+        case MFP_IERB:  m_ier = (uint16_t) ((m_ier & 0xff00) | val); m_ipr &= m_ier; break;
+        case MFP_IPRA:  m_ipr &= (uint16_t) ((val << 8) | 0x00ff); break;
+        case MFP_IPRB:  m_ipr &= (uint16_t) (0xff00 | val); break;
+        case MFP_ISRA:  m_isr &= (uint16_t) ((val << 8) | 0x00ff); update(); break;
+        case MFP_ISRB:  m_isr &= (uint16_t) (0xff00 | val); update(); break;
+        case MFP_IMRA:  m_imr = (uint16_t) ((m_imr & 0x00ff) | (val << 8)); update(); break;
+        case MFP_IMRB:  m_imr = (uint16_t) ((m_imr & 0xff00) | val); update(); break;
+
+        case MFP_VR:
+            m_vr = val;
+            if (!(m_vr & 0x08))
+            {
+                // automatic end of interrupt
+                m_isr = 0;
+                update();
+            }
+            break;
+
+        case MFP_TACR:
+            if ((val & 0x0f) != m_ctrl[MFP_TIMER_A])
+            {
+                setTimerMode(MFP_TIMER_A, val & 0x0f);
+            }
+            break;
+
+        case MFP_TBCR:
+            if ((val & 0x0f) != m_ctrl[MFP_TIMER_B])
+            {
+                setTimerMode(MFP_TIMER_B, val & 0x0f);
+            }
+            break;
+
+        case MFP_TCDCR:
+            if (((val >> 4) & 7) != m_ctrl[MFP_TIMER_C])
+            {
+                setTimerMode(MFP_TIMER_C, (val >> 4) & 7);
+            }
+            if ((val & 7) != m_ctrl[MFP_TIMER_D])
+            {
+                setTimerMode(MFP_TIMER_D, val & 7);
+            }
+            break;
+
+        case MFP_TADR:
+        case MFP_TBDR:
+        case MFP_TCDR:
+        case MFP_TDDR:
+        {
+            unsigned timer = (reg - MFP_TADR) / 2;
+            m_data[timer] = val;
+            if (CEventScheduler::isQueued(&m_event[timer]))
+            {
+                // the running counter is reloaded with the new value when it expires
+                m_event[timer].period = ticksToNs(timer, val ? val : 256);
+            }
+            else
+            {
+                m_count[timer] = val;
+            }
+            break;
+        }
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Set an interrupt channel pending, if enabled
+ *
+ * @param[in]  channel      MFP_INT_ACIA etc.
+ *
+ ************************************************************************************************/
+void CMagiCMfp::requestInterrupt(unsigned channel)
+{
+    uint16_t bit = (uint16_t) (1 << channel);
+    if (m_ier & bit)
+    {
+        m_ipr |= bit;
+        update();
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief 68k emulator callback: interrupt level 6 is acknowledged
+ *
+ * @return vector number of the MFP channel, or M68K_INT_ACK_SPURIOUS if none is pending
+ *
+ ************************************************************************************************/
+unsigned CMagiCMfp::ackInterrupt(void)
+{
+    int channel = nextChannel();
+    if (channel < 0)
+    {
+        return M68K_INT_ACK_SPURIOUS;
+    }
+
+    uint16_t bit = (uint16_t) (1 << channel);
+    m_ipr &= ~bit;
+    if (m_vr & 0x08)
+    {
+        // software end of interrupt, lower channels wait until the bit is cleared
+        m_isr |= bit;
+    }
+    update();
+    return (m_vr & 0xf0) | (unsigned) channel;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Change the mode of a timer, i.e. stop it, or (re)start it with another prescaler
+ *
+ * @param[in]  timer        MFP_TIMER_A etc.
+ * @param[in]  mode         new value of the control register bits
+ *
+ * @note The current counter is kept, like the hardware does when changing the prescaler.
+ *       It is latched with the old prescaler, before the new mode is set.
+ *
+ ************************************************************************************************/
+void CMagiCMfp::setTimerMode(unsigned timer, unsigned mode)
+{
+    SchedEvent *ev = &m_event[timer];
+
+    if (CEventScheduler::isQueued(ev))
+    {
+        m_count[timer] = getCount(timer);
+        CEventScheduler::cancel(ev);
+    }
+    m_ctrl[timer] = (uint8_t) mode;
+
+    if ((timer != MFP_TIMER_C) && (mode >= 1) && (mode <= 7))
+    {
+        unsigned count = m_count[timer] ? m_count[timer] : 256;
+        unsigned reload = m_data[timer] ? m_data[timer] : 256;
+        CEventScheduler::schedule(ev, ticksToNs(timer, count), ticksToNs(timer, reload));
+        DebugInfo2("() - Timer %c runs with %u Hz", 'A' + timer,
+                    (unsigned) (SCHED_NS_PER_SEC / ticksToNs(timer, reload)));
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get the counter of a timer
+ *
+ * @note For a running timer it is calculated from the time of the next expiry.
+ *       A stopped timer, or one in event count or pulse width mode, keeps its counter.
+ *
+ ************************************************************************************************/
+uint8_t CMagiCMfp::getCount(unsigned timer)
+{
+    const SchedEvent *ev = &m_event[timer];
+    unsigned mode = m_ctrl[timer];
+
+    if (!CEventScheduler::isQueued(ev) || (mode == 0) || (mode > 7))
+    {
+        return m_count[timer];
+    }
+
+    uint64_t t = CEventScheduler::now();
+    uint64_t rest = (ev->when > t) ? ev->when - t : 0;
+    uint64_t nsPerTicks = prescale[mode] * SCHED_NS_PER_SEC;
+    uint64_t ticks = (rest * MFP_CLOCK_HZ + nsPerTicks - 1) / nsPerTicks;
+    if ((ticks == 0) || (ticks > 256))
+    {
+        // expiry is due, or timer period was extended to MFP_MIN_PERIOD_NS
+        ticks = (ticks == 0) ? m_data[timer] : 256;
+    }
+    return (uint8_t) ticks;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Convert timer ticks to ns, for the current prescaler
+ *
+ ************************************************************************************************/
+uint64_t CMagiCMfp::ticksToNs(unsigned timer, unsigned ticks)
+{
+    uint64_t ns = prescale[m_ctrl[timer] & 7] * ticks * SCHED_NS_PER_SEC / MFP_CLOCK_HZ;
+    return (ns < MFP_MIN_PERIOD_NS) ? MFP_MIN_PERIOD_NS : ns;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Event scheduler callback: timer expired
+ *
+ ************************************************************************************************/
+void CMagiCMfp::timerEvent(void *param, unsigned nLost)
+{
+    (void) nLost;
+    requestInterrupt(timerChannel[(uintptr_t) param]);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get the channel to be delivered next
+ *
+ * @return channel, or -1 if none is pending and unmasked or all are blocked by in-service ones
+ *
+ ************************************************************************************************/
+int CMagiCMfp::nextChannel()
+{
+    unsigned pending = m_ipr & m_imr;
+    if (pending == 0)
+    {
+        return -1;
+    }
+    int channel = 31 - __builtin_clz(pending);
+    int inService = (m_isr != 0) ? 31 - __builtin_clz(m_isr) : -1;
+    return (channel > inService) ? channel : -1;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Request interrupt level 6, if a channel can be delivered
+ *
+ ************************************************************************************************/
+void CMagiCMfp::update()
+{
+    if (nextChannel() >= 0)
+    {
+        m68k_RaiseIrq(M68K_IRQ_6);
+    }
+}
@@ -25,6 +25,7 @@
 #include "config.h"
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 #include "Debug.h"
 #include "preferences.h"
 #include "emulation_globals.h"
@@ -36,15 +37,46 @@ uint32_t CMagiCScreen::m_pColourTable[MAGIC_COLOR_TABLE_LEN];
 void *CMagiCScreen::pixels;
 unsigned CMagiCScreen::pixels_size;
 SDL_Surface *CMagiCScreen::m_sdl_atari_surface;        // surface in Atari native pixel format or NULL
-SDL_Surface *CMagiCScreen::m_sdl_host_surface;         // surface in host native pixel format
 uint32_t CMagiCScreen::m_logAddr;
 uint32_t CMagiCScreen::m_physAddr;
 uint16_t CMagiCScreen::m_res;
+ScreenUpdateStats CMagiCScreen::m_stats;
+std::atomic<uint64_t> CMagiCScreen::m_dirtyLines[MAGIC_DIRTY_WORDS];
+std::atomic_bool CMagiCScreen::m_bAllDirty;
+std::atomic<uint64_t> CMagiCScreen::m_paletteDirty[MAGIC_COLOR_TABLE_LEN / 64];
+uint64_t CMagiCScreen::m_dirtyTaken[MAGIC_DIRTY_WORDS];
+uint64_t CMagiCScreen::m_remapTaken[MAGIC_DIRTY_WORDS];
+unsigned CMagiCScreen::m_dirtyNext;
+uint32_t CMagiCScreen::m_dirtyPitch;
+unsigned CMagiCScreen::m_dirtyHeight;
+uint64_t CMagiCScreen::m_statsStartNs;
+ScreenConvFn CMagiCScreen::m_convLines;
+ScreenConvFn CMagiCScreen::m_remapLines;
+unsigned CMagiCScreen::m_paletteColours;
+uint8_t *CMagiCScreen::m_index;
+uint16_t CMagiCScreen::m_lineColours[MAGIC_DIRTY_LINES_MAX];
+
+static_assert(MAGIC_DIRTY_LINES_MAX >= ATARI_SCREEN_HEIGHT_MAX, "dirty line bitmap too small");
 
 
 /** **********************************************************************************************
  *
- * @brief initialisation, create SDL surfaces
+ * @brief Get monotonic host time
+ *
+ * @return time in ns
+ *
+ ************************************************************************************************/
+static uint64_t getHostNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief initialisation, create SDL surface
  *
  * @return zero for "no error"
  *
@@ -55,7 +87,6 @@ int CMagiCScreen::init(void)
     memset(&m_pColourTable, 0, sizeof(m_pColourTable));
 
     m_sdl_atari_surface = nullptr;
-    m_sdl_host_surface = nullptr;
 
     m_logAddr = 0;
     m_physAddr = 0;
@@ -173,43 +204,51 @@ int CMagiCScreen::init(void)
             amask);
     #endif
     assert(m_sdl_atari_surface);
-    // hack to mark the surface as "interleaved plane"
-    if (planeBytes == 2)
+    // choose the conversion to host pixels once, for the pixel format and the host CPU
+    ScreenConvFormat convFormat;
+    switch(screenbitsperpixel)
+    {
+        case 1:  convFormat = SCREENCONV_MONO; break;
+        case 2:  convFormat = (planeBytes == 2) ? SCREENCONV_IP2 : SCREENCONV_FORMATS; break;
+        case 4:  convFormat = (planeBytes == 2) ? SCREENCONV_IP4 : SCREENCONV_PACKED4; break;
+        case 8:  convFormat = SCREENCONV_PACKED8; break;
+        case 16: convFormat = SCREENCONV_RGB555; break;
+        default: convFormat = SCREENCONV_FORMATS; break;    // native host format, or not supported
+    }
+    ScreenConvIsa convIsa = CScreenConv::bestIsa();
+    m_convLines = CScreenConv::get(convFormat, convIsa);
+    DebugWarning2("() : Screen conversion uses %s", CScreenConv::isaName[convIsa]);
+    // Up to 16 colours: keep the colour indices, so that a palette change only needs a table lookup.
+    // With 256 colours the video memory itself is the index buffer.
+    m_paletteColours = (pixelType == 0) ? (1u << screenbitsperpixel) : 0;
+    m_remapLines = CScreenConv::get(SCREENCONV_INDEX16, convIsa);
+    m_index = nullptr;
+    if ((m_convLines != nullptr) && CScreenConv::storesIndex(convFormat))
+    {
+        m_index = (uint8_t *) malloc(Preferences::AtariScreenWidth * Preferences::AtariScreenHeight + 16);
+    }
+    if (m_convLines != nullptr)
     {
-        m_sdl_atari_surface->userdata = (void *) 1;
+        (void) CScreenConvPool::init(Preferences::ScreenConvThreads);
     }
     // we do not deal with the alpha channel, otherwise we always must make sure that each pixel is 0xff******
     SDL_SetSurfaceBlendMode(m_sdl_atari_surface, SDL_BLENDMODE_NONE);
 
-    // In case the Atari does not run in native host graphics mode, we need a conversion surface,
-    // and instead of directly updating the texture from the Atari surface, we first convert it to 32 bits per pixel.
-
-    if (screenbitsperpixel != 32)
-    {
-        rmask = 0x00ff0000;         // ARGB
-        gmask = 0x0000ff00;
-        bmask = 0x000000ff;
-        amask = 0xff000000;
-        DebugWarning2("() : Create SDL surface with 32 bits per pixel, r=0x%08x, g=0x%08x, b=0x%08x",
-                        screenbitsperpixel, rmask, gmask, bmask);
-        m_sdl_host_surface = SDL_CreateRGBSurface(
-                                             0,    // no flags
-                                             Preferences::AtariScreenWidth,     // was m_hostScreenW, why?
-                                             Preferences::AtariScreenHeight,    // dito
-                                             32,    // bits per pixel
-                                             rmask,
-                                             gmask,
-                                             bmask,
-                                             amask);
-        assert(m_sdl_host_surface);
-        // we do not deal with the alpha channel, otherwise we always must make sure that each pixel is 0xff******
-        SDL_SetSurfaceBlendMode(m_sdl_host_surface, SDL_BLENDMODE_NONE);
-    }
-    else
+    // There is no host surface. The screen is converted, or in true colour mode copied,
+    // directly into the locked streaming texture, see convAtari2Host().
+
+    init_pixmap(pixelType, cmpCount, cmpSize, planeBytes);
+
+    // the surface content is undefined, so the first update must cover all lines
+    m_dirtyPitch = m_sdl_atari_surface->pitch;
+    m_dirtyHeight = m_sdl_atari_surface->h;
+    for (unsigned w = 0; w < MAGIC_DIRTY_WORDS; w++)
     {
-        m_sdl_host_surface = m_sdl_atari_surface;
+        m_dirtyLines[w] = 0;
     }
-    init_pixmap(pixelType, cmpCount, cmpSize, planeBytes);
+    m_bAllDirty = true;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_statsStartNs = getHostNs();
 
     return 0;
 }
@@ -224,6 +263,12 @@ int CMagiCScreen::init(void)
  ************************************************************************************************/
 void CMagiCScreen::exit(void)
 {
+    CScreenConvPool::exit();
+    if (m_index != nullptr)
+    {
+        free(m_index);
+        m_index = nullptr;
+    }
     if (pixels != nullptr)
     {
         free(pixels);
@@ -300,350 +345,285 @@ uint8_t CMagiCScreen::getAtariScreenMode()
 
 /** **********************************************************************************************
  *
- * @brief  Convert bitmap format from Atari native to host native
+ * @brief Mark the whole screen as dirty, e.g. after a change of the screen address
+ *
+ * @note May be called from any thread.
+ *
+ ************************************************************************************************/
+void CMagiCScreen::setAllDirty()
+{
+    m_bAllDirty = true;
+    atomic_store(&gbAtariVideoBufChanged, true);
+}
+
+
+/** **********************************************************************************************
  *
- * @param[in]  pSrc         source surface in Atari format, e.g. monochrome
- * @param[in]  pDst         destination surface, RGB
- * @param[in]  palette      colour palette, 4 or 16 or 256 entries for indirect colour mode
- * @param[in]  bStretchX    horizontal stretching factor ?!?
- * @param[in]  bStretchY    vertical stretching factor ?!?
+ * @brief Emulator thread: mark colour palette entries as changed
  *
- * @note This function is NOT called in true colour mode.
+ * @param[in] index     first entry
+ * @param[in] count     number of entries
+ *
+ * @note Entries that are not used in the current screen mode are ignored, e.g. all in
+ *       direct colour modes.
  *
  ************************************************************************************************/
-void CMagiCScreen::convAtari2HostSurface()
+void CMagiCScreen::setPaletteDirty(unsigned index, unsigned count)
 {
-    const SDL_Surface *pSrc = m_sdl_atari_surface;
-    SDL_Surface *pDst = m_sdl_host_surface;
-    const uint32_t *palette = m_pColourTable;
+    bool bNew = false;
+    for (unsigned i = index; (i < index + count) && (i < m_paletteColours); i++)
+    {
+        uint64_t bit = 1ULL << (i & 63);
+        if ((m_paletteDirty[i >> 6].fetch_or(bit) & bit) == 0)
+        {
+            bNew = true;
+        }
+    }
+    if (bNew)
+    {
+        atomic_store(&gbAtariVideoBufChanged, true);
+    }
+}
 
-    int x,y;
-    const uint8_t *ps8 = (const uint8_t *) pSrc->pixels;
-    if (CMagiCScreen::m_physAddr != 0)
+
+/** **********************************************************************************************
+ *
+ * @brief GUI thread: take and clear the dirty lines for a screen update
+ *
+ * @return number of dirty lines
+ *
+ * @note Call after clearing gbAtariVideoBufChanged. Then get the line ranges with
+ *       nextDirtyRange().
+ * @note If the physical screen has been moved to regular Atari memory, writes to it are not
+ *       tracked, and all lines are taken.
+ *
+ ************************************************************************************************/
+unsigned CMagiCScreen::takeDirtyLines()
+{
+    bool bAll = m_bAllDirty.exchange(false) || (m_physAddr != 0);
+    unsigned n = 0;
+
+    uint64_t colours = 0;
+    for (unsigned w = 0; w < MAGIC_COLOR_TABLE_LEN / 64; w++)
     {
-        ps8 = mem68k + CMagiCScreen::m_physAddr;
+        colours |= m_paletteDirty[w].exchange(0);
+    }
+    if ((colours != 0) && (m_index == nullptr))
+    {
+        // no index buffer, or it is the video memory, convert all
+        bAll = true;
     }
-    uint8_t *pd8 = (uint8_t *) pDst->pixels;
-    const uint8_t *ps8x;
-    uint32_t *pd32x;
-    uint8_t c;
-    // Atari colour representation:
-    // 0xff000000        black
-    // 0xffff0000        red
-    // 0xff00ff00        green
-    // 0xff0000ff        blue
-    // convert from RGB555 to RGB888 using a conversion table
-    static const uint32_t rgbConvTable5to8[32] =
-    {
-        0,
-        ( 1 * 255)/31,
-        ( 2 * 255)/31,
-        ( 3 * 255)/31,
-        ( 4 * 255)/31,
-        ( 5 * 255)/31,
-        ( 6 * 255)/31,
-        ( 7 * 255)/31,
-        ( 8 * 255)/31,
-        ( 9 * 255)/31,
-        (10 * 255)/31,
-        (11 * 255)/31,
-        (12 * 255)/31,
-        (13 * 255)/31,
-        (14 * 255)/31,
-        (15 * 255)/31,
-        (16 * 255)/31,
-        (17 * 255)/31,
-        (18 * 255)/31,
-        (19 * 255)/31,
-        (20 * 255)/31,
-        (21 * 255)/31,
-        (22 * 255)/31,
-        (23 * 255)/31,
-        (24 * 255)/31,
-        (25 * 255)/31,
-        (26 * 255)/31,
-        (27 * 255)/31,
-        (28 * 255)/31,
-        (29 * 255)/31,
-        (30 * 255)/31,
-        255
-    };
-
-    // hack to detect interleaved plane format
-    int bitsperpixel = pSrc->format->BitsPerPixel;
-    if (pSrc->userdata == (void *) 1)
-    {
-        bitsperpixel *= 10;
-    }
-
-    switch(bitsperpixel)
-    {
-        //
-        // one bit, two colours
-        //
-
-        case 1:
-        {
-            uint32_t col0 = palette[0];
-            uint32_t col1 = palette[1];
 
-            // monochrome, driver MFM2.SYS.
-            for (y = 0; y < pSrc->h; y++)
+    for (unsigned w = 0; w < MAGIC_DIRTY_WORDS; w++)
+    {
+        m_dirtyTaken[w] = m_dirtyLines[w].exchange(0);
+        m_remapTaken[w] = 0;
+        if (bAll)
+        {
+            m_dirtyTaken[w] = ~0ULL;
+        }
+    }
+    if ((colours != 0) && !bAll)
+    {
+        // the lines that use a changed colour are looked up in the index buffer, see convAtari2Host()
+        for (unsigned line = 0; line < m_dirtyHeight; line++)
+        {
+            if (m_lineColours[line] & colours)
             {
-                ps8x = ps8;                    // pointer to source line
-                pd32x = (uint32_t *) pd8;    // pointer to dest line
-
-                for (x = 0; x < pSrc->w; x += 8)
-                {
-                    c = *ps8x++;        // get one byte, 8 pixels
-                    *pd32x++ = (c & 0x80) ? col1 : col0;
-                    *pd32x++ = (c & 0x40) ? col1 : col0;
-                    *pd32x++ = (c & 0x20) ? col1 : col0;
-                    *pd32x++ = (c & 0x10) ? col1 : col0;
-                    *pd32x++ = (c & 0x08) ? col1 : col0;
-                    *pd32x++ = (c & 0x04) ? col1 : col0;
-                    *pd32x++ = (c & 0x02) ? col1 : col0;
-                    *pd32x++ = (c & 0x01) ? col1 : col0;
-                }
-
-/* Let SDL do that in EmulatorWindowUpdate()
-                if (bStretchY)
-                {
-                    //copy line
-                    memcpy(pd8 + pDst->pitch, pd8, pDst->w * sizeof(uint32_t));
-                    pd8 += pDst->pitch;
-                }
-*/
-                // advance to next line
-                ps8 += pSrc->pitch;
-                pd8 += pDst->pitch;
+                m_remapTaken[line >> 6] |= 1ULL << (line & 63);
             }
-            break;
         }
+    }
+    for (unsigned line = 0; line < m_dirtyHeight; line += 64)
+    {
+        uint64_t bits = m_dirtyTaken[line >> 6] | m_remapTaken[line >> 6];
+        if (m_dirtyHeight - line < 64)
+        {
+            bits &= ~(~0ULL << (m_dirtyHeight - line));
+        }
+        n += (unsigned) __builtin_popcountll(bits);
+    }
 
-        //
-        // two bits interleaved, four colours, driver MFM4IP.SYS
-        //
+    m_dirtyNext = 0;
+    if (n != 0)
+    {
+        m_stats.frames++;
+        m_stats.bytesFull += (uint64_t) m_dirtyHeight * m_sdl_atari_surface->w * 4;
+        if (n == m_dirtyHeight)
+        {
+            m_stats.fullFrames++;
+        }
+    }
+    return n;
+}
 
-        case 20:
-            // organized as interleaved plane (16-bit-big-endian, lowest bit first)
-            for (y = 0; y < pSrc->h; y++)
-            {
-                ps8x = ps8;                    // pointer to source line
-                pd32x = (uint32_t *) pd8;    // pointer to dest line
-                uint16_t index3, index2, index1, index0;
-
-                for (x = 0; x < pSrc->w; x += 16)
-                {
-                    int i;
-                    uint8_t ca[16];
-
-                    index1 = *ps8x++;        // get one byte, bit 0 of first 8 pixels
-                    index1 <<= 0;
-                    index0 = *ps8x++;        // get one byte, bit 0 of  next 8 pixels
-                    index0 <<= 0;
-                    index3 = *ps8x++;        // get one byte, bit 1 of first 8 pixels
-                    index3 <<= 1;
-                    index2 = *ps8x++;        // get one byte, bit 1 of  next 8 pixels
-                    index2 <<= 1;
-                    for (i = 7; i >= 0; i--)
-                    {
-                        ca[i] = (index3 & 2) | (index1 & 1);
-                        index3 >>= 1;
-                        index1 >>= 1;
-                    }
-
-                    for (i = 15; i >= 8; i--)
-                    {
-                        ca[i] = (index2 & 2) | (index0 & 1);
-                        index2 >>= 1;
-                        index0 >>= 1;
-                    }
-
-                    for (i = 0; i < 16; i++)
-                    {
-                        // indexed colour, we must access the palette table here
-                        *pd32x++ = palette[ca[i]];
-                    }
-                }
-
-                /* Let SDL do that in EmulatorWindowUpdate()
-                if (bStretchY)
-                {
-                    //copy line
-                    memcpy(pd8 + pDst->pitch, pd8, pDst->w * sizeof(uint32_t));
-                    pd8 += pDst->pitch;
-                }
-                */
-                // advance to next line
-                ps8 += pSrc->pitch;
-                pd8 += pDst->pitch;
-            }
-            break;
 
-        //
-        // four bits packed, 16 colours, driver MFM16.SYS
-        //
+/** **********************************************************************************************
+ *
+ * @brief GUI thread: get the next range of dirty lines
+ *
+ * @param[out] pYStart      first line
+ * @param[out] pYEnd        line after the last one
+ *
+ * @return true: range found, false: no more dirty lines
+ *
+ * @note Ranges with small gaps in between are merged, because converting a few clean lines
+ *       is cheaper than another texture update.
+ *
+ ************************************************************************************************/
+bool CMagiCScreen::nextDirtyRange(int *pYStart, int *pYEnd)
+{
+    #define LINE_DIRTY(y) (((m_dirtyTaken[(y) >> 6] | m_remapTaken[(y) >> 6]) >> ((y) & 63)) & 1)
+    unsigned y = m_dirtyNext;
+    while ((y < m_dirtyHeight) && !LINE_DIRTY(y))
+    {
+        y++;
+    }
+    if (y >= m_dirtyHeight)
+    {
+        m_dirtyNext = m_dirtyHeight;
+        return false;
+    }
 
-        case 4:
-            for (y = 0; y < pSrc->h; y++)
-            {
-                ps8x = ps8;                    // pointer to source line
-                pd32x = (uint32_t *) pd8;    // pointer to dest line
-                uint8_t index1, index0;
-
-                for (x = 0; x < pSrc->w; x += 2)
-                {
-                    index1 = *ps8x++;        // get one byte, 2 pixels (aaaabbbb)
-                    index0 = index1 >> 4;
-                    index1 &= 0x0f;
-
-                    // indexed colour, we must access the palette table here
-        //            *pd32x++ = (index0 << 4) | (index0 << 12L) | (index0 << 20L) | (0xff000000);
-                    *pd32x++ = palette[index0];
-        //            *pd32x++ = (index1 << 4) | (index1 << 12L) | (index1 << 20L) | (0xff000000);
-                    *pd32x++ = palette[index1];
-                }
-
-                // advance to next line
-                ps8 += pSrc->pitch;
-                pd8 += pDst->pitch;
-            }
-            break;
+    unsigned start = y;
+    unsigned end = y + 1;
+    for (y = end; (y < m_dirtyHeight) && (y < end + MAGIC_DIRTY_GAP); y++)
+    {
+        if (LINE_DIRTY(y))
+        {
+            end = y + 1;
+        }
+    }
+    #undef LINE_DIRTY
 
-            /* The Atari ST however has interleaved bitplanes: The first word
-             of graphics memory describes the first 16 pixels on screen in
-             the first bitplane, the second word describes the same 16 pixels
-             in the second bitplane and so forth. If the Atari ST displays 16
-             colours on screen, meaning 4 bitplanes, you have 8 bytes (4 words)
-             of data which describe 16 pixels in all 4 bitplanes. */
+    m_dirtyNext = end;
+    *pYStart = (int) start;
+    *pYEnd = (int) end;
+    return true;
+}
 
-        //
-        // four bits interleaved, 16 colours, driver MFM16IP.SYS
-        //
 
-        case 40:
-            // organized as interleaved plane (16-bit-big-endian)
-            for (y = 0; y < pSrc->h; y++)
-            {
-                ps8x = ps8;                    // pointer to source line
-                pd32x = (uint32_t *) pd8;    // pointer to dest line
-                uint16_t index31, index21, index11, index01;
-                uint16_t index32, index22, index12, index02;
-
-                for (x = 0; x < pSrc->w; x += 16)
-                {
-                    int i;
-                    uint8_t ca[16];
-
-                    index01 = *ps8x++;        // get one byte, bit 0 of first 8 pixels
-                    index01 <<= 0;
-                    index02 = *ps8x++;        // get one byte, bit 0 of next 8 pixels
-                    index02 <<= 0;
-                    index11 = *ps8x++;        // get one byte, bit 1 of first 8 pixels
-                    index11 <<= 1;
-                    index12 = *ps8x++;        // get one byte, bit 1 of next 8 pixels
-                    index12 <<= 1;
-                    index21 = *ps8x++;        // get one byte, bit 2 of first 8 pixels
-                    index21 <<= 2;
-                    index22 = *ps8x++;        // get one byte, bit 2 of next 8 pixels
-                    index22 <<= 2;
-                    index31 = *ps8x++;        // get one byte, bit 3 of first 8 pixels
-                    index31 <<= 3;
-                    index32 = *ps8x++;        // get one byte, bit 3 of next 8 pixels
-                    index32 <<= 3;
-
-                    for (i = 7; i >= 0; i--)
-                    {
-                        ca[i] = (index31 & 8) | (index21 & 4) | (index11 & 2) | (index01 & 1);
-                        index31 >>= 1;
-                        index21 >>= 1;
-                        index11 >>= 1;
-                        index01 >>= 1;
-                    }
-
-
-                    for (i = 15; i >= 8; i--)
-                    {
-                        ca[i] = (index32 & 8) | (index22 & 4) | (index12 & 2) | (index02 & 1);
-                        index32 >>= 1;
-                        index22 >>= 1;
-                        index12 >>= 1;
-                        index02 >>= 1;
-                    }
-
-                    for (i = 0; i < 16; i++)
-                    {
-                        // indexed colour, we must access the palette table here
-                        *pd32x++ = palette[ca[i]];
-                    }
-                }
-
-                // advance to next line
-                ps8 += pSrc->pitch;
-                pd8 += pDst->pitch;
-            }
-            break;
+/** **********************************************************************************************
+ *
+ * @brief GUI thread: count a texture update
+ *
+ * @param[in]  yStart       first line
+ * @param[in]  yEnd         line after the last one
+ *
+ ************************************************************************************************/
+void CMagiCScreen::countUpload(int yStart, int yEnd)
+{
+    m_stats.uploads++;
+    m_stats.bytesUploaded += (uint64_t) (yEnd - yStart) * m_sdl_atari_surface->w * 4;
+}
 
-        //
-        // 8 bits packed, 256 colours, driver MFM256.SYS
-        //
 
-        case 8:
-            for (y = 0; y < pSrc->h; y++)
-            {
-                ps8x = ps8;                    // pointer to source line
-                pd32x = (uint32_t *) pd8;    // pointer to dest line
-                uint8_t index0;
-
-                for (x = 0; x < pSrc->w; x++)
-                {
-                    index0 = *ps8x++;        // get one byte, 1 pixel
-                    *pd32x++ = palette[index0];
-                }
-
-                // advance to next line
-                ps8 += pSrc->pitch;
-                pd8 += pDst->pitch;
-            }
-            break;
+/** **********************************************************************************************
+ *
+ * @brief Write screen update statistics to the log
+ *
+ ************************************************************************************************/
+void CMagiCScreen::logStats()
+{
+    uint64_t secs = (getHostNs() - m_statsStartNs) / 1000000000ULL;
+    if (secs == 0)
+    {
+        secs = 1;
+    }
+    DebugInfo2("() - %llu screen updates, %llu of them full, %llu texture uploads, %llu lines only remapped",
+                (unsigned long long) m_stats.frames, (unsigned long long) m_stats.fullFrames,
+                (unsigned long long) m_stats.uploads, (unsigned long long) m_stats.linesRemapped);
+    DebugInfo2("() - converted %llu KiB/s, uploaded %llu KiB/s, full updates would have been %llu KiB/s",
+                (unsigned long long) (m_stats.bytesConverted / 1024 / secs),
+                (unsigned long long) (m_stats.bytesUploaded / 1024 / secs),
+                (unsigned long long) (m_stats.bytesFull / 1024 / secs));
+}
 
-        //
-        // 16 resp. 15 bits packed, 32768 colours, driver MFM32K.SYS
-        //
 
-        case 16:
-            for (y = 0; y < pSrc->h; y++)
+/** **********************************************************************************************
+ *
+ * @brief  Convert bitmap format from Atari native to host native
+ *
+ * @param[in]  yStart       first line to convert
+ * @param[in]  yEnd         line after the last one to convert
+ * @param[out] dst          host ARGB pixels of line <yStart>, usually the locked texture
+ * @param[in]  dstPitch     bytes per line of <dst>
+ *
+ * @note Large ranges are converted in parallel bands, see CScreenConvPool.
+ * @note In true colour mode the lines are just copied.
+ * @note With up to 16 colours, the lines with changed colours only are looked up in the index buffer.
+ *
+ ************************************************************************************************/
+void CMagiCScreen::convAtari2Host(int yStart, int yEnd, uint8_t *dst, int dstPitch)
+{
+    const SDL_Surface *pSrc = m_sdl_atari_surface;
+    unsigned lines = (unsigned) (yEnd - yStart);
+
+    const uint8_t *ps8 = (const uint8_t *) pSrc->pixels;
+    if (CMagiCScreen::m_physAddr != 0)
+    {
+        ps8 = mem68k + CMagiCScreen::m_physAddr;
+    }
+    ps8 += yStart * pSrc->pitch;
+
+    if (m_index != nullptr)
+    {
+        // Runs of lines: changed pixels are converted, also to the index buffer,
+        // the other lines, i.e. with changed colours only, are looked up in the index buffer.
+        #define LINE_PIXELS(y) ((m_dirtyTaken[(y) >> 6] >> ((y) & 63)) & 1)
+        unsigned w = (unsigned) pSrc->w;
+        int y = yStart;
+        while (y < yEnd)
+        {
+            int yRun = y + 1;
+            while ((yRun < yEnd) && (LINE_PIXELS(yRun) == LINE_PIXELS(y)))
             {
-                ps8x = ps8;                    // pointer to source line
-                pd32x = (uint32_t *) pd8;    // pointer to dest line
-                uint32_t r,g,b,w;
-
-                for (x = 0; x < pSrc->w; x++)
-                {
-                    w = *ps8x++;        // get upper byte of pixel
-                    w <<= 8;
-                    w |= *ps8x++;        // get lower byte of pixel
-
-                    // extract colours
-                    r = (w >> 10) & 0x1f;
-                    g = (w >>  5) & 0x1f;
-                    b = (w >>  0) & 0x1f;
-                    // expand from 5 to 8 bit
-                    r = rgbConvTable5to8[r];
-                    g = rgbConvTable5to8[g];
-                    b = rgbConvTable5to8[b];
-
-                    // SDL has ARGB
-                    w = (0xff000000) | (r << 16) | (g << 8) | (b);
-                    *pd32x++ = w;
-                }
-
-                // advance to next line
-                ps8 += pSrc->pitch;
-                pd8 += pDst->pitch;
+                yRun++;
             }
-            break;
+            uint8_t *pd8 = dst + (y - yStart) * dstPitch;
+            uint8_t *pi8 = m_index + y * w;
+            if (LINE_PIXELS(y))
+            {
+                CScreenConvPool::convert(m_convLines, ps8 + (y - yStart) * pSrc->pitch, pSrc->pitch, pd8, dstPitch, w,
+                                         yRun - y, m_pColourTable, pi8, m_lineColours + y);
+                m_stats.bytesConverted += (uint64_t) (yRun - y) * pSrc->pitch;
+            }
+            else
+            {
+                CScreenConvPool::convert(m_remapLines, pi8, w, pd8, dstPitch, w,
+                                         yRun - y, m_pColourTable);
+                m_stats.linesRemapped += yRun - y;
+            }
+            y = yRun;
+        }
+        #undef LINE_PIXELS
+    }
+    else
+    if (m_convLines != nullptr)
+    {
+        CScreenConvPool::convert(m_convLines, ps8, pSrc->pitch, dst, dstPitch, pSrc->w,
+                                 lines, m_pColourTable);
+        m_stats.bytesConverted += (uint64_t) lines * pSrc->pitch;
+    }
+    else
+    if (pSrc->format->BitsPerPixel == 32)
+    {
+        // same ARGB layout as the texture
+        for (unsigned y = 0; y < lines; y++)
+        {
+            memcpy(dst, ps8, pSrc->w * 4);
+            ps8 += pSrc->pitch;
+            dst += dstPitch;
+        }
+    }
+    else
+    {
+        // not supported, show white
+        for (unsigned y = 0; y < lines; y++)
+        {
+            memset(dst, 0xff, pSrc->w * 4);
+            dst += dstPitch;
+        }
     }
 }
 
@@ -755,5 +735,10 @@ void CMagiCScreen::setColourPaletteEntry(unsigned index, uint16_t val)
     #endif
 
     uint32_t c = (red << 16) | (green << 8) | (blue << 0);
-    CMagiCScreen::m_pColourTable[index] = c | (0xff000000);
+    c |= 0xff000000;
+    if (CMagiCScreen::m_pColourTable[index] != c)
+    {
+        CMagiCScreen::m_pColourTable[index] = c;
+        setPaletteDirty(index, 1);
+    }
 }
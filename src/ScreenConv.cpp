@@ -0,0 +1,1172 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Conversion of Atari screen lines to host ARGB pixels
+*
+* There is one kernel per Atari pixel format and instruction set. A kernel
+* converts one line, the template convLines() loops over the lines. The
+* function for the screen mode and the host CPU is chosen once, so that the
+* per-frame work has no format switch.
+*
+* The vector kernels work on groups of 16 pixels, a remaining part of a line
+* is done by the scalar kernel. All kernels produce exactly the same pixels.
+*
+* For up to 16 colours the vector kernels first compute a byte vector of 16
+* colour indices. The palette lookup then is a byte shuffle on each of the
+* four bytes of the 32-bit colours (SSSE3, part of the AVX2 kernels, and
+* NEON). With SSE2 only, the lookup is scalar.
+*
+* The kernels for up to 16 colours also store the colour indices, so that
+* a palette change can be shown by a lookup from this index buffer only
+* (SCREENCONV_INDEX16), without decoding the bit planes again. They also
+* return the set of colours of each line, so that the lines without a
+* changed colour can be skipped.
+*
+* Large screens are split into horizontal bands, which are converted in
+* parallel by persistent worker threads, see CScreenConvPool, directly into
+* the locked streaming texture.
+*
+*/
+
+#include "config.h"
+// system headers
+#include <string.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCREENCONV_HAVE_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SCREENCONV_HAVE_NEON
+#endif
+// program headers
+#include "Debug.h"
+#include "ScreenConv.h"
+
+#if defined(SCREENCONV_HAVE_X86)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+const char *CScreenConv::isaName[SCREENCONV_ISAS] =
+{
+    "scalar", "SSE2", "AVX2", "NEON"
+};
+
+unsigned CScreenConvPool::m_threads = 1;
+pthread_t CScreenConvPool::m_thread[SCREENCONV_THREADS_MAX];
+CHostEvent CScreenConvPool::m_start[SCREENCONV_THREADS_MAX];
+CHostEvent CScreenConvPool::m_done;
+std::atomic_bool CScreenConvPool::m_bandDone[SCREENCONV_THREADS_MAX];
+std::atomic_bool CScreenConvPool::m_bRun;
+ScreenConvFn CScreenConvPool::m_fn;
+const uint8_t *CScreenConvPool::m_src;
+unsigned CScreenConvPool::m_srcPitch;
+uint8_t *CScreenConvPool::m_dst;
+unsigned CScreenConvPool::m_dstPitch;
+unsigned CScreenConvPool::m_width;
+const uint32_t *CScreenConvPool::m_palette;
+uint8_t *CScreenConvPool::m_index;
+uint16_t *CScreenConvPool::m_used;
+unsigned CScreenConvPool::m_bandStart[SCREENCONV_THREADS_MAX + 1];
+
+// palette, and for up to 16 colours also split into byte planes for table lookups
+struct ConvPalette
+{
+    const uint32_t *colours;
+    alignas(16) uint8_t planes[4][16];
+};
+
+
+/** **********************************************************************************************
+ *
+ * @brief Prepare the palette for the kernels
+ *
+ ************************************************************************************************/
+static inline void initPalette(ConvPalette *pal, const uint32_t *palette)
+{
+    pal->colours = palette;
+    for (unsigned i = 0; i < 16; i++)
+    {
+        // byte k of each colour, in memory order
+        const uint8_t *c = (const uint8_t *) (palette + i);
+        pal->planes[0][i] = c[0];
+        pal->planes[1][i] = c[1];
+        pal->planes[2][i] = c[2];
+        pal->planes[3][i] = c[3];
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Loop over lines with a kernel
+ *
+ * @param[in]  src          first source line
+ * @param[in]  srcPitch     bytes per source line
+ * @param[out] dst          first destination line, 32 bits per pixel
+ * @param[in]  dstPitch     bytes per destination line
+ * @param[in]  width        pixels per line
+ * @param[in]  lines        number of lines
+ * @param[in]  palette      colour palette
+ * @param[out] index        not used
+ * @param[out] used         not used
+ *
+ ************************************************************************************************/
+template <class Kernel>
+static void convLines(const uint8_t *src, unsigned srcPitch, uint8_t *dst, unsigned dstPitch,
+                      unsigned width, unsigned lines, const uint32_t *palette,
+                      uint8_t *index, uint16_t *used)
+{
+    (void) index;
+    (void) used;
+    ConvPalette pal;
+    initPalette(&pal, palette);
+
+    for (unsigned y = 0; y < lines; y++)
+    {
+        Kernel::line(src, (uint32_t *) dst, width, pal);
+        src += srcPitch;
+        dst += dstPitch;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Loop over lines with a kernel for up to 16 colours, that also stores the colour indices
+ *
+ * @param[out] index        first line of the index buffer, <width> bytes per line, or NULL
+ * @param[out] used         colours of each line, one bit per colour, or NULL
+ *
+ * @note See convLines() for the other parameters.
+ *
+ ************************************************************************************************/
+template <class Kernel>
+static void convIndexLines(const uint8_t *src, unsigned srcPitch, uint8_t *dst, unsigned dstPitch,
+                           unsigned width, unsigned lines, const uint32_t *palette,
+                           uint8_t *index, uint16_t *used)
+{
+    ConvPalette pal;
+    initPalette(&pal, palette);
+    uint8_t scratch[SCREENCONV_WIDTH_MAX + 16];
+
+    for (unsigned y = 0; y < lines; y++)
+    {
+        uint8_t *pi8x = (index != nullptr) ? index + y * width : scratch;
+        unsigned colours = Kernel::line(src, (uint32_t *) dst, pi8x, width, pal);
+        if (used != nullptr)
+        {
+            used[y] = (uint16_t) colours;
+        }
+        src += srcPitch;
+        dst += dstPitch;
+    }
+}
+
+
+/*
+*
+* scalar kernels
+*
+*/
+
+// monochrome, driver MFM2.SYS
+struct ConvMonoScalar
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        uint32_t col0 = pal.colours[0];
+        uint32_t col1 = pal.colours[1];
+        unsigned used = 0;
+
+        for (unsigned x = 0; x < width; x += 8)
+        {
+            uint8_t c = *ps8x++;        // get one byte, 8 pixels
+            for (int i = 7; i >= 0; i--)
+            {
+                uint8_t index = (c >> i) & 1;
+                *pi8x++ = index;
+                *pd32x++ = index ? col1 : col0;
+            }
+            used |= ((c != 0) ? 2 : 0) | ((c != 0xff) ? 1 : 0);
+        }
+        return used;
+    }
+};
+
+// two bits interleaved, four colours, driver MFM4IP.SYS
+// organized as interleaved plane (16-bit-big-endian, lowest bit first)
+struct ConvIp2Scalar
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned used = 0;
+        for (unsigned x = 0; x < width; x += 16)
+        {
+            uint16_t index1 = ps8x[0];          // bit 0 of first 8 pixels
+            uint16_t index0 = ps8x[1];          // bit 0 of  next 8 pixels
+            uint16_t index3 = ps8x[2] << 1;     // bit 1 of first 8 pixels
+            uint16_t index2 = ps8x[3] << 1;     // bit 1 of  next 8 pixels
+            ps8x += 4;
+            uint8_t ca[16];
+            int i;
+
+            for (i = 7; i >= 0; i--)
+            {
+                ca[i] = (index3 & 2) | (index1 & 1);
+                index3 >>= 1;
+                index1 >>= 1;
+            }
+            for (i = 15; i >= 8; i--)
+            {
+                ca[i] = (index2 & 2) | (index0 & 1);
+                index2 >>= 1;
+                index0 >>= 1;
+            }
+
+            unsigned n = (width - x < 16) ? width - x : 16;
+            for (i = 0; i < (int) n; i++)
+            {
+                *pi8x++ = ca[i];
+                *pd32x++ = pal.colours[ca[i]];
+                used |= 1u << ca[i];
+            }
+        }
+        return used;
+    }
+};
+
+// four bits packed, 16 colours, driver MFM16.SYS
+struct ConvPacked4Scalar
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned used = 0;
+        for (unsigned x = 0; x < width; x += 2)
+        {
+            uint8_t index1 = *ps8x++;       // get one byte, 2 pixels (aaaabbbb)
+            uint8_t index0 = index1 >> 4;
+            index1 &= 0x0f;
+            *pi8x++ = index0;
+            *pi8x++ = index1;
+            *pd32x++ = pal.colours[index0];
+            *pd32x++ = pal.colours[index1];
+            used |= (1u << index0) | (1u << index1);
+        }
+        return used;
+    }
+};
+
+// four bits interleaved, 16 colours, driver MFM16IP.SYS
+// The first word describes 16 pixels in the first bitplane, the next word
+// the same 16 pixels in the second bitplane, and so forth.
+struct ConvIp4Scalar
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned used = 0;
+        for (unsigned x = 0; x < width; x += 16)
+        {
+            uint16_t index01 = ps8x[0];         // bit 0 of first 8 pixels
+            uint16_t index02 = ps8x[1];         // bit 0 of next 8 pixels
+            uint16_t index11 = ps8x[2] << 1;    // bit 1 ...
+            uint16_t index12 = ps8x[3] << 1;
+            uint16_t index21 = ps8x[4] << 2;    // bit 2 ...
+            uint16_t index22 = ps8x[5] << 2;
+            uint16_t index31 = ps8x[6] << 3;    // bit 3 ...
+            uint16_t index32 = ps8x[7] << 3;
+            ps8x += 8;
+            uint8_t ca[16];
+            int i;
+
+            for (i = 7; i >= 0; i--)
+            {
+                ca[i] = (index31 & 8) | (index21 & 4) | (index11 & 2) | (index01 & 1);
+                index31 >>= 1;
+                index21 >>= 1;
+                index11 >>= 1;
+                index01 >>= 1;
+            }
+            for (i = 15; i >= 8; i--)
+            {
+                ca[i] = (index32 & 8) | (index22 & 4) | (index12 & 2) | (index02 & 1);
+                index32 >>= 1;
+                index22 >>= 1;
+                index12 >>= 1;
+                index02 >>= 1;
+            }
+
+            unsigned n = (width - x < 16) ? width - x : 16;
+            for (i = 0; i < (int) n; i++)
+            {
+                *pi8x++ = ca[i];
+                *pd32x++ = pal.colours[ca[i]];
+                used |= 1u << ca[i];
+            }
+        }
+        return used;
+    }
+};
+
+// 8 bits packed, 256 colours, driver MFM256.SYS, also for SCREENCONV_INDEX16
+struct ConvPacked8Scalar
+{
+    static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        for (unsigned x = 0; x < width; x++)
+        {
+            *pd32x++ = pal.colours[*ps8x++];
+        }
+    }
+};
+
+// 16 resp. 15 bits packed, 32768 colours, driver MFM32K.SYS
+struct ConvRgb555Scalar
+{
+    // convert from RGB555 to RGB888, (c * 255) / 31
+    static inline uint32_t expand5to8(uint32_t c)
+    {
+        return (c * 1053) >> 7;     // same result for 0..31, and fits into 16 bits for the vector kernels
+    }
+
+    static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        (void) pal;
+        for (unsigned x = 0; x < width; x++)
+        {
+            uint32_t w = *ps8x++;       // get upper byte of pixel
+            w <<= 8;
+            w |= *ps8x++;               // get lower byte of pixel
+
+            // extract colours and expand from 5 to 8 bit
+            uint32_t r = expand5to8((w >> 10) & 0x1f);
+            uint32_t g = expand5to8((w >>  5) & 0x1f);
+            uint32_t b = expand5to8((w >>  0) & 0x1f);
+
+            // SDL has ARGB
+            *pd32x++ = (0xff000000) | (r << 16) | (g << 8) | (b);
+        }
+    }
+};
+
+
+#if defined(SCREENCONV_HAVE_X86)
+
+/*
+*
+* x86 kernels, SSE2 is always there on x86-64, AVX2 is checked at runtime
+*
+*/
+
+// 0xff in each byte whose bit is set, pixels 0..7 from <b0>, 8..15 from <b1>, MSB first
+static inline __m128i sse2ExpandBits(uint8_t b0, uint8_t b1)
+{
+    const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m128i v = _mm_set_epi64x((long long) (b1 * 0x0101010101010101ULL), (long long) (b0 * 0x0101010101010101ULL));
+    return _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+}
+
+// colour indices of 16 pixels in interleaved plane format
+static inline __m128i sse2IndexIp2(const uint8_t *ps8x)
+{
+    __m128i idx = _mm_and_si128(sse2ExpandBits(ps8x[0], ps8x[1]), _mm_set1_epi8(1));
+    return _mm_or_si128(idx, _mm_and_si128(sse2ExpandBits(ps8x[2], ps8x[3]), _mm_set1_epi8(2)));
+}
+
+static inline __m128i sse2IndexIp4(const uint8_t *ps8x)
+{
+    __m128i idx = _mm_and_si128(sse2ExpandBits(ps8x[0], ps8x[1]), _mm_set1_epi8(1));
+    idx = _mm_or_si128(idx, _mm_and_si128(sse2ExpandBits(ps8x[2], ps8x[3]), _mm_set1_epi8(2)));
+    idx = _mm_or_si128(idx, _mm_and_si128(sse2ExpandBits(ps8x[4], ps8x[5]), _mm_set1_epi8(4)));
+    return _mm_or_si128(idx, _mm_and_si128(sse2ExpandBits(ps8x[6], ps8x[7]), _mm_set1_epi8(8)));
+}
+
+// colour indices of 16 pixels in 4-bit packed format, 8 bytes
+static inline __m128i sse2IndexPacked4(const uint8_t *ps8x)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i v = _mm_loadl_epi64((const __m128i *) ps8x);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i lo = _mm_and_si128(v, mask);
+    return _mm_unpacklo_epi8(hi, lo);       // high nibble is the left pixel
+}
+
+// scalar palette lookup of 16 pixels, also stores the indices, returns the colours used
+static inline unsigned sse2StoreIndexed(__m128i idx, uint32_t *pd32x, uint8_t *pi8x, const ConvPalette &pal)
+{
+    _mm_storeu_si128((__m128i *) pi8x, idx);
+    unsigned used = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        pd32x[i] = pal.colours[pi8x[i]];
+        used |= 1u << pi8x[i];
+    }
+    return used;
+}
+
+// colours of a mono bit mask of 16 pixels, see sse2ExpandBits()
+static inline unsigned sse2UsedMono(__m128i m)
+{
+    int bits = _mm_movemask_epi8(m);
+    return ((bits != 0) ? 2 : 0) | ((bits != 0xffff) ? 1 : 0);
+}
+
+// OR of the 16 bytes
+static inline unsigned sse2OrBytes(__m128i v)
+{
+    v = _mm_or_si128(v, _mm_srli_si128(v, 8));
+    v = _mm_or_si128(v, _mm_srli_si128(v, 4));
+    v = _mm_or_si128(v, _mm_srli_si128(v, 2));
+    v = _mm_or_si128(v, _mm_srli_si128(v, 1));
+    return (unsigned) _mm_cvtsi128_si32(v) & 0xff;
+}
+
+// 8 pixels from RGB555 big-endian
+static inline void sse2StoreRgb555(const uint8_t *ps8x, uint32_t *pd32x)
+{
+    const __m128i m5 = _mm_set1_epi16(0x1f);
+    const __m128i k = _mm_set1_epi16(1053);
+    __m128i v = _mm_loadu_si128((const __m128i *) ps8x);
+    __m128i w = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    __m128i r = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(w, 10), m5), k), 7);
+    __m128i g = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(w, 5), m5), k), 7);
+    __m128i b = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(w, m5), k), 7);
+    __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+    __m128i ra = _mm_or_si128(r, _mm_set1_epi16((short) 0xff00));
+    _mm_storeu_si128((__m128i *) pd32x, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *) (pd32x + 4), _mm_unpackhi_epi16(bg, ra));
+}
+
+struct ConvMonoSse2
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        const __m128i col0 = _mm_set1_epi32((int) pal.colours[0]);
+        const __m128i diff = _mm_xor_si128(col0, _mm_set1_epi32((int) pal.colours[1]));
+        unsigned used = 0;
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            __m128i m = sse2ExpandBits(ps8x[0], ps8x[1]);
+            _mm_storeu_si128((__m128i *) pi8x, _mm_and_si128(m, _mm_set1_epi8(1)));
+            used |= sse2UsedMono(m);
+            __m128i ml = _mm_unpacklo_epi8(m, m);
+            __m128i mh = _mm_unpackhi_epi8(m, m);
+            _mm_storeu_si128((__m128i *) pd32x,        _mm_xor_si128(col0, _mm_and_si128(diff, _mm_unpacklo_epi16(ml, ml))));
+            _mm_storeu_si128((__m128i *) (pd32x + 4),  _mm_xor_si128(col0, _mm_and_si128(diff, _mm_unpackhi_epi16(ml, ml))));
+            _mm_storeu_si128((__m128i *) (pd32x + 8),  _mm_xor_si128(col0, _mm_and_si128(diff, _mm_unpacklo_epi16(mh, mh))));
+            _mm_storeu_si128((__m128i *) (pd32x + 12), _mm_xor_si128(col0, _mm_and_si128(diff, _mm_unpackhi_epi16(mh, mh))));
+            ps8x += 2;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        return used | ConvMonoScalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvIp2Sse2
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned used = 0;
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            used |= sse2StoreIndexed(sse2IndexIp2(ps8x), pd32x, pi8x, pal);
+            ps8x += 4;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        return used | ConvIp2Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvIp4Sse2
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned used = 0;
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            used |= sse2StoreIndexed(sse2IndexIp4(ps8x), pd32x, pi8x, pal);
+            ps8x += 8;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        return used | ConvIp4Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvRgb555Sse2
+{
+    static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned x;
+        for (x = 0; x + 8 <= width; x += 8)
+        {
+            sse2StoreRgb555(ps8x, pd32x);
+            ps8x += 16;
+            pd32x += 8;
+        }
+        ConvRgb555Scalar::line(ps8x, pd32x, width - x, pal);
+    }
+};
+
+// palette lookup of 16 pixels by byte shuffles, for up to 16 colours
+TARGET_AVX2 static inline void avx2StoreIndexed(__m128i idx, uint32_t *pd32x, const ConvPalette &pal)
+{
+    __m128i p0 = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) pal.planes[0]), idx);
+    __m128i p1 = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) pal.planes[1]), idx);
+    __m128i p2 = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) pal.planes[2]), idx);
+    __m128i p3 = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) pal.planes[3]), idx);
+    __m128i p01l = _mm_unpacklo_epi8(p0, p1);
+    __m128i p01h = _mm_unpackhi_epi8(p0, p1);
+    __m128i p23l = _mm_unpacklo_epi8(p2, p3);
+    __m128i p23h = _mm_unpackhi_epi8(p2, p3);
+    _mm_storeu_si128((__m128i *) pd32x,        _mm_unpacklo_epi16(p01l, p23l));
+    _mm_storeu_si128((__m128i *) (pd32x + 4),  _mm_unpackhi_epi16(p01l, p23l));
+    _mm_storeu_si128((__m128i *) (pd32x + 8),  _mm_unpacklo_epi16(p01h, p23h));
+    _mm_storeu_si128((__m128i *) (pd32x + 12), _mm_unpackhi_epi16(p01h, p23h));
+}
+
+// collect the colours of 16 indices, one bit per colour in <*pLo> (0..7) and <*pHi> (8..15)
+TARGET_AVX2 static inline void avx2SeenColours(__m128i idx, __m128i *pLo, __m128i *pHi)
+{
+    const __m128i oneLo = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i oneHi = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128);
+    *pLo = _mm_or_si128(*pLo, _mm_shuffle_epi8(oneLo, idx));
+    *pHi = _mm_or_si128(*pHi, _mm_shuffle_epi8(oneHi, idx));
+}
+
+// 16 pixels: store the indices, look up the colours and collect the colours used
+TARGET_AVX2 static inline void avx2StoreIndex(__m128i idx, uint32_t *pd32x, uint8_t *pi8x, const ConvPalette &pal,
+                                              __m128i *pLo, __m128i *pHi)
+{
+    _mm_storeu_si128((__m128i *) pi8x, idx);
+    avx2SeenColours(idx, pLo, pHi);
+    avx2StoreIndexed(idx, pd32x, pal);
+}
+
+struct ConvIp2Avx2
+{
+    TARGET_AVX2 static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            avx2StoreIndex(sse2IndexIp2(ps8x), pd32x, pi8x, pal, &lo, &hi);
+            ps8x += 4;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        unsigned used = sse2OrBytes(lo) | (sse2OrBytes(hi) << 8);
+        return used | ConvIp2Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvIp4Avx2
+{
+    TARGET_AVX2 static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            avx2StoreIndex(sse2IndexIp4(ps8x), pd32x, pi8x, pal, &lo, &hi);
+            ps8x += 8;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        unsigned used = sse2OrBytes(lo) | (sse2OrBytes(hi) << 8);
+        return used | ConvIp4Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvPacked4Avx2
+{
+    TARGET_AVX2 static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            avx2StoreIndex(sse2IndexPacked4(ps8x), pd32x, pi8x, pal, &lo, &hi);
+            ps8x += 8;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        unsigned used = sse2OrBytes(lo) | (sse2OrBytes(hi) << 8);
+        return used | ConvPacked4Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+// palette lookup from an index buffer, after a palette change
+struct ConvIndex16Avx2
+{
+    TARGET_AVX2 static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            avx2StoreIndexed(_mm_loadu_si128((const __m128i *) ps8x), pd32x, pal);
+            ps8x += 16;
+            pd32x += 16;
+        }
+        ConvPacked8Scalar::line(ps8x, pd32x, width - x, pal);
+    }
+};
+
+struct ConvPacked8Avx2
+{
+    TARGET_AVX2 static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned x;
+        for (x = 0; x + 8 <= width; x += 8)
+        {
+            __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) ps8x));
+            _mm256_storeu_si256((__m256i *) pd32x, _mm256_i32gather_epi32((const int *) pal.colours, idx, 4));
+            ps8x += 8;
+            pd32x += 8;
+        }
+        ConvPacked8Scalar::line(ps8x, pd32x, width - x, pal);
+    }
+};
+
+struct ConvRgb555Avx2
+{
+    TARGET_AVX2 static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        const __m256i m5 = _mm256_set1_epi16(0x1f);
+        const __m256i k = _mm256_set1_epi16(1053);
+        const __m256i alpha = _mm256_set1_epi16((short) 0xff00);
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *) ps8x);
+            __m256i w = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+            __m256i r = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(w, 10), m5), k), 7);
+            __m256i g = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(w, 5), m5), k), 7);
+            __m256i b = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(w, m5), k), 7);
+            __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+            __m256i ra = _mm256_or_si256(r, alpha);
+            // the unpacks work inside the 128-bit halves: pixels 0..3 + 8..11 and 4..7 + 12..15
+            __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+            __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+            _mm256_storeu_si256((__m256i *) pd32x,       _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *) (pd32x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+            ps8x += 32;
+            pd32x += 16;
+        }
+        ConvRgb555Sse2::line(ps8x, pd32x, width - x, pal);
+    }
+};
+
+#endif
+
+
+#if defined(SCREENCONV_HAVE_NEON)
+
+/*
+*
+* NEON kernels, always there on aarch64
+*
+*/
+
+// 0xff in each byte whose bit is set, pixels 0..7 from <b0>, 8..15 from <b1>, MSB first
+static inline uint8x16_t neonExpandBits(uint8_t b0, uint8_t b1)
+{
+    static const uint8_t bits[16] = { 0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1, 0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1 };
+    return vtstq_u8(vcombine_u8(vdup_n_u8(b0), vdup_n_u8(b1)), vld1q_u8(bits));
+}
+
+// palette lookup of 16 pixels by table lookups, for up to 16 colours
+static inline void neonStoreIndexed(uint8x16_t idx, uint32_t *pd32x, const ConvPalette &pal)
+{
+    uint8x16x4_t p;
+    p.val[0] = vqtbl1q_u8(vld1q_u8(pal.planes[0]), idx);
+    p.val[1] = vqtbl1q_u8(vld1q_u8(pal.planes[1]), idx);
+    p.val[2] = vqtbl1q_u8(vld1q_u8(pal.planes[2]), idx);
+    p.val[3] = vqtbl1q_u8(vld1q_u8(pal.planes[3]), idx);
+    vst4q_u8((uint8_t *) pd32x, p);
+}
+
+// collect the colours of 16 indices, one bit per colour in <*pLo> (0..7) and <*pHi> (8..15)
+static inline void neonSeenColours(uint8x16_t idx, uint8x16_t *pLo, uint8x16_t *pHi)
+{
+    static const uint8_t oneLo[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t oneHi[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, 128 };
+    *pLo = vorrq_u8(*pLo, vqtbl1q_u8(vld1q_u8(oneLo), idx));
+    *pHi = vorrq_u8(*pHi, vqtbl1q_u8(vld1q_u8(oneHi), idx));
+}
+
+// OR of the 16 bytes
+static inline unsigned neonOrBytes(uint8x16_t v)
+{
+    uint64x2_t v64 = vreinterpretq_u64_u8(v);
+    uint64_t x = vgetq_lane_u64(v64, 0) | vgetq_lane_u64(v64, 1);
+    x |= x >> 32;
+    x |= x >> 16;
+    x |= x >> 8;
+    return (unsigned) x & 0xff;
+}
+
+// 16 pixels: store the indices, look up the colours and collect the colours used
+static inline void neonStoreIndex(uint8x16_t idx, uint32_t *pd32x, uint8_t *pi8x, const ConvPalette &pal,
+                                  uint8x16_t *pLo, uint8x16_t *pHi)
+{
+    vst1q_u8(pi8x, idx);
+    neonSeenColours(idx, pLo, pHi);
+    neonStoreIndexed(idx, pd32x, pal);
+}
+
+struct ConvMonoNeon
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        uint8x16_t lo = vdupq_n_u8(0);
+        uint8x16_t hi = vdupq_n_u8(0);
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            neonStoreIndex(vandq_u8(neonExpandBits(ps8x[0], ps8x[1]), vdupq_n_u8(1)), pd32x, pi8x, pal, &lo, &hi);
+            ps8x += 2;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        unsigned used = neonOrBytes(lo) | (neonOrBytes(hi) << 8);
+        return used | ConvMonoScalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvIp2Neon
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        uint8x16_t lo = vdupq_n_u8(0);
+        uint8x16_t hi = vdupq_n_u8(0);
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            uint8x16_t idx = vandq_u8(neonExpandBits(ps8x[0], ps8x[1]), vdupq_n_u8(1));
+            idx = vorrq_u8(idx, vandq_u8(neonExpandBits(ps8x[2], ps8x[3]), vdupq_n_u8(2)));
+            neonStoreIndex(idx, pd32x, pi8x, pal, &lo, &hi);
+            ps8x += 4;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        unsigned used = neonOrBytes(lo) | (neonOrBytes(hi) << 8);
+        return used | ConvIp2Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvIp4Neon
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        uint8x16_t lo = vdupq_n_u8(0);
+        uint8x16_t hi = vdupq_n_u8(0);
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            uint8x16_t idx = vandq_u8(neonExpandBits(ps8x[0], ps8x[1]), vdupq_n_u8(1));
+            idx = vorrq_u8(idx, vandq_u8(neonExpandBits(ps8x[2], ps8x[3]), vdupq_n_u8(2)));
+            idx = vorrq_u8(idx, vandq_u8(neonExpandBits(ps8x[4], ps8x[5]), vdupq_n_u8(4)));
+            idx = vorrq_u8(idx, vandq_u8(neonExpandBits(ps8x[6], ps8x[7]), vdupq_n_u8(8)));
+            neonStoreIndex(idx, pd32x, pi8x, pal, &lo, &hi);
+            ps8x += 8;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        unsigned used = neonOrBytes(lo) | (neonOrBytes(hi) << 8);
+        return used | ConvIp4Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+struct ConvPacked4Neon
+{
+    static unsigned line(const uint8_t *ps8x, uint32_t *pd32x, uint8_t *pi8x, unsigned width, const ConvPalette &pal)
+    {
+        uint8x16_t lo = vdupq_n_u8(0);
+        uint8x16_t hi = vdupq_n_u8(0);
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            uint8x8_t v = vld1_u8(ps8x);
+            uint8x8x2_t z = vzip_u8(vshr_n_u8(v, 4), vand_u8(v, vdup_n_u8(0x0f)));   // high nibble is the left pixel
+            neonStoreIndex(vcombine_u8(z.val[0], z.val[1]), pd32x, pi8x, pal, &lo, &hi);
+            ps8x += 8;
+            pd32x += 16;
+            pi8x += 16;
+        }
+        unsigned used = neonOrBytes(lo) | (neonOrBytes(hi) << 8);
+        return used | ConvPacked4Scalar::line(ps8x, pd32x, pi8x, width - x, pal);
+    }
+};
+
+// palette lookup from an index buffer, after a palette change
+struct ConvIndex16Neon
+{
+    static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        unsigned x;
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            neonStoreIndexed(vld1q_u8(ps8x), pd32x, pal);
+            ps8x += 16;
+            pd32x += 16;
+        }
+        ConvPacked8Scalar::line(ps8x, pd32x, width - x, pal);
+    }
+};
+
+struct ConvRgb555Neon
+{
+    static void line(const uint8_t *ps8x, uint32_t *pd32x, unsigned width, const ConvPalette &pal)
+    {
+        const uint16x8_t m5 = vdupq_n_u16(0x1f);
+        unsigned x;
+        for (x = 0; x + 8 <= width; x += 8)
+        {
+            uint16x8_t w = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(ps8x)));
+            uint16x8_t r = vshrq_n_u16(vmulq_n_u16(vandq_u16(vshrq_n_u16(w, 10), m5), 1053), 7);
+            uint16x8_t g = vshrq_n_u16(vmulq_n_u16(vandq_u16(vshrq_n_u16(w, 5), m5), 1053), 7);
+            uint16x8_t b = vshrq_n_u16(vmulq_n_u16(vandq_u16(w, m5), 1053), 7);
+            uint8x8x4_t p;
+            p.val[0] = vmovn_u16(b);
+            p.val[1] = vmovn_u16(g);
+            p.val[2] = vmovn_u16(r);
+            p.val[3] = vdup_n_u8(0xff);
+            vst4_u8((uint8_t *) pd32x, p);
+            ps8x += 16;
+            pd32x += 8;
+        }
+        ConvRgb555Scalar::line(ps8x, pd32x, width - x, pal);
+    }
+};
+
+#endif
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get the best instruction set of the host CPU
+ *
+ * @return SCREENCONV_...
+ *
+ ************************************************************************************************/
+ScreenConvIsa CScreenConv::bestIsa()
+{
+#if defined(SCREENCONV_HAVE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SCREENCONV_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return SCREENCONV_SSE2;
+    }
+#elif defined(SCREENCONV_HAVE_NEON)
+    return SCREENCONV_NEON;
+#endif
+    return SCREENCONV_SCALAR;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Get the conversion function for a pixel format
+ *
+ * @param[in]  format       SCREENCONV_MONO etc.
+ * @param[in]  isa          instruction set, must be supported by the host CPU, see bestIsa()
+ *
+ * @return conversion function, the scalar one if there is no special one, or if the
+ *         instruction set is not compiled in
+ *
+ * @note The modes without a vector kernel for an instruction set would gain nothing,
+ *       e.g. the 256 colour lookup without a gather instruction.
+ *
+ ************************************************************************************************/
+ScreenConvFn CScreenConv::get(ScreenConvFormat format, ScreenConvIsa isa)
+{
+    static const ScreenConvFn scalar[SCREENCONV_FORMATS] =
+    {
+        convIndexLines<ConvMonoScalar>,
+        convIndexLines<ConvIp2Scalar>,
+        convIndexLines<ConvPacked4Scalar>,
+        convIndexLines<ConvIp4Scalar>,
+        convLines<ConvPacked8Scalar>,
+        convLines<ConvRgb555Scalar>,
+        convLines<ConvPacked8Scalar>
+    };
+
+    if (format >= SCREENCONV_FORMATS)
+    {
+        return nullptr;
+    }
+
+    switch(isa)
+    {
+#if defined(SCREENCONV_HAVE_X86)
+        case SCREENCONV_SSE2:
+        {
+            static const ScreenConvFn sse2[SCREENCONV_FORMATS] =
+            {
+                convIndexLines<ConvMonoSse2>,
+                convIndexLines<ConvIp2Sse2>,
+                convIndexLines<ConvPacked4Scalar>,
+                convIndexLines<ConvIp4Sse2>,
+                convLines<ConvPacked8Scalar>,
+                convLines<ConvRgb555Sse2>,
+                convLines<ConvPacked8Scalar>
+            };
+            return sse2[format];
+        }
+
+        case SCREENCONV_AVX2:
+        {
+            static const ScreenConvFn avx2[SCREENCONV_FORMATS] =
+            {
+                convIndexLines<ConvMonoSse2>,
+                convIndexLines<ConvIp2Avx2>,
+                convIndexLines<ConvPacked4Avx2>,
+                convIndexLines<ConvIp4Avx2>,
+                convLines<ConvPacked8Avx2>,
+                convLines<ConvRgb555Avx2>,
+                convLines<ConvIndex16Avx2>
+            };
+            return avx2[format];
+        }
+#endif
+
+#if defined(SCREENCONV_HAVE_NEON)
+        case SCREENCONV_NEON:
+        {
+            static const ScreenConvFn neon[SCREENCONV_FORMATS] =
+            {
+                convIndexLines<ConvMonoNeon>,
+                convIndexLines<ConvIp2Neon>,
+                convIndexLines<ConvPacked4Neon>,
+                convIndexLines<ConvIp4Neon>,
+                convLines<ConvPacked8Scalar>,
+                convLines<ConvRgb555Neon>,
+                convLines<ConvIndex16Neon>
+            };
+            return neon[format];
+        }
+#endif
+
+        default:
+            return scalar[format];
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Check if the conversion function for a pixel format stores the colour indices
+ *
+ * @param[in]  format       SCREENCONV_MONO etc.
+ *
+ * @return true for the formats with up to 16 colours, see ScreenConvFn
+ *
+ ************************************************************************************************/
+bool CScreenConv::storesIndex(ScreenConvFormat format)
+{
+    return (format == SCREENCONV_MONO) || (format == SCREENCONV_IP2) ||
+           (format == SCREENCONV_PACKED4) || (format == SCREENCONV_IP4);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Start the worker threads
+ *
+ * @param[in]  threads      number of converting threads including the caller, 0: automatic
+ *
+ * @return 0 for OK or -1 on error, then fewer threads are used
+ *
+ * @note Automatic means one per host CPU, but not more than four, because the conversion is
+ *       limited by memory bandwidth soon.
+ *
+ ************************************************************************************************/
+int CScreenConvPool::init(unsigned threads)
+{
+    if (threads == 0)
+    {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (ncpu > 4) ? 4 : ((ncpu < 1) ? 1 : (unsigned) ncpu);
+    }
+    if (threads > SCREENCONV_THREADS_MAX)
+    {
+        threads = SCREENCONV_THREADS_MAX;
+    }
+
+    m_bRun = true;
+    m_threads = 1;
+    for (unsigned i = 1; i < threads; i++)
+    {
+        m_start[i].clear();
+        if (pthread_create(&m_thread[i], nullptr, _thread, (void *) (uintptr_t) i))
+        {
+            DebugError2("() : pthread_create() failed");
+            return -1;
+        }
+        m_threads = i + 1;
+    }
+    DebugInfo2("() : %u thread(s)", m_threads);
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Stop the worker threads and wait for their end
+ *
+ ************************************************************************************************/
+void CScreenConvPool::exit()
+{
+    if (!m_bRun.exchange(false))
+    {
+        return;
+    }
+    for (unsigned i = 1; i < m_threads; i++)
+    {
+        m_start[i].set(1);
+    }
+    for (unsigned i = 1; i < m_threads; i++)
+    {
+        pthread_join(m_thread[i], nullptr);
+    }
+    m_threads = 1;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Convert a range of lines, in parallel bands if large enough
+ *
+ * @param[in]  fn           conversion function, see CScreenConv::get()
+ * @param[in]  src          first source line
+ * @param[in]  srcPitch     bytes per source line
+ * @param[out] dst          first destination line, e.g. in a locked texture
+ * @param[in]  dstPitch     bytes per destination line
+ * @param[in]  width        pixels per line
+ * @param[in]  lines        number of lines
+ * @param[in]  palette      colour palette
+ * @param[out] index        first line of the index buffer, or NULL, see ScreenConvFn
+ * @param[out] used         colours of each line, or NULL
+ *
+ * @note Only one thread may call this function. It returns when all bands are done.
+ *
+ ************************************************************************************************/
+void CScreenConvPool::convert(ScreenConvFn fn, const uint8_t *src, unsigned srcPitch, uint8_t *dst, unsigned dstPitch,
+                              unsigned width, unsigned lines, const uint32_t *palette,
+                              uint8_t *index, uint16_t *used)
+{
+    unsigned bands = (unsigned) (((uint64_t) lines * width) / SCREENCONV_BAND_PIXELS);
+    if (bands > m_threads)
+    {
+        bands = m_threads;
+    }
+
+    if (bands <= 1)
+    {
+        // small screen or range, no thread switches
+        fn(src, srcPitch, dst, dstPitch, width, lines, palette, index, used);
+        return;
+    }
+
+    m_fn = fn;
+    m_src = src;
+    m_srcPitch = srcPitch;
+    m_dst = dst;
+    m_dstPitch = dstPitch;
+    m_width = width;
+    m_palette = palette;
+    m_index = index;
+    m_used = used;
+    for (unsigned band = 0; band <= bands; band++)
+    {
+        m_bandStart[band] = (lines * band) / bands;
+    }
+
+    // the job is published by the atomic flag operations of the events
+    for (unsigned band = 1; band < bands; band++)
+    {
+        m_bandDone[band] = false;
+        m_start[band].set(1);
+    }
+
+    convertBand(0);
+
+    for (unsigned band = 1; band < bands; band++)
+    {
+        while (!m_bandDone[band])
+        {
+            (void) m_done.wait();
+        }
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Convert one band of the current job
+ *
+ ************************************************************************************************/
+void CScreenConvPool::convertBand(unsigned band)
+{
+    unsigned y0 = m_bandStart[band];
+    unsigned y1 = m_bandStart[band + 1];
+    m_fn(m_src + y0 * m_srcPitch, m_srcPitch, m_dst + y0 * m_dstPitch, m_dstPitch,
+         m_width, y1 - y0, m_palette,
+         (m_index != nullptr) ? m_index + y0 * m_width : nullptr,
+         (m_used != nullptr) ? m_used + y0 : nullptr);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Worker thread, converts band number <param>
+ *
+ ************************************************************************************************/
+void *CScreenConvPool::_thread(void *param)
+{
+    unsigned band = (unsigned) (uintptr_t) param;
+
+    for (;;)
+    {
+        (void) m_start[band].wait();
+        if (!m_bRun)
+        {
+            break;
+        }
+        convertBand(band);
+        m_bandDone[band] = true;
+        m_done.set(1);
+    }
+    return nullptr;
+}
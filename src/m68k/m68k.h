@@ -79,6 +79,14 @@ enum
 	M68K_CPU_TYPE_68040		/* Supported by disassembler ONLY */
 };
 
+/* FPU modes for use in m68k_SetFpu() */
+enum
+{
+	M68K_FPU_NONE,
+	M68K_FPU_FAST,
+	M68K_FPU_EXACT
+};
+
 /* Registers used by m68k_get_reg() and m68k_set_reg() */
 typedef enum
 {
@@ -181,6 +189,20 @@ void m68k_write_memory_32(unsigned int address, unsigned int value);
  */
 void m68k_write_memory_32_pd(unsigned int address, unsigned int value);
 
+#if M68K_COPY_IDIOMS == OPT_ON
+/* Copy or fill <count> elements of <size> bytes in ascending order, with the
+ * same result as the single moves. Return 0 if a range cannot be handled as a
+ * whole, e.g. I/O, then the CPU falls back to the single moves.
+ */
+int m68k_copy_memory(unsigned int dst, unsigned int src, unsigned int size, unsigned int count);
+int m68k_fill_memory(unsigned int dst, unsigned int value, unsigned int size, unsigned int count);
+
+/* Host address of a range of regular, big-endian memory without checks, or
+ * NULL. Cached code in the range is invalidated, if <write> is set.
+ */
+unsigned char *m68k_host_memory(unsigned int address, unsigned int len, int write);
+#endif
+
 
 
 /* ======================================================================== */
@@ -297,9 +319,80 @@ void m68k_pulse_reset(void);
 #if COUNT_CYCLES == OPT_OFF
 void m68k_execute(void);
 void m68k_StopExecution(void);
+/* Interrupt controller: mark interrupt <level> 1..7 as pending, may be called
+ * from any thread. The CPU takes the highest pending level above its interrupt
+ * mask at the next instruction boundary, without leaving m68k_execute().
+ * Level 7 is not maskable.
+ */
+void m68k_RaiseIrq(unsigned level);
+/* Vector number used when <level> is acknowledged, default M68K_INT_ACK_AUTOVECTOR */
+void m68k_SetIrqVector(unsigned level, unsigned vector);
+/* Called in the emulator thread when <level> is acknowledged, returns the vector
+ * number instead of m68k_SetIrqVector(). May raise the level again.
+ */
+void m68k_SetIrqAckCallback(unsigned level, unsigned (*callback)(void));
+/* Statistics for <level>: acknowledged interrupts, raises while already pending,
+ * average and maximum latency from raise to acknowledge in ns. Returns 0 if the
+ * level was never acknowledged.
+ */
+int m68k_GetIrqStats(unsigned level, unsigned *count, unsigned *merged, unsigned *avg_ns, unsigned *max_ns);
 void m68k_exception_bus_error(void);
 void m68k_SetBaseAddr(unsigned char *p);
 void m68k_SetHiMem(unsigned hi);
+/* Run the production core (0) or the debug core with breakpoints and trace (1),
+ * takes effect on the next call of m68k_execute()
+ */
+void m68k_SetDebugCore(int enable);
+int m68k_GetDebugCore(void);
+#if M68K_BLOCK_CACHE == OPT_ON
+/* Pages with cached opcodes, checked before writing to 68k memory.
+ * Host code writing directly to 68k memory must call m68k_InvalidateCode().
+ */
+extern unsigned char sCodePages[M68K_CODE_PAGES];
+void m68k_InvalidateCode(unsigned addr, unsigned len);
+/* Use the interpreter only (0) or translate frequently executed code (1) */
+void m68k_SetJit(int enable);
+#else
+#define m68k_InvalidateCode(addr, len)
+#define m68k_SetJit(enable)
+#endif
+#if M68K_IDLE_LOOPS == OPT_ON
+/* Called when the CPU spins in an idle loop starting at <pc>, shall wait for the
+ * next interrupt. <count> is the number of calls for this loop, 0 if unknown.
+ */
+void m68k_SetIdleCallback(void (*callback)(unsigned pc, unsigned count));
+/* Statistics: start address and number of callback calls for the i-th idle loop,
+ * returns 0 if there is none
+ */
+int m68k_GetIdleLoop(unsigned i, unsigned *pc, unsigned *count);
+#else
+#define m68k_SetIdleCallback(callback)
+#define m68k_GetIdleLoop(i, pc, count)	0
+#endif
+#if M68K_EVENT_BUDGET == OPT_ON
+/* Call <callback> from inside m68k_execute(), at an instruction boundary, after
+ * <insns> instructions, 0 means at the next boundary. Only one budget is active,
+ * the callback shall set the next one. To be called from the emulator thread.
+ */
+void m68k_SetEventCallback(void (*callback)(void));
+void m68k_SetEventBudget(unsigned insns);
+/* Number of executed instructions, as counted for the budget */
+unsigned long long m68k_GetInsnCount(void);
+#else
+#define m68k_SetEventCallback(callback)
+#define m68k_SetEventBudget(insns)
+#define m68k_GetInsnCount()	0
+#endif
+#if M68K_EMULATE_FPU == OPT_ON
+/* Coprocessor instructions cause line F exceptions (M68K_FPU_NONE) or are
+ * executed with host double (M68K_FPU_FAST) or long double precision
+ * (M68K_FPU_EXACT). The latter requires a 64-bit long double mantissa, i.e.
+ * an x86 host. Call after m68k_init().
+ */
+void m68k_SetFpu(int mode);
+#else
+#define m68k_SetFpu(mode)
+#endif
 #else
 int m68k_execute(int num_cycles);
 #endif
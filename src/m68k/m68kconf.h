@@ -44,6 +44,53 @@
 // do not count cycles
 #define COUNT_CYCLES		OPT_OFF
 
+// read opcodes and extension words directly from host memory, see m68ki_read_imm_16()
+#define M68K_DIRECT_FETCH	OPT_ON
+
+// keep decoded opcodes in a block cache and run them as threaded code,
+// instead of fetching and decoding each instruction again
+#define M68K_BLOCK_CACHE	OPT_ON
+
+// translate frequently executed blocks to native code, x86-64 only,
+// can be switched off at runtime, see m68k_SetJit()
+#if defined(__x86_64__) && (M68K_BLOCK_CACHE == OPT_ON)
+#define M68K_JIT			OPT_ON
+#else
+#define M68K_JIT			OPT_OFF
+#endif
+
+// translated code: only store condition codes that are not overwritten by the
+// next instruction, otherwise calculate them when leaving the block
+#define M68K_LAZY_FLAGS		OPT_ON
+
+// detect idle loops, i.e. short loops that only test memory, and let the host
+// thread sleep until the next interrupt, see m68k_SetIdleCallback()
+#if M68K_BLOCK_CACHE == OPT_ON
+#define M68K_IDLE_LOOPS		OPT_ON
+#else
+#define M68K_IDLE_LOOPS		OPT_OFF
+#endif
+
+// run copy and fill loops like move.l (a0)+,(a1)+ / dbra d0 as a whole, and
+// MOVEM.L directly in host memory, see m68k_copy_memory()
+#if M68K_BLOCK_CACHE == OPT_ON
+#define M68K_COPY_IDIOMS	OPT_ON
+#else
+#define M68K_COPY_IDIOMS	OPT_OFF
+#endif
+
+// call the event scheduler after a given number of executed instructions,
+// from inside m68k_execute(), see m68k_SetEventCallback()
+#define M68K_EVENT_BUDGET	OPT_ON
+
+// MC68882 floating point coprocessor, see m68k_SetFpu()
+#define M68K_EMULATE_FPU	OPT_ON
+
+// granularity of cached code invalidation, 4 KiB pages
+#define M68K_CODE_PAGE_SHIFT	12
+// number of pages, for maximum Atari memory size (2 GiB)
+#define M68K_CODE_PAGES			((0x80000000U >> M68K_CODE_PAGE_SHIFT) + 1)
+
 /* ======================================================================== */
 /* ============================== MAME STUFF ============================== */
 /* ======================================================================== */
@@ -183,7 +230,7 @@ extern void m68k_clear_irq(int int_level);
 /* If ON, the enulation core will use 64-bit integers to speed up some
  * operations.
 */
-#define M68K_USE_64_BIT  OPT_OFF
+#define M68K_USE_64_BIT  OPT_ON		// AK: host multiply and divide for MULx.L and DIVx.L
 
 
 /* Set to your compiler's static inline keyword to enable it, or
@@ -3,6 +3,7 @@
 
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 
 /* ======================================================================== */
 /* ========================= LICENSING & COPYRIGHT ======================== */
@@ -40,6 +41,8 @@ static const char* copyright_notice =
 
 #include "m68kops.h"
 #include "m68kcpu.h"
+#include "m68kjit.h"
+#include "m68kfpu.h"
 
 /* ======================================================================== */
 /* ================================= DATA ================================= */
@@ -49,8 +52,22 @@ static const char* copyright_notice =
 // in case there are no cycles to count, poll variable that is set
 // from a different thread
 volatile unsigned char sExitImmediately;
+#define M68K_EXIT_STOP	0x01			// leave m68k_execute(), see m68k_StopExecution()
+#define M68K_EXIT_IRQ	0x02			// look at the pending interrupts, see m68k_RaiseIrq()
 unsigned char *sBaseAddr;						// host address of 68k address 0x00000000
 unsigned sHiMem = 0xffffffff;			// length of 68k address space
+#if M68K_DIRECT_FETCH == OPT_ON
+uint sFetchEnd;									// see m68ki_read_imm_16()
+#endif
+#if M68K_EVENT_BUDGET == OPT_ON
+static int sEventBudget = INT_MAX;				// instructions until the next event callback
+static int sEventBudgetSet = INT_MAX;			// initial value of sEventBudget
+static uint64_t sInsnCount;						// instructions before the current budget
+static void (*event_callback)(void);			// see m68k_SetEventCallback()
+#define m68ki_event_count(n)	(sEventBudget -= (int) (n))
+#else
+#define m68ki_event_count(n)
+#endif
 #else
 int  m68ki_initial_cycles;
 int  m68ki_remaining_cycles = 0;                     /* Number of clocks remaining */
@@ -524,7 +541,7 @@ static void default_instr_hook_callback(void)
 	jmp_buf m68ki_aerr_trap;
 #endif /* M68K_EMULATE_ADDRESS_ERROR */
 
-#if defined(M68K_BREAKPOINTS)
+#if COUNT_CYCLES == OPT_OFF
 static void print_cpu(int init)
 {
     static uint32_t dar_prev[16];
@@ -1197,8 +1214,8 @@ void m68k_set_cpu_type(unsigned int cpu_type)
 	}
 }
 
-#if defined(M68K_TRACE)
-uint32_t m68k_trace[M68K_TRACE][3];     // PC, d0, d1
+#if COUNT_CYCLES == OPT_OFF
+uint32_t m68k_trace[M68K_TRACE][3];     // PC, d0, a0
 unsigned m68k_trace_i = 0;
 void m68k_trace_print()
 {
@@ -1236,15 +1253,758 @@ void m68k_trace_print()
 }
 #endif
 
+#if COUNT_CYCLES == OPT_OFF && M68K_BLOCK_CACHE == OPT_ON
+/* ======================================================================== */
+/* ============================== BLOCK CACHE ============================= */
+/* ======================================================================== */
+
+/*
+ * MagiC specific: cache for decoded instructions.
+ *
+ * A block is a sequence of instructions that have been executed one after
+ * another, starting at a given 68k address. For each instruction the opcode and
+ * its handler are stored, so that on the next run the opcode is neither read
+ * via m68k_read_memory_16() nor looked up in the jump table. The handlers are
+ * just called one after the other (threaded code). Extension words are still
+ * read by the handlers themselves.
+ *
+ * Each entry remembers its 68k address and is only used if it matches the
+ * program counter, thus any branch, exception or interrupt just leaves the block.
+ *
+ * The entries of a block are restricted to the page of the start address and
+ * the following one. Pages that contain cached opcodes are marked in sCodePages[].
+ * The memory write functions check this map and call m68k_InvalidateCode(), which
+ * removes all blocks covering the page (self-modifying code, program loaded over
+ * an old one). Host code that writes directly to 68k memory, e.g. when reading
+ * files, must do the same.
+ */
+
+#define BC_BLOCKS			4096		/* number of cached blocks, power of 2 */
+#define BC_BLOCK_LEN		16			/* maximum number of instructions per block */
+#define BC_MAX_INSN_LEN		22			/* longest 68020 instruction in bytes */
+#define BC_INVALID_PC		0xffffffff	/* odd, hence never a valid start address */
+#define BC_SLOT(pc)			((((pc) >> 1) ^ ((pc) >> 13)) & (BC_BLOCKS - 1))
+#define BC_PAGE(pc)			((pc) >> M68K_CODE_PAGE_SHIFT)
+
+#define BC_JIT_THRESHOLD	50			/* block entries before translation to native code */
+#define BC_IDLE_SPINS		16			/* iterations of an idle loop before the host thread sleeps */
+#define BC_IDLE_STATS		64			/* number of idle loops with statistics */
+#define BC_IDIOM_CHUNK		4096		/* maximum elements per copy loop run, for interrupt latency */
+
+typedef struct
+{
+	unsigned n;							/* number of valid entries */
+#if M68K_JIT == OPT_ON
+	unsigned count;						/* number of entries into the block */
+	m68ki_jit_func jit;					/* translated code, or NULL */
+#endif
+#if M68K_IDLE_LOOPS == OPT_ON
+	unsigned char reads_only;			/* entries so far have no side effects */
+	unsigned char idle;					/* idle loop: index after the branch to the start, or 0 */
+#endif
+#if M68K_COPY_IDIOMS == OPT_ON
+	unsigned char idiom;				/* copy or fill loop, see m68ki_bc_run_idiom() */
+#endif
+	m68ki_bc_insn insn[BC_BLOCK_LEN];
+} m68ki_bc_block;
+
+unsigned char sCodePages[M68K_CODE_PAGES];		// non-zero: page contains cached opcodes
+static uint32_t bc_start[BC_BLOCKS];			/* start addresses, kept separate for fast invalidation */
+static m68ki_bc_block bc_blocks[BC_BLOCKS];
+static m68ki_bc_block *bc_cur;					/* block being executed, or NULL */
+static unsigned bc_idx;							/* index of next entry in bc_cur */
+#if M68K_JIT == OPT_ON
+static int jit_enabled;							/* translate hot blocks */
+static unsigned jit_depth;						/* translated code running, maybe nested */
+static unsigned bc_generation;					/* changes when cached code becomes invalid */
+#endif
+#if M68K_IDLE_LOOPS == OPT_ON
+static void (*idle_callback)(unsigned pc, unsigned count);
+static unsigned idle_spins;						/* iterations of the current idle loop */
+static struct
+{
+	uint32_t pc;
+	unsigned count;
+} idle_stats[BC_IDLE_STATS];
+#endif
+
+/* Remove a block */
+INLINE void m68ki_bc_kill(unsigned slot, uint32_t start)
+{
+	bc_start[slot] = start;
+	bc_blocks[slot].n = 0;
+#if M68K_JIT == OPT_ON
+	bc_blocks[slot].count = 0;
+	bc_blocks[slot].jit = NULL;
+#endif
+#if M68K_IDLE_LOOPS == OPT_ON
+	bc_blocks[slot].reads_only = 1;
+	bc_blocks[slot].idle = 0;
+#endif
+#if M68K_COPY_IDIOMS == OPT_ON
+	bc_blocks[slot].idiom = 0;
+#endif
+}
+
+/* Remove all cached blocks, e.g. after reset */
+static void m68ki_bc_flush(void)
+{
+	for (unsigned i = 0; i < BC_BLOCKS; i++)
+	{
+		m68ki_bc_kill(i, BC_INVALID_PC);
+	}
+	memset(sCodePages, 0, sizeof(sCodePages));
+	bc_cur = NULL;
+#if M68K_JIT == OPT_ON
+	bc_generation++;
+	if (jit_depth == 0)
+	{
+		/* the code buffer may only be reused if no translated code is on the stack */
+		m68ki_jit_flush();
+	}
+#endif
+}
+
+/* Switch translation to native code on or off */
+void m68k_SetJit(int enable)
+{
+#if M68K_JIT == OPT_ON
+#if M68K_EVENT_BUDGET == OPT_ON
+	int *p_budget = &sEventBudget;
+#else
+	int *p_budget = NULL;
+#endif
+	if (enable && !jit_enabled && (m68ki_jit_init(&bc_generation, p_budget) != 0))
+	{
+		enable = 0;
+	}
+	m68ki_bc_flush();
+	jit_enabled = enable;
+#else
+	(void) enable;
+#endif
+}
+
+#if M68K_IDLE_LOOPS == OPT_ON
+void m68k_SetIdleCallback(void (*callback)(unsigned pc, unsigned count))
+{
+	idle_callback = callback;
+}
+
+int m68k_GetIdleLoop(unsigned i, unsigned *pc, unsigned *count)
+{
+	if ((i >= BC_IDLE_STATS) || (idle_stats[i].count == 0))
+	{
+		return 0;
+	}
+	*pc = idle_stats[i].pc;
+	*count = idle_stats[i].count;
+	return 1;
+}
+#endif
+
+/* Remove all cached blocks covering the given 68k address range */
+void m68k_InvalidateCode(unsigned addr, unsigned len)
+{
+	if ((len == 0) || (addr >= sHiMem))
+	{
+		return;
+	}
+	if (len > sHiMem - addr)
+	{
+		len = sHiMem - addr;
+	}
+
+	unsigned last = BC_PAGE(addr + len - 1);
+	for (unsigned page = BC_PAGE(addr); page <= last; page++)
+	{
+		if (!sCodePages[page])
+		{
+			continue;
+		}
+		for (unsigned i = 0; i < BC_BLOCKS; i++)
+		{
+			unsigned start_page = BC_PAGE(bc_start[i]);
+			if ((start_page == page) || (start_page + 1 == page))
+			{
+				m68ki_bc_kill(i, BC_INVALID_PC);
+			}
+		}
+		sCodePages[page] = 0;
+		/* the running block might be gone, look it up again */
+		bc_cur = NULL;
+#if M68K_JIT == OPT_ON
+		bc_generation++;
+#endif
+	}
+}
+
+/* Check if the instruction at <pc> may be appended to the block */
+INLINE int m68ki_bc_may_append(const m68ki_bc_block *b, uint32_t start, uint32_t pc)
+{
+	if (b->n == 0)
+	{
+		return 1;
+	}
+	if (b->n >= BC_BLOCK_LEN)
+	{
+		return 0;
+	}
+	uint32_t prev = b->insn[b->n - 1].pc;
+	/* straight-line code only, backward branches start their own block */
+	return (pc > prev) && (pc - prev <= BC_MAX_INSN_LEN) && (BC_PAGE(pc) - BC_PAGE(start) <= 1);
+}
+
+#if M68K_IDLE_LOOPS == OPT_ON
+/*
+ * Idle loop detection.
+ *
+ * A block that branches back to its start, and before only tests or compares
+ * registers or regular memory at fixed addresses, has no side effects except
+ * on the condition codes. Once the branch is taken, it will be taken again and
+ * again, until an interrupt changes the memory. Examples are polling _hz_200 or
+ * a flag set by an interrupt handler. After some iterations the host thread is
+ * sent to sleep by the idle callback, until the next interrupt arrives.
+ */
+
+/* Check for a read-only operand at a fixed address, <ext> is the address of its extension words */
+static int m68ki_bc_fixed_operand(unsigned mode, unsigned reg, uint32_t ext, unsigned size)
+{
+	uint32_t addr;
+
+	if ((mode == 0) || (mode == 1))
+	{
+		return 1;		/* data or address register */
+	}
+	if ((mode != 7) || (ext > sHiMem - 4))
+	{
+		return 0;		/* address depends on address register */
+	}
+	switch(reg)
+	{
+		case 0: addr = (uint32_t) (int16_t) m68k_read_memory_16(ext); break;		/* abs.w */
+		case 1: addr = m68k_read_memory_32(ext); break;								/* abs.l */
+		case 2: addr = ext + (uint32_t) (int16_t) m68k_read_memory_16(ext); break;	/* d16(pc) */
+		case 4: return 1;															/* immediate */
+		default: return 0;
+	}
+	/* regular memory only, I/O registers may change when read, 0..7 may cause a bus error */
+	return (addr >= 8) && (addr < sHiMem) && (size <= sHiMem - addr);
+}
+
+/* Check for tst, cmp, cmpa, cmpi or btst without side effects */
+static int m68ki_bc_reads_only(const m68ki_bc_insn *e)
+{
+	unsigned ir = e->ir;
+	unsigned mode = (ir >> 3) & 7;
+	unsigned size = 1U << ((ir >> 6) & 3);
+	uint32_t ext = e->pc + 2;
+
+	if (e->handler == m68k_op_illegal)
+	{
+		return 0;
+	}
+	if (((ir & 0xff00) == 0x4a00) && ((ir & 0xc0) != 0xc0))
+	{
+		/* tst */
+	}
+	else
+	if (((ir & 0xf100) == 0xb000) && ((ir & 0xc0) != 0xc0))
+	{
+		/* cmp <ea>,dn */
+	}
+	else
+	if ((ir & 0xf0c0) == 0xb0c0)
+	{
+		/* cmpa <ea>,an */
+		size = (ir & 0x100) ? 4 : 2;
+	}
+	else
+	if (((ir & 0xff00) == 0x0c00) && ((ir & 0xc0) != 0xc0))
+	{
+		/* cmpi #imm,<ea> */
+		ext += (size == 4) ? 4 : 2;
+	}
+	else
+	if ((ir & 0xffc0) == 0x0800)
+	{
+		/* btst #n,<ea> */
+		size = 1;
+		ext += 2;
+	}
+	else
+	if (((ir & 0xf1c0) == 0x0100) && (mode != 1))
+	{
+		/* btst dn,<ea>, mode 1 is movep */
+		size = 1;
+	}
+	else
+	{
+		return 0;
+	}
+
+	return m68ki_bc_fixed_operand(mode, ir & 7, ext, size);
+}
+
+/* Check for a conditional or unconditional branch to <start> */
+static int m68ki_bc_branches_to(const m68ki_bc_insn *e, uint32_t start)
+{
+	unsigned ir = e->ir;
+	uint32_t target = e->pc + 2;
+
+	if (((ir & 0xf000) != 0x6000) || ((ir & 0x0f00) == 0x0100))
+	{
+		return 0;		/* no branch, or bsr */
+	}
+	switch(ir & 0xff)
+	{
+		case 0x00: target += (uint32_t) (int16_t) m68k_read_memory_16(e->pc + 2); break;
+		case 0xff: target += m68k_read_memory_32(e->pc + 2); break;
+		default: target += (uint32_t) (int8_t) ir; break;
+	}
+	return target == start;
+}
+
+/* Classify the instruction just appended to the block */
+static void m68ki_bc_classify(m68ki_bc_block *b, const m68ki_bc_insn *e)
+{
+	if (!b->reads_only || b->idle || (e->pc > sHiMem - 6))
+	{
+		return;
+	}
+	if (m68ki_bc_branches_to(e, bc_start[b - bc_blocks]))
+	{
+		b->idle = (unsigned char) (e - b->insn + 1);
+	}
+	else
+	if (!m68ki_bc_reads_only(e))
+	{
+		b->reads_only = 0;
+	}
+}
+
+/* The CPU spins in the idle loop at <pc>, let the host thread sleep */
+static void m68ki_idle_park(uint32_t pc)
+{
+	idle_spins = 0;
+	if (sExitImmediately || (idle_callback == NULL))
+	{
+		return;		/* interrupt already pending */
+	}
+
+	unsigned count = 0;
+	for (unsigned i = 0; i < BC_IDLE_STATS; i++)
+	{
+		if ((idle_stats[i].count == 0) || (idle_stats[i].pc == pc))
+		{
+			idle_stats[i].pc = pc;
+			count = ++idle_stats[i].count;
+			break;
+		}
+	}
+	idle_callback(pc, count);
+}
+
+/* Block <b> is entered, count the iterations of an idle loop */
+INLINE void m68ki_bc_enter_idle(const m68ki_bc_block *b)
+{
+	if (b->idle)
+	{
+		if ((bc_cur == b) && (bc_idx == b->idle))
+		{
+			/* the branch back to the start was taken */
+			if (++idle_spins >= BC_IDLE_SPINS)
+			{
+				m68ki_idle_park(bc_start[b - bc_blocks]);
+			}
+		}
+		else
+		{
+			idle_spins = 0;
+		}
+	}
+}
+#endif
+
+#if M68K_COPY_IDIOMS == OPT_ON
+/*
+ * Copy and fill loops.
+ *
+ * A block that starts with
+ *   move.<size> (Ay)+,(Ax)+  or  move.<size> Dy,(Ax)+  or  clr.<size> (Ax)+
+ *   dbra Dn,<start>
+ * is run as a whole by the host, as long as both memory ranges are regular
+ * memory or video memory. Long loops are split into chunks, so that
+ * interrupts are still handled in time.
+ */
+
+#define BC_IDIOM_COPY		1			/* move (Ay)+,(Ax)+ */
+#define BC_IDIOM_FILL		2			/* move Dy,(Ax)+ */
+#define BC_IDIOM_CLEAR		3			/* clr (Ax)+ */
+
+/* Operand size of the move or clr instruction, or 0 */
+static unsigned m68ki_bc_idiom_size(unsigned ir, unsigned idiom)
+{
+	static const unsigned char move_size[4] = { 0, 1, 4, 2 };
+
+	if (idiom == BC_IDIOM_CLEAR)
+	{
+		return ((ir & 0xc0) == 0xc0) ? 0 : 1U << ((ir >> 6) & 3);
+	}
+	return move_size[(ir >> 12) & 3];
+}
+
+/* Classify the block, after its second instruction was appended */
+static void m68ki_bc_classify_idiom(m68ki_bc_block *b)
+{
+	unsigned ir = b->insn[0].ir;
+	unsigned idiom;
+
+	if ((b->n != 2) || ((b->insn[1].ir & 0xfff8) != 0x51c8) || (b->insn[0].pc > sHiMem - 6) ||
+		(m68k_read_memory_16(b->insn[0].pc + 4) != 0xfffc))
+	{
+		return;		/* no dbra back to the start */
+	}
+	if (((ir & 0xc1f8) == 0x00d8) && (((ir >> 9) & 7) != (ir & 7)))
+	{
+		idiom = BC_IDIOM_COPY;
+	}
+	else
+	if ((ir & 0xc1f8) == 0x00c0)
+	{
+		idiom = BC_IDIOM_FILL;
+	}
+	else
+	if ((ir & 0xff38) == 0x4218)
+	{
+		idiom = BC_IDIOM_CLEAR;
+	}
+	else
+	{
+		return;
+	}
+	unsigned size = m68ki_bc_idiom_size(ir, idiom);
+	unsigned dreg = (idiom == BC_IDIOM_CLEAR) ? (ir & 7) : ((ir >> 9) & 7);
+	if ((size == 0) || ((size == 1) && ((dreg == 7) || ((idiom == BC_IDIOM_COPY) && ((ir & 7) == 7)))))
+	{
+		return;		/* invalid size, or byte access with A7, which is incremented by 2 */
+	}
+	if ((idiom == BC_IDIOM_FILL) && ((ir & 7) == (b->insn[1].ir & 7)))
+	{
+		return;		/* the fill value is the loop counter */
+	}
+	b->idiom = (unsigned char) idiom;
+}
+
+/* Run the copy or fill loop of block <b>, returns 0 if it must be interpreted */
+static int m68ki_bc_run_idiom(const m68ki_bc_block *b)
+{
+	uint32_t start = bc_start[b - bc_blocks];	/* the copy or fill may kill the block */
+	unsigned ir = b->insn[0].ir;
+	unsigned idiom = b->idiom;
+	unsigned size = m68ki_bc_idiom_size(ir, idiom);
+	uint *counter = &REG_D[b->insn[1].ir & 7];
+	uint *dst = &REG_A[(idiom == BC_IDIOM_CLEAR) ? (ir & 7) : ((ir >> 9) & 7)];
+	uint count = MASK_OUT_ABOVE_16(*counter) + 1;
+	uint n = (count > BC_IDIOM_CHUNK) ? BC_IDIOM_CHUNK : count;
+	uint value;
+
+	if (m68ki_tracing)
+	{
+		return 0;
+	}
+	if (idiom == BC_IDIOM_COPY)
+	{
+		uint *src = &REG_A[ir & 7];
+		if (!m68k_copy_memory(*dst, *src, size, n))
+		{
+			return 0;
+		}
+		*src += n * size;
+		value = (size == 1) ? m68ki_read_8(*dst + (n - 1) * size) :
+				(size == 2) ? m68ki_read_16(*dst + (n - 1) * size) : m68ki_read_32(*dst + (n - 1) * size);
+	}
+	else
+	{
+		value = 0;
+		if (idiom == BC_IDIOM_FILL)
+		{
+			value = REG_D[ir & 7] & ((size == 4) ? 0xffffffff : (1U << (8 * size)) - 1);
+		}
+		if (!m68k_fill_memory(*dst, value, size, n))
+		{
+			return 0;
+		}
+	}
+	*dst += n * size;
+	*counter = MASK_OUT_BELOW_16(*counter) | MASK_OUT_ABOVE_16(*counter - n);
+	m68ki_event_count(2 * n - 1);	/* move and dbra, one is counted by the main loop */
+
+	/* condition codes of the last move or clr */
+	FLAG_N = (size == 1) ? NFLAG_8(value) : (size == 2) ? NFLAG_16(value) : NFLAG_32(value);
+	FLAG_Z = value;
+	FLAG_V = VFLAG_CLEAR;
+	FLAG_C = CFLAG_CLEAR;
+
+	/* continue after the dbra, or with the next chunk */
+	REG_PC = start + ((n == count) ? 6 : 0);
+	return 1;
+}
+#endif
+
+/* Slow path: look up or record the instruction at the program counter */
+static void m68ki_bc_miss(void)
+{
+	uint32_t pc = REG_PC;
+
+	if ((CPU_ADDRESS_MASK != 0xffffffff) || (pc & 1) || (pc >= sHiMem - 1))
+	{
+		/* not in regular memory, e.g. video memory, or 24-bit CPU: not cached */
+		bc_cur = NULL;
+		REG_IR = m68ki_read_imm_16();
+		m68ki_instruction_jump_table[REG_IR]();
+		return;
+	}
+
+	m68ki_bc_block *b = bc_cur;
+	uint32_t start = (b != NULL) ? bc_start[b - bc_blocks] : BC_INVALID_PC;
+	if ((b == NULL) || (bc_idx != b->n) || !m68ki_bc_may_append(b, start, pc))
+	{
+		/* leave the current block and continue with the one starting here */
+		unsigned slot = BC_SLOT(pc);
+		b = &bc_blocks[slot];
+		if (bc_start[slot] != pc)
+		{
+			/* replace old block */
+			m68ki_bc_kill(slot, pc);
+		}
+#if M68K_IDLE_LOOPS == OPT_ON
+		m68ki_bc_enter_idle(b);
+#endif
+#if M68K_COPY_IDIOMS == OPT_ON
+		if (b->idiom && m68ki_bc_run_idiom(b))
+		{
+			bc_cur = NULL;
+			return;
+		}
+#endif
+		bc_cur = b;
+#if M68K_JIT == OPT_ON
+		/* idle loops are not translated, they shall return here */
+		if (jit_enabled && !m68ki_tracing && (b->n > 1)
+#if M68K_IDLE_LOOPS == OPT_ON
+			&& !b->idle
+#endif
+			)
+		{
+			if ((b->jit == NULL) && (++b->count >= BC_JIT_THRESHOLD))
+			{
+				b->jit = m68ki_jit_compile(b->insn, b->n);
+				if (b->jit == NULL)
+				{
+					b->count = 0;
+					if (jit_depth == 0)
+					{
+						/* code buffer is full, start again */
+						m68ki_bc_flush();
+						m68ki_bc_miss();
+						return;
+					}
+				}
+			}
+			if (b->jit != NULL)
+			{
+				jit_depth++;
+				bc_idx = b->jit();
+				jit_depth--;
+				m68ki_event_count(bc_idx - 1);
+				return;
+			}
+		}
+#endif
+		if (b->n > 0)
+		{
+			const m68ki_bc_insn *e = &b->insn[0];
+			bc_idx = 1;
+			REG_IR = e->ir;
+			REG_PC += 2;
+			e->handler();
+			return;
+		}
+	}
+
+	/* decode the instruction and append it to the current block */
+	m68ki_bc_insn *e = &b->insn[b->n++];
+	bc_idx = b->n;
+	e->pc = pc;
+	e->ir = (uint16_t) m68ki_read_imm_16();
+	e->handler = m68ki_instruction_jump_table[e->ir];
+	sCodePages[BC_PAGE(pc)] = 1;
+#if M68K_IDLE_LOOPS == OPT_ON
+	m68ki_bc_classify(b, e);
+#endif
+#if M68K_COPY_IDIOMS == OPT_ON
+	m68ki_bc_classify_idiom(b);
+#endif
+	REG_IR = e->ir;
+	e->handler();
+}
+
+/* Execute one instruction, from the current block, if possible */
+INLINE void m68ki_bc_execute(void)
+{
+	m68ki_bc_block *b = bc_cur;
+	if ((b == NULL) || (bc_idx >= b->n) || (b->insn[bc_idx].pc != REG_PC))
+	{
+		/* fast path for entering a complete block, e.g. loops */
+		unsigned slot = BC_SLOT(REG_PC);
+		b = &bc_blocks[slot];
+		if ((bc_start[slot] != REG_PC) || (b->n == 0)
+#if M68K_JIT == OPT_ON
+			|| jit_enabled
+#endif
+			)
+		{
+			m68ki_bc_miss();
+			return;
+		}
+#if M68K_IDLE_LOOPS == OPT_ON
+		m68ki_bc_enter_idle(b);
+#endif
+#if M68K_COPY_IDIOMS == OPT_ON
+		if (b->idiom && m68ki_bc_run_idiom(b))
+		{
+			bc_cur = NULL;
+			return;
+		}
+#endif
+		bc_cur = b;
+		bc_idx = 0;
+	}
+	const m68ki_bc_insn *e = &b->insn[bc_idx++];
+	REG_IR = e->ir;
+	REG_PC += 2;
+	e->handler();
+}
+#endif
+
 /* Execute some instructions until we use up num_cycles clock cycles */
 /* ASG: removed per-instruction interrupt checks */
 #if COUNT_CYCLES == OPT_OFF
-void m68k_execute(void)
+
+/*
+ * MagiC specific: debug core.
+ *
+ * The main loop exists twice, as production core and as instrumented debug
+ * core. The latter checks the breakpoints in m68k_breakpoints[], records the
+ * trace in m68k_trace[] and runs each instruction in the interpreter, i.e.
+ * without block cache and translated code. The core is selected on each entry
+ * into m68k_execute(), see m68k_SetDebugCore().
+ */
+
+#if defined(__GNUC__)
+#define M68K_ALWAYS_INLINE	static __inline__ __attribute__((always_inline))
+#else
+#define M68K_ALWAYS_INLINE	INLINE
+#endif
+
+static int sDebugCore;		/* non-zero: run the debug core */
+
+/* Debug core: check breakpoints and record trace, before each instruction */
+static void m68ki_debug_insn(void)
 {
-	/* Return point if we had an address error */
-	m68ki_set_address_error_trap(); /* auto-disable (see m68kcpu.h) */
+	static uint32_t pc_ringbuf[32];
+	static unsigned pc_ringbuf_index = 0;
 
-	/* Main loop.  Keep going until we run out of clock cycles */
+	// 68k breakpoints from host, for debugging 68k code
+	if (REG_SP < 0x100)
+	{
+		for (int i = 0; i < 32; i++)
+		{
+			uint32_t prevpc = pc_ringbuf[(32 + pc_ringbuf_index - i - 1) % 32];
+			printf(" PC was 0x%08x (OS rel 0x%06x)\n", prevpc, prevpc - addrOsRomStart);
+		}
+#ifndef NDEBUG
+		extern void print_app(uint32_t addr68k);
+		print_app(REG_A[3]);    // old context
+		print_app(REG_A[0]);    // new context
+#endif
+		printf("The SP should not be in this range\n");   // <<<<<<<===== Set host debugger breakpoint here
+	}
+
+	for (unsigned i = 0; i < M68K_BREAKPOINTS; i++)
+	{
+		/* entries with end address 0 are unused */
+		if ((m68k_breakpoints[i][1] != 0) &&
+			(REG_PC >= m68k_breakpoints[i][0]) && (REG_PC <= m68k_breakpoints[i][1]))
+		{
+#ifndef NDEBUG
+			int68k_enable(0);
+#endif
+			printf("68k breakpoint reached\n");   // <<<<<<<===== Set host debugger breakpoint here
+			print_cpu(1);
+			for (int j = 0; j < 32; j++)
+			{
+				uint32_t prevpc = pc_ringbuf[(32 + pc_ringbuf_index - j - 1) % 32];
+				printf(" PC was 0x%08x (OS rel 0x%06x)\n", prevpc, prevpc - addrOsRomStart);
+			}
+		}
+	}
+
+	pc_ringbuf[pc_ringbuf_index] = REG_PC;
+	pc_ringbuf_index++;
+	pc_ringbuf_index %= 32;
+
+	m68k_trace[m68k_trace_i][0] = REG_PC;
+	m68k_trace[m68k_trace_i][1] = REG_D[0];
+	m68k_trace[m68k_trace_i][2] = REG_A[0];
+	m68k_trace_i++;
+	m68k_trace_i %= M68K_TRACE;
+}
+
+#if M68K_EVENT_BUDGET == OPT_ON
+/*
+ * MagiC specific: event budget.
+ *
+ * The event callback is called from the main loop, at an instruction
+ * boundary, when the number of instructions given by m68k_SetEventBudget()
+ * has been executed. It shall set the next budget, otherwise it is called
+ * again after INT_MAX instructions. Copy idioms and translated loops count
+ * their iterations, so the budget is only approximate.
+ */
+void m68k_SetEventCallback(void (*callback)(void))
+{
+	event_callback = callback;
+}
+
+void m68k_SetEventBudget(unsigned insns)
+{
+	if (insns > INT_MAX)
+	{
+		insns = INT_MAX;
+	}
+	sInsnCount += (uint64_t) (sEventBudgetSet - sEventBudget);
+	sEventBudget = sEventBudgetSet = (int) insns;
+}
+
+unsigned long long m68k_GetInsnCount(void)
+{
+	return sInsnCount + (uint64_t) (sEventBudgetSet - sEventBudget);
+}
+
+static void m68ki_event_expired(void)
+{
+	m68k_SetEventBudget(INT_MAX);
+	if (event_callback != NULL)
+	{
+		event_callback();
+	}
+}
+#endif
+
+/* Main loop, inlined once for each core. Keep going until we shall exit */
+M68K_ALWAYS_INLINE void m68ki_execute_loop(const int debug)
+{
 	while(!sExitImmediately)
 	{
 		/* Set tracing accodring to T1. (T0 is done inside instruction) */
@@ -1259,61 +2019,35 @@ void m68k_execute(void)
 		/* Record previous program counter */
 		REG_PPC = REG_PC;
 
-
-        // 68k breakpoints from host, for debugging 68k code
-        #if defined(M68K_BREAKPOINTS)
-        static uint32_t pc_ringbuf[32];
-        static unsigned pc_ringbuf_index = 0;
-        extern void print_app(uint32_t addr68k);
-
-        if (REG_SP < 0x100)
-        {
-            for (int i = 0; i < 32; i++)
-            {
-                uint32_t prevpc = pc_ringbuf[(32 + pc_ringbuf_index - i - 1) % 32];
-                printf(" PC was 0x%08x (OS rel 0x%06x)\n", prevpc, prevpc - 0x007c9c68);
-            }
-            print_app(REG_A[3]);    // old context
-            print_app(REG_A[0]);    // new context
-            printf("The SP should not be in this range\n");   // <<<<<<<===== Set host debugger breakpoint here
-        }
-
-        for (unsigned i = 0; i < M68K_BREAKPOINTS; i++)
-        {
-            if ((REG_PC >= m68k_breakpoints[i][0]) && (REG_PC <= m68k_breakpoints[i][1]))
-            {
-                int68k_enable(0);
-                printf("68k breakpoint reached\n");   // <<<<<<<===== Set host debugger breakpoint here
-                print_cpu(1);
-                for (int i = 0; i < 32; i++)
-                {
-                    uint32_t prevpc = pc_ringbuf[(32 + pc_ringbuf_index - i - 1) % 32];
-                    printf(" PC was 0x%08x (OS rel 0x%06x)\n", prevpc, prevpc - 0x007c9c68);
-                }
-            }
-        }
-
-        pc_ringbuf[pc_ringbuf_index] = REG_PC;
-        pc_ringbuf_index++;
-        pc_ringbuf_index %= 32;
-
-        #endif  // M68K_BREAKPOINTS
-
-		#if defined(M68K_TRACE)
-		m68k_trace[m68k_trace_i][0] = REG_PC;
-		m68k_trace[m68k_trace_i][1] = REG_D[0];
-		m68k_trace[m68k_trace_i][2] = REG_A[0];
-        m68k_trace_i++;
-		m68k_trace_i %= M68K_TRACE;
-		#endif
-
-		/* Read an instruction and call its handler */
-		REG_IR = m68ki_read_imm_16();
-		m68ki_instruction_jump_table[REG_IR]();
+		if (debug)
+		{
+			/* Check breakpoints, then read an instruction and call its handler */
+			m68ki_debug_insn();
+			REG_IR = m68ki_read_imm_16();
+			m68ki_instruction_jump_table[REG_IR]();
+		}
+		else
+		{
+#if M68K_BLOCK_CACHE == OPT_ON
+			/* Take the decoded instruction from the block cache or read it, and call its handler */
+			m68ki_bc_execute();
+#else
+			/* Read an instruction and call its handler */
+			REG_IR = m68ki_read_imm_16();
+			m68ki_instruction_jump_table[REG_IR]();
+#endif
+		}
 
 		/* Trace m68k_exception, if necessary */
 		m68ki_exception_if_trace(); /* auto-disable (see m68kcpu.h) */
 
+#if M68K_EVENT_BUDGET == OPT_ON
+		if (--sEventBudget <= 0)
+		{
+			m68ki_event_expired();
+		}
+#endif
+
 #if defined(DEBUG_68K_EMU)
 	#if defined(TRACE_BUFLEN)
 		m68k_trace_state();
@@ -1322,6 +2056,158 @@ void m68k_execute(void)
 	#endif
 #endif
 	}
+}
+
+/*
+ * MagiC specific: interrupt controller.
+ *
+ * Interrupt sources in other threads set the bit for their level in
+ * sIrqPending and make the loop stop at the next instruction boundary, see
+ * M68K_EXIT_IRQ. The highest pending level becomes the interrupt request of
+ * the CPU, which takes it as soon as the interrupt mask allows, also later
+ * when the mask is lowered by RTE or MOVE to SR. The bit is cleared when the
+ * CPU acknowledges the interrupt. A level that is raised again while still
+ * pending is only taken once.
+ */
+
+typedef struct
+{
+	uint64_t raised;			/* time of the last raise, in ns */
+	uint64_t total;				/* sum of latencies, in ns */
+	unsigned count;				/* acknowledged interrupts */
+	unsigned merged;			/* raised while already pending */
+	unsigned max;				/* maximum latency, in ns */
+} m68ki_irq_stats;
+
+static uint32_t sIrqPending;					/* bit n: level n is pending */
+static unsigned sIrqVector[8] =
+{
+	M68K_INT_ACK_AUTOVECTOR, M68K_INT_ACK_AUTOVECTOR, M68K_INT_ACK_AUTOVECTOR, M68K_INT_ACK_AUTOVECTOR,
+	M68K_INT_ACK_AUTOVECTOR, M68K_INT_ACK_AUTOVECTOR, M68K_INT_ACK_AUTOVECTOR, M68K_INT_ACK_AUTOVECTOR
+};
+static unsigned (*irq_ack_callback[8])(void);	/* see m68k_SetIrqAckCallback() */
+static m68ki_irq_stats sIrqStats[8];
+
+static uint64_t m68ki_irq_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+}
+
+/* Highest level in <pending>, as interrupt request, i.e. shifted like the SR mask */
+INLINE uint m68ki_irq_level(uint32_t pending)
+{
+	return pending ? (31U - (uint) __builtin_clz(pending)) << 8 : 0;
+}
+
+void m68k_RaiseIrq(unsigned level)
+{
+	uint32_t bit;
+
+	level &= 7;
+	bit = 1U << level;
+	if (__atomic_load_n(&sIrqPending, __ATOMIC_RELAXED) & bit)
+	{
+		__atomic_fetch_add(&sIrqStats[level].merged, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	__atomic_store_n(&sIrqStats[level].raised, m68ki_irq_now(), __ATOMIC_RELAXED);
+	__atomic_fetch_or(&sIrqPending, bit, __ATOMIC_RELEASE);
+	__atomic_fetch_or(&sExitImmediately, M68K_EXIT_IRQ, __ATOMIC_RELEASE);
+}
+
+void m68k_SetIrqVector(unsigned level, unsigned vector)
+{
+	sIrqVector[level & 7] = vector;
+}
+
+void m68k_SetIrqAckCallback(unsigned level, unsigned (*callback)(void))
+{
+	irq_ack_callback[level & 7] = callback;
+}
+
+int m68k_GetIrqStats(unsigned level, unsigned *count, unsigned *merged, unsigned *avg_ns, unsigned *max_ns)
+{
+	const m68ki_irq_stats *st = &sIrqStats[level & 7];
+
+	*count = st->count;
+	*merged = st->merged;
+	*avg_ns = st->count ? (unsigned) (st->total / st->count) : 0;
+	*max_ns = st->max;
+	return st->count != 0;
+}
+
+/* Make the highest pending level the interrupt request, and take it if possible */
+static void m68ki_irq_update(void)
+{
+	uint32_t pending = __atomic_load_n(&sIrqPending, __ATOMIC_ACQUIRE);
+
+	if (pending)
+	{
+		CPU_INT_LEVEL = m68ki_irq_level(pending);
+		if (CPU_INT_LEVEL == 0x0700)
+		{
+			m68ki_exception_interrupt(7);	/* NMI, not maskable */
+		}
+		else
+		{
+			m68ki_check_interrupts();
+		}
+	}
+}
+
+/* Called by m68ki_exception_interrupt(), returns the vector number */
+uint m68ki_irq_ack(uint int_level)
+{
+	uint32_t bit = 1U << int_level;
+	uint32_t pending = __atomic_fetch_and(&sIrqPending, ~bit, __ATOMIC_ACQ_REL);
+
+	if (!(pending & bit))
+	{
+		/* requested by m68k_set_irq() */
+		return m68ki_int_ack(int_level);
+	}
+
+	/* the next lower level waits until the mask allows it */
+	CPU_INT_LEVEL = m68ki_irq_level(pending & ~bit);
+
+	m68ki_irq_stats *st = &sIrqStats[int_level];
+	uint64_t latency = m68ki_irq_now() - __atomic_load_n(&st->raised, __ATOMIC_RELAXED);
+	st->count++;
+	st->total += latency;
+	if (latency > st->max)
+	{
+		st->max = (latency > UINT_MAX) ? UINT_MAX : (unsigned) latency;
+	}
+	if (irq_ack_callback[int_level] != NULL)
+	{
+		/* e.g. a peripheral that multiplexes several sources on this level */
+		return irq_ack_callback[int_level]();
+	}
+	return sIrqVector[int_level];
+}
+
+void m68k_execute(void)
+{
+	/* Return point if we had an address error */
+	m68ki_set_address_error_trap(); /* auto-disable (see m68kcpu.h) */
+
+	do
+	{
+		/* interrupts raised while we were not running, or since the last instruction */
+		m68ki_irq_update();
+
+		if (sDebugCore)
+		{
+			m68ki_execute_loop(1);
+		}
+		else
+		{
+			m68ki_execute_loop(0);
+		}
+	}
+	while (!(__atomic_and_fetch(&sExitImmediately, (unsigned char) ~M68K_EXIT_IRQ, __ATOMIC_ACQUIRE) & M68K_EXIT_STOP));
 
 	sExitImmediately = 0;
 
@@ -1329,9 +2215,23 @@ void m68k_execute(void)
 	REG_PPC = REG_PC;
 }
 
+void m68k_SetDebugCore(int enable)
+{
+#if M68K_BLOCK_CACHE == OPT_ON
+	/* the debug core does not follow the current block */
+	bc_cur = NULL;
+#endif
+	sDebugCore = enable;
+}
+
+int m68k_GetDebugCore(void)
+{
+	return sDebugCore;
+}
+
 void m68k_StopExecution(void)
 {
-	sExitImmediately = 1;
+	__atomic_fetch_or(&sExitImmediately, M68K_EXIT_STOP, __ATOMIC_RELEASE);
 }
 
 void m68k_SetBaseAddr(unsigned char *p)
@@ -1342,7 +2242,22 @@ void m68k_SetBaseAddr(unsigned char *p)
 void m68k_SetHiMem(unsigned hi)
 {
 	sHiMem = hi;
+#if M68K_DIRECT_FETCH == OPT_ON
+	/* direct instruction fetch from regular memory, requires m68k_SetBaseAddr() before */
+	sFetchEnd = ((sBaseAddr != NULL) && (hi != 0xffffffff) && (hi >= M68K_FETCH_START + 4)) ? hi - 3 : 0;
+#endif
+}
+
+#if M68K_EMULATE_FPU == OPT_ON
+void m68k_SetFpu(int mode)
+{
+	m68ki_fpu_init(mode);
+#if M68K_BLOCK_CACHE == OPT_ON
+	/* cached blocks contain the old opcode handlers */
+	m68ki_bc_flush();
+#endif
 }
+#endif
 
 void m68k_exception_bus_error(void)
 {
@@ -1601,6 +2516,12 @@ void m68k_pulse_reset(void)
 {
 	#if COUNT_CYCLES == OPT_OFF
 	sExitImmediately = 0;
+	#if M68K_BLOCK_CACHE == OPT_ON
+	m68ki_bc_flush();
+	#endif
+	#endif
+	#if M68K_EMULATE_FPU == OPT_ON
+	m68ki_fpu_reset();
 	#endif
 	/* Clear all stop levels and eat up all remaining cycles */
 	CPU_STOPPED = 0;
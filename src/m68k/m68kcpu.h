@@ -28,6 +28,9 @@
 
 #include "m68k.h"
 #include <limits.h>
+#if (COUNT_CYCLES == OPT_OFF && M68K_DIRECT_FETCH == OPT_ON) || M68K_COPY_IDIOMS == OPT_ON
+#include "Globals.h"	/* getAtariBE16() etc., alignment-safe */
+#endif
 
 #if M68K_EMULATE_ADDRESS_ERROR
 #include <setjmp.h>
@@ -1021,6 +1024,10 @@ INLINE void m68ki_exception_format_error(void);
 INLINE void m68ki_exception_address_error(void);
 INLINE void m68ki_exception_interrupt(uint int_level);
 INLINE void m68ki_check_interrupts(void);            /* ASG: check for interrupts */
+#if COUNT_CYCLES == OPT_OFF
+/* MagiC specific: acknowledge an interrupt, see m68k_RaiseIrq() */
+uint m68ki_irq_ack(uint int_level);
+#endif
 
 /* quick disassembly (used for logging) */
 char* m68ki_disassemble_quick(unsigned int pc, unsigned int cpu_type);
@@ -1033,6 +1040,21 @@ char* m68ki_disassemble_quick(unsigned int pc, unsigned int cpu_type);
 
 /* ---------------------------- Read Immediate ---------------------------- */
 
+#if COUNT_CYCLES == OPT_OFF && M68K_DIRECT_FETCH == OPT_ON
+/* MagiC specific: all regular 68k memory is one block of host memory, so
+ * instructions can be read from there directly, without the memory access
+ * functions. The window excludes the first bytes, because access to them
+ * may cause a bus error, and ends before the last longword, so that a
+ * 32-bit read does not cross the end. Everything outside, e.g. video memory,
+ * takes the regular path.
+ */
+#define M68K_FETCH_START	8
+extern unsigned char *sBaseAddr;
+extern uint sFetchEnd;		/* end of the direct fetch window, 0: disabled */
+
+#define m68ki_fetch_direct(A)	(((A) >= M68K_FETCH_START) && ((A) < sFetchEnd))
+#endif
+
 /* Handles all immediate reads, does address error check, function code setting,
  * and prefetching if they are enabled in m68kconf.h
  */
@@ -1048,6 +1070,14 @@ INLINE uint m68ki_read_imm_16(void)
 	}
 	REG_PC += 2;
 	return MASK_OUT_ABOVE_16(CPU_PREF_DATA >> ((2-((REG_PC-2)&2))<<3));
+#elif COUNT_CYCLES == OPT_OFF && M68K_DIRECT_FETCH == OPT_ON
+	uint address = ADDRESS_68K(REG_PC);
+	REG_PC += 2;
+	if(m68ki_fetch_direct(address))
+	{
+		return getAtariBE16(sBaseAddr + address);
+	}
+	return m68k_read_immediate_16(address);
 #else
 	REG_PC += 2;
 	return m68k_read_immediate_16(ADDRESS_68K(REG_PC-2));
@@ -1079,8 +1109,18 @@ INLINE uint m68ki_read_imm_32(void)
 #else
 	m68ki_set_fc(FLAG_S | FUNCTION_CODE_USER_PROGRAM); /* auto-disable (see m68kcpu.h) */
 	m68ki_check_address_error(REG_PC, MODE_READ, FLAG_S | FUNCTION_CODE_USER_PROGRAM); /* auto-disable (see m68kcpu.h) */
+#if COUNT_CYCLES == OPT_OFF && M68K_DIRECT_FETCH == OPT_ON
+	uint address = ADDRESS_68K(REG_PC);
+	REG_PC += 4;
+	if(m68ki_fetch_direct(address))
+	{
+		return getAtariBE32(sBaseAddr + address);
+	}
+	return m68k_read_immediate_32(address);
+#else
 	REG_PC += 4;
 	return m68k_read_immediate_32(ADDRESS_68K(REG_PC-4));
+#endif
 #endif /* M68K_EMULATE_PREFETCH */
 }
 
@@ -1148,6 +1188,46 @@ INLINE void m68ki_write_32_pd_fc(uint address, uint fc, uint value)
 }
 #endif
 
+#if M68K_COPY_IDIOMS == OPT_ON
+/* MOVEM.L from or to regular memory, done directly in host memory.
+ * <ea> is the lowest address, <predec> selects the reversed register list
+ * of the predecrement mode. Return 0 if the range must take the memory
+ * access functions, e.g. video memory or I/O.
+ */
+INLINE int m68ki_movem_32_re_fast(uint ea, uint register_list, int predec)
+{
+	uint8 *p = m68k_host_memory(ADDRESS_68K(ea), 4 * __builtin_popcount(register_list), 1);
+	if(p == NULL)
+		return 0;
+	for(uint i = 0; i < 16; i++)
+		if(register_list & (1 << (predec ? 15 - i : i)))
+		{
+			setAtariBE32(p, REG_DA[i]);
+			p += 4;
+		}
+	return 1;
+}
+INLINE int m68ki_movem_32_er_fast(uint ea, uint register_list)
+{
+	const uint8 *p = m68k_host_memory(ADDRESS_68K(ea), 4 * __builtin_popcount(register_list), 0);
+	if(p == NULL)
+		return 0;
+	for(uint i = 0; i < 16; i++)
+		if(register_list & (1 << i))
+		{
+			REG_DA[i] = getAtariBE32(p);
+			p += 4;
+		}
+	return 1;
+}
+#endif
+
+/* Number of leading zero bits in a bit field of <width> bits, for BFFFO */
+INLINE uint m68ki_bf_leading_zeros(uint data, uint width)
+{
+	return (data == 0) ? width : (uint) __builtin_clz(data) - (32 - width);
+}
+
 
 /* --------------------- Effective Address Calculation -------------------- */
 
@@ -2023,7 +2103,11 @@ void m68ki_exception_interrupt(uint int_level)
 		return;
 
 	/* Acknowledge the interrupt */
+#if COUNT_CYCLES == OPT_OFF
+	vector = m68ki_irq_ack(int_level);
+#else
 	vector = m68ki_int_ack(int_level);
+#endif
 
 	/* Get the interrupt vector */
 	if(vector == M68K_INT_ACK_AUTOVECTOR)
@@ -2083,6 +2167,17 @@ INLINE void m68ki_check_interrupts(void)
 
 
 
+#if COUNT_CYCLES == OPT_OFF && M68K_BLOCK_CACHE == OPT_ON
+/* MagiC specific: instruction in the decoded block cache, see m68kcpu.c */
+typedef struct
+{
+	void (*handler)(void);				/* from m68ki_instruction_jump_table[] */
+	uint pc;							/* 68k address of the opcode */
+	uint16 ir;							/* opcode */
+} m68ki_bc_insn;
+#endif
+
+
 /* ======================================================================== */
 /* ============================== END OF FILE ============================= */
 /* ======================================================================== */
@@ -0,0 +1,1163 @@
+/*
+ * Copyright (C) 1990-2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* MC68882 floating point coprocessor, coprocessor id 1
+*
+* The floating point registers are kept as host long double. In fast mode all
+* calculations are done in host double precision, in exact mode in host long
+* double, which is the same 64-bit mantissa format as the 68882 extended
+* precision on x86 hosts. Exact mode requires this format, other hosts use
+* fast mode instead, see CMagiC::init(). Conversion from and to memory is
+* exact if long double has at least 64 mantissa bits. The FPCR rounding precision is applied to the
+* results, but the FPCR rounding mode is only applied by FINT and by the
+* conversion to integer. All other results are rounded to nearest.
+* Exception status bits are maintained, but exceptions are never taken, as
+* if all FPCR exception enable bits were zero. FSAVE stores a NULL frame until
+* the first floating point instruction is executed, then an IDLE frame. This
+* is all that MagiC needs for its context switch, see AESEVT.S.
+*
+*/
+
+#include "config.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "m68kops.h"
+#include "m68kfpu.h"
+
+#if M68K_EMULATE_FPU == OPT_ON
+
+typedef long double fpx;
+
+/* FPCR */
+#define FPCR_PREC(fpcr)		(((fpcr) >> 6) & 3)		/* 0: extended, 1: single, 2: double */
+#define FPCR_RND(fpcr)		(((fpcr) >> 4) & 3)		/* 0: nearest, 1: zero, 2: minus, 3: plus */
+
+/* FPSR condition code byte */
+#define FPCC_N				0x08000000
+#define FPCC_Z				0x04000000
+#define FPCC_I				0x02000000
+#define FPCC_NAN			0x01000000
+/* FPSR exception status byte */
+#define FPEXC_BSUN			0x00008000
+#define FPEXC_SNAN			0x00004000
+#define FPEXC_OPERR			0x00002000
+#define FPEXC_OVFL			0x00001000
+#define FPEXC_UNFL			0x00000800
+#define FPEXC_DZ			0x00000400
+#define FPEXC_INEX2			0x00000200
+#define FPEXC_INEX1			0x00000100
+/* FPSR accrued exception byte */
+#define FPAEXC_IOP			0x00000080
+#define FPAEXC_OVFL			0x00000040
+#define FPAEXC_UNFL			0x00000020
+#define FPAEXC_DZ			0x00000010
+#define FPAEXC_INEX			0x00000008
+
+/* FSAVE frames of the 68882 */
+#define FPU_NULL_FRAME		0x00000000
+#define FPU_IDLE_FRAME		0x1f380000
+#define FPU_IDLE_SIZE		0x38
+
+/* valid opmodes 0x00..0x3f of general instructions, 68881/68882 only */
+#define FPU_VALID_OPMODES	0x05ff01fff777f75fULL
+
+/* calculate with host double precision in fast mode */
+#define FPU_OP2(a, op, b)	(fpu_exact ? (a) op (b) : (fpx) ((double) (a) op (double) (b)))
+#define FPU_MATH1(f, x)		(fpu_exact ? f##l(x) : (fpx) f((double) (x)))
+
+static struct
+{
+	fpx fp[8];
+	uint fpcr;
+	uint fpsr;
+	uint fpiar;
+	int null_state;					/* reset state, FSAVE stores a NULL frame */
+} fpu;
+
+static int fpu_exact;
+
+
+/* ======================================================================== */
+/* ============================ DATA CONVERSION =========================== */
+/* ======================================================================== */
+
+static fpx fpu_from_single(uint v)
+{
+	float f;
+	uint32_t u = v;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+static uint fpu_to_single(fpx x)
+{
+	float f = (float) x;
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+static fpx fpu_from_double(uint hi, uint lo)
+{
+	double d;
+	uint64_t u = ((uint64_t) hi << 32) | lo;
+	memcpy(&d, &u, sizeof(d));
+	return d;
+}
+
+static void fpu_to_double(fpx x, uint *w)
+{
+	double d = (double) x;
+	uint64_t u;
+	memcpy(&u, &d, sizeof(u));
+	w[0] = (uint) (u >> 32);
+	w[1] = (uint) u;
+}
+
+/* extended precision: sign and exponent in the upper word of w[0], mantissa with explicit integer bit */
+static fpx fpu_from_ext(const uint *w)
+{
+	int exp = (w[0] >> 16) & 0x7fff;
+	uint64_t m = ((uint64_t) w[1] << 32) | w[2];
+	fpx x;
+
+	if (exp == 0x7fff)
+	{
+		x = ((m << 1) == 0) ? INFINITY : NAN;
+	}
+	else
+	{
+		/* exponent 0: denormalised number */
+		x = ldexpl((fpx) m, ((exp != 0) ? exp : 1) - 16383 - 63);
+	}
+	return (w[0] & 0x80000000) ? -x : x;
+}
+
+static void fpu_to_ext(fpx x, uint *w)
+{
+	w[0] = signbit(x) ? 0x80000000 : 0;
+	w[1] = w[2] = 0;
+	if (isnan(x))
+	{
+		w[0] |= 0x7fff0000;
+		w[1] = w[2] = 0xffffffff;
+	}
+	else
+	if (isinf(x))
+	{
+		w[0] |= 0x7fff0000;
+	}
+	else
+	if (x != 0)
+	{
+		int e;
+		fpx f = frexpl(fabsl(x), &e);		/* 0.5 <= f < 1 */
+		int exp = e - 1 + 16383;
+		uint64_t m;
+		if (exp > 0)
+		{
+			m = (uint64_t) ldexpl(f, 64);
+			w[0] |= (uint) exp << 16;
+		}
+		else
+		{
+			m = (uint64_t) ldexpl(f, e + 16382 + 63);
+		}
+		w[1] = (uint) (m >> 32);
+		w[2] = (uint) m;
+	}
+}
+
+static int fpu_bcd_digit(uint v, int shift)
+{
+	int d = (v >> shift) & 0xf;
+	return (d > 9) ? 9 : d;
+}
+
+/* packed decimal: sign of mantissa and exponent, exponent digits e3 e2 e1 e0, 17 mantissa digits */
+static fpx fpu_from_packed(const uint *w)
+{
+	char buf[32];
+	char *p = buf;
+
+	if ((w[0] & 0x7fff0000) == 0x7fff0000)
+	{
+		fpx x = ((w[1] | w[2]) == 0) ? INFINITY : NAN;
+		return (w[0] & 0x80000000) ? -x : x;
+	}
+	if (w[0] & 0x80000000)
+	{
+		*p++ = '-';
+	}
+	*p++ = (char) ('0' + fpu_bcd_digit(w[0], 0));
+	*p++ = '.';
+	for (int i = 0; i < 16; i++)
+	{
+		*p++ = (char) ('0' + fpu_bcd_digit(w[1 + i / 8], 28 - 4 * (i % 8)));
+	}
+	*p++ = 'e';
+	if (w[0] & 0x40000000)
+	{
+		*p++ = '-';
+	}
+	*p++ = (char) ('0' + fpu_bcd_digit(w[0], 12));
+	*p++ = (char) ('0' + fpu_bcd_digit(w[0], 24));
+	*p++ = (char) ('0' + fpu_bcd_digit(w[0], 20));
+	*p++ = (char) ('0' + fpu_bcd_digit(w[0], 16));
+	*p = '\0';
+	return strtold(buf, NULL);
+}
+
+/* <k> > 0: number of significant digits, otherwise number of digits right of the decimal point */
+static void fpu_to_packed(fpx x, int k, uint *w)
+{
+	char buf[48];
+	int digits;
+
+	w[0] = signbit(x) ? 0x80000000 : 0;
+	w[1] = w[2] = 0;
+	if (isnan(x) || isinf(x))
+	{
+		w[0] |= 0x7fff0000;
+		if (isnan(x))
+		{
+			w[1] = w[2] = 0xffffffff;
+		}
+		return;
+	}
+	x = fabsl(x);
+	if (x == 0)
+	{
+		return;
+	}
+
+	if (k > 0)
+	{
+		digits = k;
+	}
+	else
+	{
+		snprintf(buf, sizeof(buf), "%.16Le", x);
+		digits = atoi(strchr(buf, 'e') + 1) + 1 - k;
+	}
+	if (digits < 1)
+	{
+		digits = 1;
+	}
+	if (digits > 17)
+	{
+		digits = 17;
+		fpu.fpsr |= FPEXC_OPERR | FPAEXC_IOP;
+	}
+
+	snprintf(buf, sizeof(buf), "%.*Le", digits - 1, x);	/* d.ddde+xx */
+	const char *p = buf;
+	w[0] |= (uint) (*p++ - '0');
+	if (*p == '.')
+	{
+		p++;
+	}
+	for (int i = 0; (i < 16) && (*p >= '0') && (*p <= '9'); i++, p++)
+	{
+		w[1 + i / 8] |= (uint) (*p - '0') << (28 - 4 * (i % 8));
+	}
+	int e = atoi(p + 1);
+	if (e < 0)
+	{
+		w[0] |= 0x40000000;
+		e = -e;
+	}
+	w[0] |= ((uint) (e / 1000 % 10) << 12) | ((uint) (e / 100 % 10) << 24) |
+			((uint) (e / 10 % 10) << 20) | ((uint) (e % 10) << 16);
+}
+
+
+/* ======================================================================== */
+/* ============================== ARITHMETIC ============================== */
+/* ======================================================================== */
+
+/* Round to integer according to the FPCR rounding mode */
+static fpx fpu_round_int(fpx x)
+{
+	switch (FPCR_RND(fpu.fpcr))
+	{
+		case 1: return truncl(x);
+		case 2: return floorl(x);
+		case 3: return ceill(x);
+	}
+	return nearbyintl(x);	/* host default: to nearest even */
+}
+
+/* Round a result to the FPCR rounding precision */
+static fpx fpu_round(fpx x)
+{
+	switch (FPCR_PREC(fpu.fpcr))
+	{
+		case 1: return (float) x;
+		case 2: return (double) x;
+	}
+	return x;
+}
+
+/* Round the mantissa to single precision, keeping the exponent range, for FSGLMUL and FSGLDIV */
+static fpx fpu_round_sgl(fpx x)
+{
+	int e;
+	if (!isfinite(x) || (x == 0))
+	{
+		return x;
+	}
+	fpx m = frexpl(x, &e);
+	return ldexpl(nearbyintl(ldexpl(m, 24)), e - 24);
+}
+
+/* Convert to integer for FMOVE to memory or data register, saturated */
+static sint32 fpu_to_int(fpx x, sint32 min, sint32 max)
+{
+	if (isnan(x))
+	{
+		fpu.fpsr |= FPEXC_OPERR | FPAEXC_IOP;
+		return signbit(x) ? min : max;
+	}
+	fpx r = fpu_round_int(x);
+	if (r != x)
+	{
+		fpu.fpsr |= FPEXC_INEX2 | FPAEXC_INEX;
+	}
+	if ((r < min) || (r > max))
+	{
+		fpu.fpsr |= FPEXC_OPERR | FPAEXC_IOP;
+		return (r < 0) ? min : max;
+	}
+	return (sint32) r;
+}
+
+static void fpu_set_cc(fpx x)
+{
+	uint cc = 0;
+
+	if (isnan(x))
+	{
+		cc = FPCC_NAN;
+	}
+	else
+	if (isinf(x))
+	{
+		cc = FPCC_I;
+	}
+	else
+	if (x == 0)
+	{
+		cc = FPCC_Z;
+	}
+	if (signbit(x))
+	{
+		cc |= FPCC_N;
+	}
+	fpu.fpsr = (fpu.fpsr & 0x00ffffff) | cc;
+}
+
+/* Set exception status bits and the corresponding accrued exception bits */
+static void fpu_set_exc(uint exc)
+{
+	uint aexc = 0;
+
+	if (exc & (FPEXC_BSUN | FPEXC_SNAN | FPEXC_OPERR))
+	{
+		aexc |= FPAEXC_IOP;
+	}
+	if (exc & FPEXC_OVFL)
+	{
+		aexc |= FPAEXC_OVFL;
+	}
+	if ((exc & FPEXC_UNFL) && (exc & FPEXC_INEX2))
+	{
+		aexc |= FPAEXC_UNFL;
+	}
+	if (exc & FPEXC_DZ)
+	{
+		aexc |= FPAEXC_DZ;
+	}
+	if (exc & (FPEXC_INEX1 | FPEXC_INEX2 | FPEXC_OVFL))
+	{
+		aexc |= FPAEXC_INEX;
+	}
+	fpu.fpsr |= exc | aexc;
+}
+
+/* Evaluate a conditional predicate, returns -1 for an invalid one */
+static int fpu_cond(uint pred)
+{
+	uint cc = fpu.fpsr;
+	int n = (cc & FPCC_N) != 0;
+	int z = (cc & FPCC_Z) != 0;
+	int nan = (cc & FPCC_NAN) != 0;
+	int res;
+
+	if (pred > 0x1f)
+	{
+		return -1;
+	}
+	if ((pred & 0x10) && nan)
+	{
+		fpu_set_exc(FPEXC_BSUN);
+	}
+	switch (pred & 0x0f)
+	{
+		case 0x00: res = 0; break;							/* F, SF */
+		case 0x01: res = z; break;							/* EQ, SEQ */
+		case 0x02: res = !(nan || z || n); break;			/* OGT, GT */
+		case 0x03: res = z || !(nan || n); break;			/* OGE, GE */
+		case 0x04: res = n && !(nan || z); break;			/* OLT, LT */
+		case 0x05: res = z || (n && !nan); break;			/* OLE, LE */
+		case 0x06: res = !(nan || z); break;				/* OGL, GL */
+		case 0x07: res = !nan; break;						/* OR, GLE */
+		case 0x08: res = nan; break;						/* UN, NGLE */
+		case 0x09: res = nan || z; break;					/* UEQ, NGL */
+		case 0x0a: res = nan || !(n || z); break;			/* UGT, NLE */
+		case 0x0b: res = nan || z || !n; break;				/* UGE, NLT */
+		case 0x0c: res = nan || (n && !z); break;			/* ULT, NGE */
+		case 0x0d: res = nan || z || n; break;				/* ULE, NGT */
+		case 0x0e: res = !z; break;							/* NE, SNE */
+		default:   res = 1; break;							/* T, ST */
+	}
+	return res;
+}
+
+/* FMOVECR constant ROM */
+static fpx fpu_constant(uint offset)
+{
+	switch (offset)
+	{
+		case 0x00: return 3.14159265358979323846264338327950288L;		/* pi */
+		case 0x0b: return 0.30102999566398119521373889472449302L;		/* log10(2) */
+		case 0x0c: return 2.71828182845904523536028747135266250L;		/* e */
+		case 0x0d: return 1.44269504088896340735992468100189214L;		/* log2(e) */
+		case 0x0e: return 0.43429448190325182765112891891660508L;		/* log10(e) */
+		case 0x30: return 0.69314718055994530941723212145817657L;		/* ln(2) */
+		case 0x31: return 2.30258509299404568401799145468436421L;		/* ln(10) */
+		case 0x32: return 1.0L;
+	}
+	if ((offset > 0x32) && (offset <= 0x3f))
+	{
+		/* 10^1, 10^2, 10^4, ... 10^4096 */
+		return powl(10.0L, (fpx) (1U << (offset - 0x33)));
+	}
+	return 0.0L;		/* 0x0f, and undefined entries */
+}
+
+/* Execute an arithmetic instruction with source operand <src> and destination register <reg> */
+static void fpu_arith(uint op, fpx src, uint reg)
+{
+	fpx dst = fpu.fp[reg];
+	int dyadic = (op >= 0x20) && (op < 0x30);
+	uint exc = 0;
+	fpx r;
+
+	fpu.fpsr &= ~0x0000ff00;
+	if (op == 0x38)
+	{
+		/* FCMP: only the condition codes of dst - src */
+		if (isnan(src) || isnan(dst))
+		{
+			fpu_set_cc(NAN);
+		}
+		else
+		{
+			fpu_set_cc((dst == src) ? (signbit(dst) ? -0.0L : 0.0L) : ((dst < src) ? -1.0L : 1.0L));
+		}
+		return;
+	}
+	if (op == 0x3a)
+	{
+		/* FTST */
+		fpu_set_cc(src);
+		return;
+	}
+
+	switch (op)
+	{
+		case 0x00: r = src; break;									/* FMOVE */
+		case 0x01: r = fpu_round_int(src); break;					/* FINT */
+		case 0x02: r = FPU_MATH1(sinh, src); break;
+		case 0x03: r = truncl(src); break;							/* FINTRZ */
+		case 0x04: r = FPU_MATH1(sqrt, src); break;
+		case 0x06: r = FPU_MATH1(log1p, src); break;				/* FLOGNP1 */
+		case 0x08: r = FPU_MATH1(expm1, src); break;				/* FETOXM1 */
+		case 0x09: r = FPU_MATH1(tanh, src); break;
+		case 0x0a: r = FPU_MATH1(atan, src); break;
+		case 0x0c: r = FPU_MATH1(asin, src); break;
+		case 0x0d: r = FPU_MATH1(atanh, src);						/* FATANH */
+			if (fabsl(src) == 1)
+			{
+				exc |= FPEXC_DZ;
+			}
+			break;
+		case 0x0e: r = FPU_MATH1(sin, src); break;
+		case 0x0f: r = FPU_MATH1(tan, src); break;
+		case 0x10: r = FPU_MATH1(exp, src); break;					/* FETOX */
+		case 0x11: r = FPU_MATH1(exp2, src); break;					/* FTWOTOX */
+		case 0x12: r = fpu_exact ? powl(10.0L, src) : (fpx) pow(10.0, (double) src); break;	/* FTENTOX */
+		case 0x14:													/* FLOGN */
+		case 0x15:													/* FLOG10 */
+		case 0x16:													/* FLOG2 */
+			if (src == 0)
+			{
+				exc |= FPEXC_DZ;
+			}
+			r = (op == 0x14) ? FPU_MATH1(log, src) : (op == 0x15) ? FPU_MATH1(log10, src) : FPU_MATH1(log2, src);
+			break;
+		case 0x18: r = fabsl(src); break;
+		case 0x19: r = FPU_MATH1(cosh, src); break;
+		case 0x1a: r = -src; break;									/* FNEG */
+		case 0x1c: r = FPU_MATH1(acos, src); break;
+		case 0x1d: r = FPU_MATH1(cos, src); break;
+		case 0x1e:													/* FGETEXP */
+			r = (isfinite(src) && (src != 0)) ? (fpx) ilogbl(src) : (isinf(src) ? NAN : src);
+			break;
+		case 0x1f:													/* FGETMAN */
+			r = (isfinite(src) && (src != 0)) ? ldexpl(src, -ilogbl(src)) : (isinf(src) ? NAN : src);
+			break;
+		case 0x20:													/* FDIV */
+			if ((src == 0) && isfinite(dst) && (dst != 0))
+			{
+				exc |= FPEXC_DZ;
+			}
+			r = FPU_OP2(dst, /, src);
+			break;
+		case 0x21:													/* FMOD */
+		case 0x25:													/* FREM */
+		{
+			int q;
+			if (op == 0x21)
+			{
+				r = fmodl(dst, src);
+				fpx fq = truncl(dst / src);
+				q = isfinite(fq) ? (int) fmodl(fabsl(fq), 128.0L) : 0;
+				if (signbit(fq))
+				{
+					q = -q;
+				}
+			}
+			else
+			{
+				r = remquol(dst, src, &q);
+			}
+			fpu.fpsr = (fpu.fpsr & ~0x00ff0000) | ((q < 0) ? 0x00800000 : 0) | ((uint) (abs(q) & 0x7f) << 16);
+			break;
+		}
+		case 0x22: r = FPU_OP2(dst, +, src); break;					/* FADD */
+		case 0x23: r = FPU_OP2(dst, *, src); break;					/* FMUL */
+		case 0x24:													/* FSGLDIV */
+			if ((src == 0) && isfinite(dst) && (dst != 0))
+			{
+				exc |= FPEXC_DZ;
+			}
+			r = fpu_round_sgl(dst / src);
+			break;
+		case 0x26:													/* FSCALE */
+			if (isnan(src) || isinf(src))
+			{
+				r = isnan(src) ? src : NAN;
+			}
+			else
+			{
+				fpx n = truncl(src);
+				r = ldexpl(dst, (n > 32767) ? 32767 : (n < -32767) ? -32767 : (int) n);
+			}
+			break;
+		case 0x27: r = fpu_round_sgl(dst * src); break;				/* FSGLMUL */
+		case 0x28: r = FPU_OP2(dst, -, src); break;					/* FSUB */
+		default:													/* 0x30..0x37: FSINCOS */
+			fpu.fp[op & 7] = fpu_round(FPU_MATH1(cos, src));
+			r = FPU_MATH1(sin, src);
+			break;
+	}
+
+	r = fpu_round(r);
+	if (isnan(r) && !isnan(src) && !(dyadic && isnan(dst)))
+	{
+		exc |= FPEXC_OPERR;
+	}
+	if (isinf(r) && isfinite(src) && !(dyadic && !isfinite(dst)) && !(exc & FPEXC_DZ))
+	{
+		exc |= FPEXC_OVFL;
+	}
+	fpu.fp[reg] = r;
+	fpu_set_cc(r);
+	fpu_set_exc(exc);
+}
+
+
+/* ======================================================================== */
+/* ========================== EFFECTIVE ADDRESS =========================== */
+/* ======================================================================== */
+
+/* operand sizes of the data formats L, S, X, P, W, D, B, P with dynamic k-factor */
+static const uint fpu_format_size[8] = { 4, 4, 12, 12, 2, 8, 1, 12 };
+
+/* Check the effective address in the opcode for an operand of <size> bytes, 0: control addressing */
+static int fpu_ea_ok(uint size, int write)
+{
+	uint reg = REG_IR & 7;
+
+	switch ((REG_IR >> 3) & 7)
+	{
+		case 0: return (size == 1) || (size == 2) || (size == 4);
+		case 1: return 0;
+		case 7: return (reg <= 1) || (!write && ((reg <= 3) || ((reg == 4) && (size != 0))));
+	}
+	return 1;
+}
+
+/* Calculate the effective address for an operand of <size> bytes, memory modes only */
+static uint fpu_ea(uint size)
+{
+	uint reg = REG_IR & 7;
+	uint ea;
+
+	switch ((REG_IR >> 3) & 7)
+	{
+		case 2:
+			return REG_A[reg];
+		case 3:
+			ea = REG_A[reg];
+			REG_A[reg] += ((size == 1) && (reg == 7)) ? 2 : size;
+			return ea;
+		case 4:
+			REG_A[reg] -= ((size == 1) && (reg == 7)) ? 2 : size;
+			return REG_A[reg];
+		case 5:
+			return REG_A[reg] + MAKE_INT_16(m68ki_read_imm_16());
+		case 6:
+			return m68ki_get_ea_ix(REG_A[reg]);
+		default:
+			switch (reg)
+			{
+				case 0: return MAKE_INT_16(m68ki_read_imm_16());
+				case 1: return m68ki_read_imm_32();
+				case 2: return m68ki_get_ea_pcdi();
+				default: return m68ki_get_ea_pcix();
+			}
+	}
+}
+
+static fpx fpu_read_ext(uint ea)
+{
+	uint w[3];
+	w[0] = m68ki_read_32(ea);
+	w[1] = m68ki_read_32(ea + 4);
+	w[2] = m68ki_read_32(ea + 8);
+	return fpu_from_ext(w);
+}
+
+static void fpu_write_ext(uint ea, fpx x)
+{
+	uint w[3];
+	fpu_to_ext(x, w);
+	m68ki_write_32(ea, w[0]);
+	m68ki_write_32(ea + 4, w[1]);
+	m68ki_write_32(ea + 8, w[2]);
+}
+
+/* Read the source operand in the given data format */
+static fpx fpu_read_ea(uint format)
+{
+	uint size = fpu_format_size[format];
+	uint w[3] = { 0, 0, 0 };
+
+	if ((REG_IR & 0x38) == 0)
+	{
+		w[0] = REG_D[REG_IR & 7];
+	}
+	else
+	if ((REG_IR & 0x3f) == 0x3c)
+	{
+		/* immediate, bytes are in the low byte of a word */
+		if (size <= 2)
+		{
+			w[0] = m68ki_read_imm_16();
+		}
+		else
+		{
+			for (uint i = 0; i < size / 4; i++)
+			{
+				w[i] = m68ki_read_imm_32();
+			}
+		}
+	}
+	else
+	{
+		uint ea = fpu_ea(size);
+		switch (size)
+		{
+			case 1: w[0] = m68ki_read_8(ea); break;
+			case 2: w[0] = m68ki_read_16(ea); break;
+			default:
+				for (uint i = 0; i < size / 4; i++)
+				{
+					w[i] = m68ki_read_32(ea + 4 * i);
+				}
+				break;
+		}
+	}
+
+	switch (format)
+	{
+		case 0: return (sint32) w[0];
+		case 1: return fpu_from_single(w[0]);
+		case 2: return fpu_from_ext(w);
+		case 4: return (sint16) w[0];
+		case 5: return fpu_from_double(w[0], w[1]);
+		case 6: return (sint8) w[0];
+		default: return fpu_from_packed(w);
+	}
+}
+
+
+/* ======================================================================== */
+/* ============================= INSTRUCTIONS ============================= */
+/* ======================================================================== */
+
+/* FMOVE FPn,<ea> */
+static void fpu_fmove_out(uint w2)
+{
+	uint format = (w2 >> 10) & 7;
+	uint size = fpu_format_size[format];
+	fpx x = fpu.fp[(w2 >> 7) & 7];
+	uint w[3] = { 0, 0, 0 };
+
+	if (!fpu_ea_ok(size, 1))
+	{
+		m68ki_exception_1111();
+		return;
+	}
+	fpu.fpsr &= ~0x0000ff00;
+	switch (format)
+	{
+		case 0: w[0] = (uint) fpu_to_int(x, INT32_MIN, INT32_MAX); break;
+		case 1: w[0] = fpu_to_single(x); break;
+		case 2: fpu_to_ext(x, w); break;
+		case 3: fpu_to_packed(x, ((int) (w2 << 25)) >> 25, w); break;
+		case 4: w[0] = (uint) fpu_to_int(x, INT16_MIN, INT16_MAX); break;
+		case 5: fpu_to_double(x, w); break;
+		case 6: w[0] = (uint) fpu_to_int(x, INT8_MIN, INT8_MAX); break;
+		default: fpu_to_packed(x, (sint8) REG_D[(w2 >> 4) & 7], w); break;
+	}
+
+	if ((REG_IR & 0x38) == 0)
+	{
+		uint *d = &DY;
+		switch (size)
+		{
+			case 1: *d = MASK_OUT_BELOW_8(*d) | (w[0] & 0xff); break;
+			case 2: *d = MASK_OUT_BELOW_16(*d) | (w[0] & 0xffff); break;
+			default: *d = w[0]; break;
+		}
+		return;
+	}
+
+	uint ea = fpu_ea(size);
+	switch (size)
+	{
+		case 1: m68ki_write_8(ea, w[0] & 0xff); break;
+		case 2: m68ki_write_16(ea, w[0] & 0xffff); break;
+		default:
+			for (uint i = 0; i < size / 4; i++)
+			{
+				m68ki_write_32(ea + 4 * i, w[i]);
+			}
+			break;
+	}
+}
+
+/* FMOVE/FMOVEM <ea>,FPCR/FPSR/FPIAR and back */
+static void fpu_fmovem_control(uint w2)
+{
+	uint list = (w2 >> 10) & 7;
+	int to_mem = (w2 & 0x2000) != 0;
+	uint n = ((list >> 2) & 1) + ((list >> 1) & 1) + (list & 1);
+	uint *regs[3] = { &fpu.fpcr, &fpu.fpsr, &fpu.fpiar };
+	uint mode = (REG_IR >> 3) & 7;
+	uint ea = 0;
+
+	if ((list == 0) ||
+		((mode == 0) && (n != 1)) ||
+		((mode == 1) && (list != 1)) ||
+		((mode > 1) && !fpu_ea_ok(4 * n, to_mem)))
+	{
+		m68ki_exception_1111();
+		return;
+	}
+	if ((mode > 1) && ((REG_IR & 0x3f) != 0x3c))
+	{
+		ea = fpu_ea(4 * n);
+	}
+
+	for (uint i = 0; i < 3; i++)
+	{
+		uint v;
+		if (!(list & (4 >> i)))
+		{
+			continue;
+		}
+		if (to_mem)
+		{
+			v = *regs[i];
+			if (mode == 0)
+			{
+				DY = v;
+			}
+			else
+			if (mode == 1)
+			{
+				AY = v;
+			}
+			else
+			{
+				m68ki_write_32(ea, v);
+				ea += 4;
+			}
+		}
+		else
+		{
+			if (mode == 0)
+			{
+				v = DY;
+			}
+			else
+			if (mode == 1)
+			{
+				v = AY;
+			}
+			else
+			if ((REG_IR & 0x3f) == 0x3c)
+			{
+				v = m68ki_read_imm_32();
+			}
+			else
+			{
+				v = m68ki_read_32(ea);
+				ea += 4;
+			}
+			*regs[i] = v & ((i == 0) ? 0x0000fff0 : (i == 1) ? 0x0ffffff8 : 0xffffffff);
+		}
+	}
+}
+
+/* FMOVEM <list>,<ea> and back */
+static void fpu_fmovem(uint w2)
+{
+	int to_mem = (w2 & 0x2000) != 0;
+	int predec_list = !(w2 & 0x1000);	/* bit 0 is FP0, otherwise bit 7 */
+	uint list = (w2 & 0x0800) ? (REG_D[(w2 >> 4) & 7] & 0xff) : (w2 & 0xff);
+	uint mode = (REG_IR >> 3) & 7;
+	uint ea;
+
+	if ((mode < 2) || !fpu_ea_ok(0, to_mem) || ((mode == 3) && to_mem) || ((mode == 4) && !to_mem))
+	{
+		m68ki_exception_1111();
+		return;
+	}
+
+	if (mode == 4)
+	{
+		/* FP7 first, at the highest address */
+		ea = AY;
+		for (int i = 7; i >= 0; i--)
+		{
+			if (list & (predec_list ? (1U << i) : (0x80U >> i)))
+			{
+				ea -= 12;
+				fpu_write_ext(ea, fpu.fp[i]);
+			}
+		}
+		AY = ea;
+		return;
+	}
+
+	ea = (mode == 3) ? AY : fpu_ea(0);
+	for (int i = 0; i < 8; i++)
+	{
+		if (list & (predec_list ? (1U << i) : (0x80U >> i)))
+		{
+			if (to_mem)
+			{
+				fpu_write_ext(ea, fpu.fp[i]);
+			}
+			else
+			{
+				fpu.fp[i] = fpu_read_ext(ea);
+			}
+			ea += 12;
+		}
+	}
+	if (mode == 3)
+	{
+		AY = ea;
+	}
+}
+
+/* General instructions, opcode F200 + ea */
+static void m68ki_fpu_op_general(void)
+{
+	uint pc = REG_PC - 2;
+	uint w2 = m68ki_read_imm_16();
+
+	fpu.null_state = 0;
+	switch (w2 >> 13)
+	{
+		case 0:		/* FPm,FPn */
+		case 2:		/* <ea>,FPn */
+		{
+			uint opmode = w2 & 0x7f;
+			uint src_spec = (w2 >> 10) & 7;
+			fpx src;
+
+			if ((w2 & 0x4000) && (src_spec == 7))
+			{
+				/* FMOVECR #offset,FPn */
+				fpu.fpiar = pc;
+				fpu.fpsr &= ~0x0000ff00;
+				src = fpu_round(fpu_constant(opmode));
+				fpu.fp[(w2 >> 7) & 7] = src;
+				fpu_set_cc(src);
+				return;
+			}
+			if ((opmode > 0x3f) || !((FPU_VALID_OPMODES >> opmode) & 1) ||
+				((w2 & 0x4000) && !fpu_ea_ok(fpu_format_size[src_spec], 0)))
+			{
+				m68ki_exception_1111();
+				return;
+			}
+			fpu.fpiar = pc;
+			src = (w2 & 0x4000) ? fpu_read_ea(src_spec) : fpu.fp[src_spec];
+			fpu_arith(opmode, src, (w2 >> 7) & 7);
+			return;
+		}
+		case 3:
+			fpu.fpiar = pc;
+			fpu_fmove_out(w2);
+			return;
+		case 4:
+		case 5:
+			fpu_fmovem_control(w2);
+			return;
+		case 6:
+		case 7:
+			fpu_fmovem(w2);
+			return;
+	}
+	m68ki_exception_1111();
+}
+
+/* FScc, FDBcc and FTRAPcc, opcode F240 + ea */
+static void m68ki_fpu_op_scc(void)
+{
+	uint mode = (REG_IR >> 3) & 7;
+	uint reg = REG_IR & 7;
+	uint w2 = m68ki_read_imm_16();
+
+	fpu.null_state = 0;
+	if ((mode == 1) || ((mode == 7) && (reg >= 2)))
+	{
+		int cond = fpu_cond(w2 & 0x3f);
+		if ((cond < 0) || ((mode == 7) && (reg > 4)))
+		{
+			m68ki_exception_1111();
+			return;
+		}
+		if (mode == 1)
+		{
+			/* FDBcc, displacement relative to its own address */
+			uint pc = REG_PC;
+			uint offset = MAKE_INT_16(m68ki_read_imm_16());
+			if (!cond)
+			{
+				uint *d = &DY;
+				uint res = MASK_OUT_ABOVE_16(*d - 1);
+				*d = MASK_OUT_BELOW_16(*d) | res;
+				if (res != 0xffff)
+				{
+					m68ki_jump(pc + offset);
+				}
+			}
+			return;
+		}
+		/* FTRAPcc with optional word or long operand */
+		if (reg == 2)
+		{
+			REG_PC += 2;
+		}
+		else
+		if (reg == 3)
+		{
+			REG_PC += 4;
+		}
+		if (cond)
+		{
+			m68ki_exception_trap(EXCEPTION_TRAPV);
+		}
+		return;
+	}
+
+	int cond = fpu_cond(w2 & 0x3f);
+	if (!fpu_ea_ok(1, 1) || (cond < 0))
+	{
+		m68ki_exception_1111();
+		return;
+	}
+	uint v = cond ? 0xff : 0;
+	if (mode == 0)
+	{
+		DY = MASK_OUT_BELOW_8(DY) | v;
+	}
+	else
+	{
+		m68ki_write_8(fpu_ea(1), v);
+	}
+}
+
+/* FBcc with word or long displacement, opcodes F280 and F2C0 + condition, FNOP is FBF.W 0 */
+static void m68ki_fpu_op_bcc(void)
+{
+	uint pc = REG_PC;
+	uint offset = (REG_IR & 0x40) ? m68ki_read_imm_32() : (uint) MAKE_INT_16(m68ki_read_imm_16());
+	int cond = fpu_cond(REG_IR & 0x3f);
+
+	fpu.null_state = 0;
+	if (cond < 0)
+	{
+		m68ki_exception_1111();
+	}
+	else
+	if (cond)
+	{
+		m68ki_jump(pc + offset);
+	}
+}
+
+/* FSAVE <ea>, opcode F300 + ea */
+static void m68ki_fpu_op_save(void)
+{
+	uint mode = (REG_IR >> 3) & 7;
+	uint size = fpu.null_state ? 4 : 4 + FPU_IDLE_SIZE;
+
+	if (!FLAG_S)
+	{
+		m68ki_exception_privilege_violation();
+		return;
+	}
+	if ((mode == 3) || ((mode != 4) && !fpu_ea_ok(0, 1)))
+	{
+		m68ki_exception_1111();
+		return;
+	}
+	uint ea = (mode == 4) ? (AY -= size) : fpu_ea(0);
+	m68ki_write_32(ea, fpu.null_state ? FPU_NULL_FRAME : FPU_IDLE_FRAME);
+	for (uint i = 4; i < size; i += 4)
+	{
+		m68ki_write_32(ea + i, 0);
+	}
+}
+
+/* FRESTORE <ea>, opcode F340 + ea */
+static void m68ki_fpu_op_restore(void)
+{
+	uint mode = (REG_IR >> 3) & 7;
+
+	if (!FLAG_S)
+	{
+		m68ki_exception_privilege_violation();
+		return;
+	}
+	if ((mode == 4) || ((mode != 3) && !fpu_ea_ok(0, 0)))
+	{
+		m68ki_exception_1111();
+		return;
+	}
+	uint ea = (mode == 3) ? AY : fpu_ea(0);
+	uint frame = m68ki_read_32(ea);
+	if (mode == 3)
+	{
+		AY += 4 + ((frame >> 16) & 0xff);
+	}
+	if ((frame >> 24) == 0)
+	{
+		m68ki_fpu_reset();
+	}
+	else
+	{
+		fpu.null_state = 0;
+	}
+}
+
+
+/* ======================================================================== */
+/* ================================= API ================================== */
+/* ======================================================================== */
+
+void m68ki_fpu_reset(void)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		fpu.fp[i] = NAN;
+	}
+	fpu.fpcr = fpu.fpsr = fpu.fpiar = 0;
+	fpu.null_state = 1;
+}
+
+void m68ki_fpu_init(int mode)
+{
+	static void (*saved[0x180])(void);
+	static int saved_valid;
+
+	if (!saved_valid)
+	{
+		/* without FPU: line F exception, or a NOP for the remaining cpDBcc and cpTRAPcc entries */
+		memcpy(saved, &m68ki_instruction_jump_table[0xf200], sizeof(saved));
+		saved_valid = 1;
+	}
+	fpu_exact = (mode == M68K_FPU_EXACT);
+
+	for (uint i = 0; i < 0x180; i++)
+	{
+		void (*handler)(void) = saved[i];
+		if (mode != M68K_FPU_NONE)
+		{
+			switch (i >> 6)
+			{
+				case 0: handler = m68ki_fpu_op_general; break;
+				case 1: handler = m68ki_fpu_op_scc; break;
+				case 2:
+				case 3: handler = m68ki_fpu_op_bcc; break;
+				case 4: handler = m68ki_fpu_op_save; break;
+				default: handler = m68ki_fpu_op_restore; break;
+			}
+		}
+		m68ki_instruction_jump_table[0xf200 + i] = handler;
+	}
+	m68ki_fpu_reset();
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 1990-2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* MC68882 floating point coprocessor
+*
+*/
+
+#ifndef M68KFPU__HEADER
+#define M68KFPU__HEADER
+
+#include "m68kcpu.h"
+
+#if M68K_EMULATE_FPU == OPT_ON
+
+// install or remove the coprocessor instructions in the opcode table
+void m68ki_fpu_init(int mode);
+// hardware reset: registers NaN, coprocessor in NULL state
+void m68ki_fpu_reset(void);
+
+#endif
+
+#endif /* M68KFPU__HEADER */
@@ -0,0 +1,683 @@
+/*
+ * Copyright (C) 1990-2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Translation of cached 68k blocks to x86-64 code
+*
+* A block from the block cache (see m68kcpu.c) is translated to a single
+* host function. For each 68k instruction, the generated code checks the
+* same conditions as the interpreter loop, i.e. sExitImmediately, trace
+* mode and the program counter, sets PPC, IR and PC and then either executes
+* the instruction natively or calls the Musashi handler.
+* Condition codes of native instructions are only stored if they are needed,
+* see M68K_LAZY_FLAGS.
+* The function returns to the interpreter as soon as a check fails or
+* cached code has been invalidated in the meantime. The return value is the
+* index of the next instruction in the block. A block that branches back to
+* its own start, i.e. a simple loop, is repeated without leaving the function.
+*
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "emulation_globals.h"
+#include "m68kops.h"
+#include "m68kjit.h"
+
+#if M68K_JIT == OPT_ON
+
+#define JIT_CODE_SIZE       (16 * 1024 * 1024)  // executable memory for all blocks
+#define JIT_MAX_INSNS       64                  // maximum block length
+#define JIT_MAX_INSN_CODE   320                 // maximum x86-64 code per 68k instruction
+#define JIT_MAX_OVERHEAD    64                  // prologue, epilogue and alignment
+
+#define CPU_OFFS(field)     ((uint32_t) offsetof(m68ki_cpu_core, field))
+
+static uint8_t *jit_code;                       // code memory, or NULL
+static size_t jit_used;                         // bytes already used in jit_code
+static size_t jit_page_size;                    // granularity of mprotect()
+static const unsigned *jit_p_generation;        // changes when cached code is invalidated
+static int *jit_p_budget;                       // instruction budget for events, or NULL
+static uint8_t *p;                              // emit pointer
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emit helpers
+ *
+ ************************************************************************************************/
+static inline void emit8(uint8_t b)
+{
+    *p++ = b;
+}
+
+static inline void emit32(uint32_t v)
+{
+    memcpy(p, &v, 4);
+    p += 4;
+}
+
+static inline void emit64(uint64_t v)
+{
+    memcpy(p, &v, 8);
+    p += 8;
+}
+
+// mov dword [rbx + offs], imm32
+static void emit_store_imm(uint32_t offs, uint32_t imm)
+{
+    emit8(0xc7); emit8(0x83); emit32(offs); emit32(imm);
+}
+
+// mov eax, dword [rbx + offs]
+static void emit_load_eax(uint32_t offs)
+{
+    emit8(0x8b); emit8(0x83); emit32(offs);
+}
+
+// mov dword [rbx + offs], eax
+static void emit_store_eax(uint32_t offs)
+{
+    emit8(0x89); emit8(0x83); emit32(offs);
+}
+
+// jcc rel32, returns position of the displacement for later fixup
+static uint8_t *emit_jcc(uint8_t cc)
+{
+    emit8(0x0f); emit8(cc); emit32(0);
+    return p - 4;
+}
+
+static void fixup(uint8_t *pos, const uint8_t *target)
+{
+    int32_t rel = (int32_t) (target - (pos + 4));
+    memcpy(pos, &rel, 4);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emit the checks the interpreter loop does before each instruction
+ *
+ * @param[in]  pc           expected 68k program counter
+ * @param[out] fixups       positions of the exit jumps
+ * @param[out] num_fixups   number of exit jumps
+ *
+ ************************************************************************************************/
+static void emit_checks(uint32_t pc, uint8_t **fixups, unsigned *num_fixups)
+{
+    emit8(0x45); emit8(0x39); emit8(0x75); emit8(0x00);                 // cmp [r13],r14d
+    fixups[(*num_fixups)++] = emit_jcc(0x85);                           // jne exit
+    emit8(0x41); emit8(0x80); emit8(0x3c); emit8(0x24); emit8(0x00);    // cmp byte [r12],0
+    fixups[(*num_fixups)++] = emit_jcc(0x85);                           // jne exit
+    emit8(0x83); emit8(0xbb); emit32(CPU_OFFS(t1_flag)); emit8(0);      // cmp dword [rbx+t1_flag],0
+    fixups[(*num_fixups)++] = emit_jcc(0x85);                           // jne exit
+    emit8(0x81); emit8(0xbb); emit32(CPU_OFFS(pc)); emit32(pc);         // cmp dword [rbx+pc],pc
+    fixups[(*num_fixups)++] = emit_jcc(0x85);                           // jne exit
+}
+
+
+/*
+ * Instructions that are translated to native code. They only use data
+ * registers, so they cannot cause exceptions or access memory.
+ */
+
+#define JF_C        0x01                        // condition codes, as bit mask
+#define JF_V        0x02
+#define JF_Z        0x04
+#define JF_N        0x08
+#define JF_X        0x10
+#define JF_NZVC     (JF_N | JF_Z | JF_V | JF_C)
+#define JF_ALL      (JF_X | JF_NZVC)
+
+enum
+{
+    JOP_HANDLER = 0,                            // call Musashi handler
+    // arithmetic, flags from host flags
+    JOP_ADD, JOP_SUB, JOP_CMP, JOP_ADDQ, JOP_SUBQ,
+    // logical and moves, V and C cleared, N and Z from result
+    JOP_MOVEQ, JOP_MOVE, JOP_TST, JOP_AND, JOP_OR, JOP_EOR
+};
+
+typedef struct
+{
+    int op;
+    uint32_t dst;                               // offset of destination or result register
+    uint32_t src;                               // offset of source register
+    uint32_t imm;                               // immediate value for moveq, addq, subq
+    unsigned writes;                            // condition codes set by the instruction
+    int deferrable;                             // condition codes can be recalculated later
+} jit_op;
+
+
+/** **********************************************************************************************
+ *
+ * @brief Check if an instruction can be translated to native code
+ *
+ * @param[in]  e    cached instruction
+ * @param[out] o    decoded instruction
+ *
+ ************************************************************************************************/
+static void decode(const m68ki_bc_insn *e, jit_op *o)
+{
+    uint32_t dx = CPU_OFFS(dar) + 4 * ((e->ir >> 9) & 7);
+    uint32_t dy = CPU_OFFS(dar) + 4 * (e->ir & 7);
+
+    o->op = JOP_HANDLER;
+    o->dst = dx;
+    o->src = dy;
+    o->imm = (((e->ir >> 9) - 1) & 7) + 1;
+    o->writes = JF_NZVC;
+    o->deferrable = 1;
+
+    if (e->handler == m68k_op_add_32_er_d)
+    {
+        o->op = JOP_ADD;
+    }
+    else
+    if (e->handler == m68k_op_sub_32_er_d)
+    {
+        o->op = JOP_SUB;
+    }
+    else
+    if (e->handler == m68k_op_cmp_32_d)
+    {
+        o->op = JOP_CMP;
+    }
+    else
+    if (e->handler == m68k_op_addq_32_d)
+    {
+        o->op = JOP_ADDQ;
+        o->dst = dy;
+    }
+    else
+    if (e->handler == m68k_op_subq_32_d)
+    {
+        o->op = JOP_SUBQ;
+        o->dst = dy;
+    }
+    else
+    if (e->handler == m68k_op_moveq_32)
+    {
+        o->op = JOP_MOVEQ;
+        o->imm = (uint32_t) (int32_t) (int8_t) (e->ir & 0xff);
+    }
+    else
+    if (e->handler == m68k_op_move_32_d_d)
+    {
+        o->op = JOP_MOVE;
+    }
+    else
+    if (e->handler == m68k_op_tst_32_d)
+    {
+        o->op = JOP_TST;
+        o->dst = dy;
+    }
+    else
+    if (e->handler == m68k_op_and_32_er_d)
+    {
+        o->op = JOP_AND;
+    }
+    else
+    if (e->handler == m68k_op_or_32_er_d)
+    {
+        o->op = JOP_OR;
+    }
+    else
+    if (e->handler == m68k_op_eor_32_d)
+    {
+        // eor.l Dx,Dy
+        o->op = JOP_EOR;
+        o->dst = dy;
+        o->src = dx;
+    }
+
+    if ((o->op == JOP_ADD) || (o->op == JOP_SUB) || (o->op == JOP_ADDQ) || (o->op == JOP_SUBQ))
+    {
+        o->writes = JF_ALL;
+        // the operand must be reconstructed from result and source
+        o->deferrable = (o->op == JOP_ADDQ) || (o->op == JOP_SUBQ) || (o->dst != o->src);
+    }
+    else
+    if (o->op == JOP_HANDLER)
+    {
+        o->writes = 0;
+        o->deferrable = 0;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emit "ALU ecx,source" for an arithmetic instruction
+ *
+ * @param[in] o         decoded instruction
+ * @param[in] inverse   emit the inverse operation, to get the operand back from the result
+ *
+ ************************************************************************************************/
+static void emit_alu(const jit_op *o, int inverse)
+{
+    int sub = (o->op == JOP_SUB) || (o->op == JOP_SUBQ) || (o->op == JOP_CMP);
+    if (inverse)
+    {
+        sub = !sub;
+    }
+    if ((o->op == JOP_ADDQ) || (o->op == JOP_SUBQ))
+    {
+        emit8(0x81); emit8(sub ? 0xe9 : 0xc1); emit32(o->imm);    // sub/add ecx,imm
+    }
+    else
+    {
+        emit8(0x8b); emit8(0x83); emit32(o->src);               // mov eax,[rbx+src]
+        emit8(sub ? 0x29 : 0x01); emit8(0xc1);                  // sub/add ecx,eax
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emit code that stores condition codes in Musashi format
+ *
+ * @param[in] o         decoded instruction
+ * @param[in] mask      condition codes to be stored
+ *
+ * @note For arithmetic instructions the host flags must be set by the operation,
+ *       and ecx must contain the result.
+ *
+ ************************************************************************************************/
+static void emit_flags(const jit_op *o, unsigned mask)
+{
+    if (o->op <= JOP_SUBQ)
+    {
+        emit8(0x0f); emit8(0x92); emit8(0xc0);                  // setc al
+        emit8(0x0f); emit8(0x90); emit8(0xc2);                  // seto dl
+        if (mask & (JF_C | JF_X))
+        {
+            emit8(0x0f); emit8(0xb6); emit8(0xc0);              // movzx eax,al
+            emit8(0xc1); emit8(0xe0); emit8(8);                 // shl eax,8
+            if (mask & JF_C)
+            {
+                emit_store_eax(CPU_OFFS(c_flag));
+            }
+            if (mask & JF_X)
+            {
+                emit_store_eax(CPU_OFFS(x_flag));
+            }
+        }
+        if (mask & JF_V)
+        {
+            emit8(0x0f); emit8(0xb6); emit8(0xd2);              // movzx edx,dl
+            emit8(0xc1); emit8(0xe2); emit8(7);                 // shl edx,7
+            emit8(0x89); emit8(0x93); emit32(CPU_OFFS(v_flag)); // mov [rbx+v_flag],edx
+        }
+    }
+    else
+    {
+        if (mask & JF_V)
+        {
+            emit_store_imm(CPU_OFFS(v_flag), 0);
+        }
+        if (mask & JF_C)
+        {
+            emit_store_imm(CPU_OFFS(c_flag), 0);
+        }
+        if (o->op == JOP_MOVEQ)
+        {
+            if (mask & JF_Z)
+            {
+                emit_store_imm(CPU_OFFS(not_z_flag), o->imm);
+            }
+            if (mask & JF_N)
+            {
+                emit_store_imm(CPU_OFFS(n_flag), o->imm >> 24);
+            }
+            return;
+        }
+        if (mask & (JF_N | JF_Z))
+        {
+            emit8(0x8b); emit8(0x8b); emit32(o->dst);           // mov ecx,[rbx+result]
+        }
+    }
+
+    if (mask & JF_Z)
+    {
+        emit8(0x89); emit8(0x8b); emit32(CPU_OFFS(not_z_flag)); // mov [rbx+not_z_flag],ecx
+    }
+    if (mask & JF_N)
+    {
+        emit8(0xc1); emit8(0xe9); emit8(24);                    // shr ecx,24
+        emit8(0x89); emit8(0x8b); emit32(CPU_OFFS(n_flag));     // mov [rbx+n_flag],ecx
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emit native code for an instruction
+ *
+ * @param[in] o         decoded instruction
+ * @param[in] mask      condition codes to be stored, the others are not needed
+ *
+ * @note Must have the same effect as the Musashi handler.
+ *
+ ************************************************************************************************/
+static void emit_native(const jit_op *o, unsigned mask)
+{
+    switch(o->op)
+    {
+        case JOP_ADD:
+        case JOP_SUB:
+        case JOP_CMP:
+        case JOP_ADDQ:
+        case JOP_SUBQ:
+            emit8(0x8b); emit8(0x8b); emit32(o->dst);           // mov ecx,[rbx+dst]
+            emit_alu(o, 0);
+            if (o->op != JOP_CMP)
+            {
+                emit8(0x89); emit8(0x8b); emit32(o->dst);       // mov [rbx+dst],ecx
+            }
+            break;
+
+        case JOP_MOVEQ:
+            emit_store_imm(o->dst, o->imm);
+            break;
+
+        case JOP_MOVE:
+            emit_load_eax(o->src);
+            emit_store_eax(o->dst);
+            break;
+
+        case JOP_TST:
+            break;
+
+        case JOP_AND:
+        case JOP_OR:
+        case JOP_EOR:
+            emit_load_eax(o->src);
+            emit8((o->op == JOP_AND) ? 0x21 : (o->op == JOP_OR) ? 0x09 : 0x31);
+            emit8(0x83); emit32(o->dst);                        // and/or/xor [rbx+dst],eax
+            break;
+    }
+
+    emit_flags(o, mask);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Emit code that calculates condition codes after the instruction has been executed
+ *
+ * @param[in] o         decoded instruction
+ * @param[in] mask      condition codes to be stored
+ *
+ * @note Used when leaving the block early, before the next instruction has
+ *       overwritten the condition codes that have been left out.
+ *
+ ************************************************************************************************/
+static void emit_deferred_flags(const jit_op *o, unsigned mask)
+{
+    if (o->op <= JOP_SUBQ)
+    {
+        emit8(0x8b); emit8(0x8b); emit32(o->dst);               // mov ecx,[rbx+dst]
+        if (o->op != JOP_CMP)
+        {
+            emit_alu(o, 1);                                     // restore operand
+        }
+        emit_alu(o, 0);                                         // and repeat the operation
+    }
+    emit_flags(o, mask);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Change the access rights of the code memory, rounded to pages
+ *
+ * @param[in] from      first byte
+ * @param[in] to        behind the last byte
+ * @param[in] prot      PROT_READ | PROT_WRITE for emitting, PROT_READ | PROT_EXEC for running
+ *
+ * @return 0 for OK or -1 for error
+ *
+ ************************************************************************************************/
+static int jit_protect(uint8_t *from, uint8_t *to, int prot)
+{
+    size_t offs = (size_t) (from - jit_code) & ~(jit_page_size - 1);
+    size_t end = ((size_t) (to - jit_code) + jit_page_size - 1) & ~(jit_page_size - 1);
+    if (end > JIT_CODE_SIZE)
+    {
+        end = JIT_CODE_SIZE;
+    }
+    if (mprotect(jit_code + offs, end - offs, prot) != 0)
+    {
+        perror("JIT: cannot change access rights of code memory");
+        return -1;
+    }
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Allocate code memory, never writable and executable at the same time
+ *
+ * @param[in] p_generation  counter that is changed whenever cached code is invalidated
+ * @param[in] p_budget      instructions until the next event, or NULL, see m68k_SetEventBudget()
+ *
+ * @return 0 for OK or -1 for error
+ *
+ ************************************************************************************************/
+int m68ki_jit_init(const unsigned *p_generation, int *p_budget)
+{
+    jit_p_generation = p_generation;
+    jit_p_budget = p_budget;
+    if (jit_code == NULL)
+    {
+        // made executable block by block, see m68ki_jit_compile()
+        void *mem = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+        {
+            perror("JIT: cannot allocate code memory");
+            return -1;
+        }
+        jit_code = (uint8_t *) mem;
+        jit_page_size = (size_t) sysconf(_SC_PAGESIZE);
+    }
+    m68ki_jit_flush();
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Discard all translated code
+ *
+ * @note Must not be called while translated code is running.
+ *
+ ************************************************************************************************/
+void m68ki_jit_flush(void)
+{
+    if ((jit_code != NULL) && (jit_used > 0))
+    {
+        (void) jit_protect(jit_code, jit_code + jit_used, PROT_READ | PROT_WRITE);
+    }
+    jit_used = 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Translate a block
+ *
+ * @param[in] insn      cached instructions, insn[0] must be at the current PC
+ * @param[in] n         number of instructions
+ *
+ * @return host function or NULL, if the code buffer is full
+ *
+ ************************************************************************************************/
+m68ki_jit_func m68ki_jit_compile(const m68ki_bc_insn *insn, unsigned n)
+{
+    uint8_t *exit_fixup[JIT_MAX_INSNS][4];
+    unsigned num_fixups[JIT_MAX_INSNS];
+    jit_op ops[JIT_MAX_INSNS];
+    unsigned deferred[JIT_MAX_INSNS];           // condition codes left out, per instruction
+
+    if ((jit_code == NULL) || (n == 0))
+    {
+        return NULL;
+    }
+    if (n > JIT_MAX_INSNS)
+    {
+        n = JIT_MAX_INSNS;
+    }
+    if (jit_used + n * JIT_MAX_INSN_CODE + JIT_MAX_OVERHEAD > JIT_CODE_SIZE)
+    {
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        decode(&insn[i], &ops[i]);
+    }
+    for (unsigned i = 0; i < n; i++)
+    {
+        deferred[i] = 0;
+#if M68K_LAZY_FLAGS == OPT_ON
+        // Condition codes that are overwritten by the next instruction are not stored.
+        // If the block is left before, they are calculated in the exit code.
+        if ((i + 1 < n) && ops[i].deferrable)
+        {
+            deferred[i] = ops[i].writes & ops[i + 1].writes;
+        }
+#endif
+    }
+
+    // Writable while emitting. The first page may hold the end of the previous block,
+    // which cannot run meanwhile and is executable again below.
+    uint8_t *start = jit_code + jit_used;
+    uint8_t *limit = start + n * JIT_MAX_INSN_CODE + JIT_MAX_OVERHEAD;
+    if (jit_protect(start, limit, PROT_READ | PROT_WRITE))
+    {
+        return NULL;
+    }
+    p = start;
+
+    // prologue
+    emit8(0x53);                                            // push rbx
+    emit8(0x41); emit8(0x54);                               // push r12
+    emit8(0x41); emit8(0x55);                               // push r13
+    emit8(0x41); emit8(0x56);                               // push r14
+    emit8(0x48); emit8(0x83); emit8(0xec); emit8(0x08);     // sub rsp,8 (stack alignment)
+    emit8(0x48); emit8(0xbb); emit64((uintptr_t) &m68ki_cpu);            // mov rbx,&m68ki_cpu
+    emit8(0x49); emit8(0xbc); emit64((uintptr_t) &sExitImmediately);     // mov r12,&sExitImmediately
+    emit8(0x49); emit8(0xbd); emit64((uintptr_t) jit_p_generation);      // mov r13,&generation
+    emit8(0x45); emit8(0x8b); emit8(0x75); emit8(0x00);     // mov r14d,[r13]
+
+    uint8_t *loop_start = p;
+    for (unsigned i = 0; i < n; i++)
+    {
+        const m68ki_bc_insn *e = &insn[i];
+        num_fixups[i] = 0;
+
+        if (i > 0)
+        {
+            // same checks as the interpreter loop, the first instruction is checked by the caller
+            emit_checks(e->pc, exit_fixup[i], &num_fixups[i]);
+        }
+
+        emit_store_imm(CPU_OFFS(ppc), e->pc);
+        emit_store_imm(CPU_OFFS(ir), e->ir);
+        emit_store_imm(CPU_OFFS(pc), e->pc + 2);
+
+        if (ops[i].op != JOP_HANDLER)
+        {
+            emit_native(&ops[i], ops[i].writes & ~deferred[i]);
+        }
+        else
+        {
+            emit8(0x48); emit8(0xb8); emit64((uintptr_t) e->handler);  // mov rax,handler
+            emit8(0xff); emit8(0xd0);                                   // call rax
+        }
+    }
+
+    // all instructions executed, loop if the block branches back to its start
+    uint8_t *loop_fixup[5];
+    unsigned num_loop_fixups = 0;
+    emit_checks(insn[0].pc, loop_fixup, &num_loop_fixups);
+    if (jit_p_budget != NULL)
+    {
+        // count the iteration for the event budget, the last one is counted by the caller
+        emit8(0x48); emit8(0xb8); emit64((uintptr_t) jit_p_budget);     // mov rax,&budget
+        emit8(0x81); emit8(0x38); emit32(n);                // cmp dword [rax],n
+        loop_fixup[num_loop_fixups++] = emit_jcc(0x8e);     // jle exit
+        emit8(0x81); emit8(0x28); emit32(n);                // sub dword [rax],n
+    }
+    emit8(0xe9); emit32(0);                                 // jmp loop_start
+    fixup(p - 4, loop_start);
+    for (unsigned j = 0; j < num_loop_fixups; j++)
+    {
+        fixup(loop_fixup[j], p);
+    }
+    emit8(0xb8); emit32(n);                                 // mov eax,n
+
+    // epilogue
+    uint8_t *epilogue = p;
+    emit8(0x48); emit8(0x83); emit8(0xc4); emit8(0x08);     // add rsp,8
+    emit8(0x41); emit8(0x5e);                               // pop r14
+    emit8(0x41); emit8(0x5d);                               // pop r13
+    emit8(0x41); emit8(0x5c);                               // pop r12
+    emit8(0x5b);                                            // pop rbx
+    emit8(0xc3);                                            // ret
+
+    // exits, return number of instructions executed so far
+    for (unsigned i = 1; i < n; i++)
+    {
+        for (unsigned j = 0; j < num_fixups[i]; j++)
+        {
+            fixup(exit_fixup[i][j], p);
+        }
+        if (deferred[i - 1])
+        {
+            emit_deferred_flags(&ops[i - 1], deferred[i - 1]);
+        }
+        emit8(0xb8); emit32(i);                             // mov eax,i
+        emit8(0xe9); emit32(0);                             // jmp epilogue
+        fixup(p - 4, epilogue);
+    }
+
+    // align next block to 16 bytes
+    jit_used = ((size_t) (p - jit_code) + 15) & ~((size_t) 15);
+    if (jit_protect(start, p, PROT_READ | PROT_EXEC))
+    {
+        return NULL;
+    }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    return (m68ki_jit_func) start;
+#pragma GCC diagnostic pop
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 1990-2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Translation of cached 68k blocks to x86-64 code
+*
+*/
+
+#ifndef M68KJIT__HEADER
+#define M68KJIT__HEADER
+
+#include "m68kcpu.h"
+
+#if M68K_JIT == OPT_ON
+
+// translated block, returns index of the next instruction in the block
+typedef unsigned (*m68ki_jit_func)(void);
+
+int m68ki_jit_init(const unsigned *p_generation, int *p_budget);
+void m68ki_jit_flush(void);
+m68ki_jit_func m68ki_jit_compile(const m68ki_bc_insn *insn, unsigned n);
+
+#endif
+
+#endif /* M68KJIT__HEADER */
@@ -6617,7 +6617,6 @@ void m68k_op_bfffo_32_d(void)
 		uint offset = (word2>>6)&31;
 		uint width = word2;
 		uint64 data = DY;
-		uint bit;
 
 
 		if(BIT_B(word2))
@@ -6636,8 +6635,7 @@ void m68k_op_bfffo_32_d(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -6656,7 +6654,6 @@ void m68k_op_bfffo_32_ai(void)
 		sint local_offset;
 		uint width = word2;
 		uint data;
-		uint bit;
 		uint ea = EA_AY_AI_8();
 
 
@@ -6688,8 +6685,7 @@ void m68k_op_bfffo_32_ai(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -6708,7 +6704,6 @@ void m68k_op_bfffo_32_di(void)
 		sint local_offset;
 		uint width = word2;
 		uint data;
-		uint bit;
 		uint ea = EA_AY_DI_8();
 
 
@@ -6740,8 +6735,7 @@ void m68k_op_bfffo_32_di(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -6760,7 +6754,6 @@ void m68k_op_bfffo_32_ix(void)
 		sint local_offset;
 		uint width = word2;
 		uint data;
-		uint bit;
 		uint ea = EA_AY_IX_8();
 
 
@@ -6792,8 +6785,7 @@ void m68k_op_bfffo_32_ix(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -6812,7 +6804,6 @@ void m68k_op_bfffo_32_aw(void)
 		sint local_offset;
 		uint width = word2;
 		uint data;
-		uint bit;
 		uint ea = EA_AW_8();
 
 
@@ -6844,8 +6835,7 @@ void m68k_op_bfffo_32_aw(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -6864,7 +6854,6 @@ void m68k_op_bfffo_32_al(void)
 		sint local_offset;
 		uint width = word2;
 		uint data;
-		uint bit;
 		uint ea = EA_AL_8();
 
 
@@ -6896,8 +6885,7 @@ void m68k_op_bfffo_32_al(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -6916,7 +6904,6 @@ void m68k_op_bfffo_32_pcdi(void)
 		sint local_offset;
 		uint width = word2;
 		uint data;
-		uint bit;
 		uint ea = EA_PCDI_8();
 
 
@@ -6948,8 +6935,7 @@ void m68k_op_bfffo_32_pcdi(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -6968,7 +6954,6 @@ void m68k_op_bfffo_32_pcix(void)
 		sint local_offset;
 		uint width = word2;
 		uint data;
-		uint bit;
 		uint ea = EA_PCIX_8();
 
 
@@ -7000,8 +6985,7 @@ void m68k_op_bfffo_32_pcix(void)
 		FLAG_V = VFLAG_CLEAR;
 		FLAG_C = CFLAG_CLEAR;
 
-		for(bit = 1<<(width-1);bit && !(data & bit);bit>>= 1)
-			offset++;
+		offset += m68ki_bf_leading_zeros(data, width);
 
 		REG_D[(word2>>12)&7] = offset;
 
@@ -1109,6 +1109,12 @@ void m68k_op_divl_32_d(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -1320,6 +1326,12 @@ void m68k_op_divl_32_ai(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -1531,6 +1543,12 @@ void m68k_op_divl_32_pi(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -1742,6 +1760,12 @@ void m68k_op_divl_32_pd(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -1953,6 +1977,12 @@ void m68k_op_divl_32_di(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -2164,6 +2194,12 @@ void m68k_op_divl_32_ix(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -2375,6 +2411,12 @@ void m68k_op_divl_32_aw(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -2586,6 +2628,12 @@ void m68k_op_divl_32_al(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -2797,6 +2845,12 @@ void m68k_op_divl_32_pcdi(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -3008,6 +3062,12 @@ void m68k_op_divl_32_pcix(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -3219,6 +3279,12 @@ void m68k_op_divl_32_i(void)
 
 				if(BIT_B(word2))	   /* signed */
 				{
+					if((dividend == 0x8000000000000000ULL) && ((sint32)divisor == -1))
+					{
+						/* the quotient does not fit, and the host would trap */
+						FLAG_V = VFLAG_SET;
+						return;
+					}
 					quotient  = (uint64)((sint64)dividend / (sint64)((sint32)divisor));
 					remainder = (uint64)((sint64)dividend % (sint64)((sint32)divisor));
 					if((sint64)quotient != (sint64)((sint32)quotient))
@@ -10496,6 +10562,14 @@ void m68k_op_movem_32_re_pd(void)
 	uint ea = AY;
 	uint count = 0;
 
+#if M68K_COPY_IDIOMS == OPT_ON
+	if(m68ki_movem_32_re_fast(ea - (__builtin_popcount(register_list) << 2), register_list, 1))
+	{
+		count = __builtin_popcount(register_list);
+		ea -= count << 2;
+	}
+	else
+#endif
 	for(; i < 16; i++)
 		if(register_list & (1 << i))
 		{
@@ -10516,6 +10590,11 @@ void m68k_op_movem_32_re_ai(void)
 	uint ea = EA_AY_AI_32();
 	uint count = 0;
 
+#if M68K_COPY_IDIOMS == OPT_ON
+	if(m68ki_movem_32_re_fast(ea, register_list, 0))
+		count = __builtin_popcount(register_list);
+	else
+#endif
 	for(; i < 16; i++)
 		if(register_list & (1 << i))
 		{
@@ -10535,6 +10614,11 @@ void m68k_op_movem_32_re_di(void)
 	uint ea = EA_AY_DI_32();
 	uint count = 0;
 
+#if M68K_COPY_IDIOMS == OPT_ON
+	if(m68ki_movem_32_re_fast(ea, register_list, 0))
+		count = __builtin_popcount(register_list);
+	else
+#endif
 	for(; i < 16; i++)
 		if(register_list & (1 << i))
 		{
@@ -10765,6 +10849,14 @@ void m68k_op_movem_32_er_pi(void)
 	uint ea = AY;
 	uint count = 0;
 
+#if M68K_COPY_IDIOMS == OPT_ON
+	if(m68ki_movem_32_er_fast(ea, register_list))
+	{
+		count = __builtin_popcount(register_list);
+		ea += count << 2;
+	}
+	else
+#endif
 	for(; i < 16; i++)
 		if(register_list & (1 << i))
 		{
@@ -10823,6 +10915,11 @@ void m68k_op_movem_32_er_ai(void)
 	uint ea = EA_AY_AI_32();
 	uint count = 0;
 
+#if M68K_COPY_IDIOMS == OPT_ON
+	if(m68ki_movem_32_er_fast(ea, register_list))
+		count = __builtin_popcount(register_list);
+	else
+#endif
 	for(; i < 16; i++)
 		if(register_list & (1 << i))
 		{
@@ -10842,6 +10939,11 @@ void m68k_op_movem_32_er_di(void)
 	uint ea = EA_AY_DI_32();
 	uint count = 0;
 
+#if M68K_COPY_IDIOMS == OPT_ON
+	if(m68ki_movem_32_er_fast(ea, register_list))
+		count = __builtin_popcount(register_list);
+	else
+#endif
 	for(; i < 16; i++)
 		if(register_list & (1 << i))
 		{
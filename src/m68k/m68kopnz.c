@@ -3369,7 +3369,9 @@ void m68k_op_roxr_32_s(void)
 	uint64 res   = src | (((uint64)XFLAG_AS_1()) << 32);
 
 	if(shift != 0)
+	{
 		USE_CYCLES(shift<<CYC_SHIFT);
+	}
 
 	res = ROR_33_64(res, shift);
 
@@ -3703,7 +3705,9 @@ void m68k_op_roxl_32_s(void)
 	uint64 res   = src | (((uint64)XFLAG_AS_1()) << 32);
 
 	if(shift != 0)
+	{
 		USE_CYCLES(shift<<CYC_SHIFT);
+	}
 
 	res = ROL_33_64(res, shift);
 
@@ -35,8 +35,9 @@
 #include "Atari.h"
 #include "gui.h"
 #include "register_model.h"
+#include "MagiCScreen.h"
 
-// compile time switches
+// compile time switches, select the checks of the production core
 
 #ifdef _DEBUG
 #define _DEBUG_WRITEPROTECT_ATARI_OS
@@ -241,7 +242,23 @@ static void getAtariPrg(const char **pprocName, uint32_t *pact_pd)
 }
 
 
-#if defined(M68K_WRITE_WATCHES)
+/*
+* Checks done by the slow path of the memory access functions. The production
+* core only does those selected at compile time, the debug core all of them.
+* The affected pages are marked in the page attribute table, so that accesses
+* to other pages are not slowed down.
+*/
+
+#define MEM_CHECK_NULLPTR       0x01    // bus error for user mode access to 0..7
+#define MEM_CHECK_VECTORS       0x02    // log changes of exception vectors and system variables
+#define MEM_CHECK_WRPROT_OS     0x04    // bus error for writing to MagiC OS
+#define MEM_CHECK_WATCHES       0x08    // log writing to addresses in m68k_write_watches[]
+#define MEM_CHECK_ALL           0x0f
+
+static bool memDebug68k = false;        // debug core active
+static unsigned memChecks68k = 0;       // MEM_CHECK_... bits
+
+
 /** **********************************************************************************************
  *
  * @brief Debug helper to find a write-watch
@@ -255,20 +272,17 @@ static bool is_write_watch(uint32_t address)
 {
     for (unsigned i = 0; i < M68K_WRITE_WATCHES; i++)
     {
-        if (address == m68k_write_watches[i])
+        if ((address == m68k_write_watches[i]) && (address != 0))
         {
             return true;
         }
     }
     return false;
 }
-#endif
-
 
-#if defined(EMULATE_NULLPTR_BUSERR)
 
 #define HANDLE_LOWMEM_READ_BUSERR(address, text) \
-    if ((address < 8) && !m68k_get_super()) \
+    if ((memChecks68k & MEM_CHECK_NULLPTR) && (address < 8) && !m68k_get_super()) \
     { \
         const char *procName; \
         uint32_t act_pd; \
@@ -280,7 +294,7 @@ static bool is_write_watch(uint32_t address)
     }
 
 #define HANDLE_LOWMEM_WRITE_BUSERR(address, text) \
-    if ((address < 8) && !m68k_get_super()) \
+    if ((memChecks68k & MEM_CHECK_NULLPTR) && (address < 8) && !m68k_get_super()) \
     { \
         const char *procName; \
         uint32_t act_pd; \
@@ -291,17 +305,9 @@ static bool is_write_watch(uint32_t address)
         return; \
     }
 
-#else
-
-#define HANDLE_LOWMEM_READ_BUSERR(address, text)
-#define HANDLE_LOWMEM_WRITE_BUSERR(address, text)
-
-#endif
-
-#if defined(_DEBUG_WRITEPROTECT_ATARI_OS)
-
 #define WRITE_PROTECT_OS(address, text) \
-    if ((address >= addrOsRomStart) && (address < addrOsRomEnd)) \
+    if ((memChecks68k & MEM_CHECK_WRPROT_OS) && \
+        (address >= addrOsRomStart) && (address < addrOsRomEnd)) \
     { \
         const char *procName; \
         uint32_t act_pd; \
@@ -311,16 +317,10 @@ static bool is_write_watch(uint32_t address)
         sendBusError(address, text); \
         return; \
     }
-#else
-
-#define WRITE_PROTECT_OS(address, text)
-
-#endif
-
-#if defined(_DEBUG_WATCH_68K_VECTOR_CHANGE)
 
 #define WATCH_68K_VECTOR_CHANGE(address, value) \
-    if ((address < 0x140) || \
+    if ((memChecks68k & MEM_CHECK_VECTORS) && \
+       ((address < 0x140) || \
        (address == _v_bas_ad) || \
        /*(address = etv_timer) ||*/ \
        (address == etv_critic) || \
@@ -330,7 +330,7 @@ static bool is_write_watch(uint32_t address)
        (address == _memtop) || \
        (address == _vblqueue) || \
        (address == colorptr) || \
-       (address == screenpt)) \
+       (address == screenpt))) \
     { \
         const char *vecname = exception68k_to_name(address); \
         const char *procName; \
@@ -339,9 +339,145 @@ static bool is_write_watch(uint32_t address)
         DebugWarning2("() -- 68k vec 0x%08x := 0x%08x (%s) by process %s", \
                         address, value, vecname, procName); \
     }
+
+/*
+* Page attribute table
+*
+* For each 4 KiB page of the 32-bit 68k address space there is an attribute byte.
+* Pages of regular Atari memory that need no further checks are read and written
+* directly with a single table lookup. All other pages, i.e. video memory, I/O
+* registers, write-protected OS and pages with debug checks, take the slow path
+* with the complete address decoding.
+*/
+
+#define MEM_PAGE_SHIFT      12
+#define MEM_PAGE_SIZE       (1U << MEM_PAGE_SHIFT)
+#define MEM_PAGES           (1U << (32 - MEM_PAGE_SHIFT))
+
+#define MEM_PAGE_RAM        0x01    // regular Atari memory, completely inside [0..addr68kVideo[
+#define MEM_PAGE_WRPROT     0x02    // write protected, i.e. MagiC OS
+#define MEM_PAGE_DEBUG      0x04    // bus error emulation or write watches
+// 0: video memory, I/O or bus error, handled by the slow path
+
+static uint8_t pageAttr68k[MEM_PAGES];
+
+#define MEM_READ_FAST(address) \
+    ((pageAttr68k[(address) >> MEM_PAGE_SHIFT] & ~MEM_PAGE_WRPROT) == MEM_PAGE_RAM)
+#define MEM_WRITE_FAST(address) \
+    (pageAttr68k[(address) >> MEM_PAGE_SHIFT] == MEM_PAGE_RAM)
+
+
+/** **********************************************************************************************
+ *
+ * @brief Set attributes for all pages overlapping a 68k address range
+ *
+ * @param[in] start     68k start address
+ * @param[in] end       68k end address, exclusive
+ * @param[in] attr      attribute bits to add
+ *
+ ************************************************************************************************/
+static void setPageAttr68k(uint32_t start, uint32_t end, uint8_t attr)
+{
+    if (end <= start)
+    {
+        return;
+    }
+    uint32_t last = (end - 1) >> MEM_PAGE_SHIFT;
+    for (uint32_t page = start >> MEM_PAGE_SHIFT; page <= last; page++)
+    {
+        pageAttr68k[page] |= attr;
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Build the page attribute table
+ *
+ * @note Must be called after the 68k address ranges have been calculated and
+ *       before the 68k emulator is started.
+ *
+ ************************************************************************************************/
+void initPageTable68k()
+{
+    if (memDebug68k)
+    {
+        memChecks68k = MEM_CHECK_ALL;
+    }
+    else
+    {
+        memChecks68k = 0;
+#if defined(EMULATE_NULLPTR_BUSERR)
+        memChecks68k |= MEM_CHECK_NULLPTR;
+#endif
+#if defined(_DEBUG_WATCH_68K_VECTOR_CHANGE)
+        memChecks68k |= MEM_CHECK_VECTORS;
+#endif
+#if defined(_DEBUG_WRITEPROTECT_ATARI_OS)
+        memChecks68k |= MEM_CHECK_WRPROT_OS;
+#endif
+    }
+
+    memset(pageAttr68k, 0, sizeof(pageAttr68k));
+
+    // Only complete pages are regular memory. A partial page at the end
+    // is decoded by the slow path.
+    for (uint32_t page = 0; page < (addr68kVideo >> MEM_PAGE_SHIFT); page++)
+    {
+        pageAttr68k[page] = MEM_PAGE_RAM;
+    }
+
+    if (memChecks68k & MEM_CHECK_WRPROT_OS)
+    {
+        setPageAttr68k(addrOsRomStart, addrOsRomEnd, MEM_PAGE_WRPROT);
+    }
+    if (memChecks68k & (MEM_CHECK_NULLPTR | MEM_CHECK_VECTORS))
+    {
+        // exception vectors and system variables
+        setPageAttr68k(0, screenpt + 4, MEM_PAGE_DEBUG);
+    }
+    if (memChecks68k & MEM_CHECK_WATCHES)
+    {
+        for (unsigned i = 0; i < M68K_WRITE_WATCHES; i++)
+        {
+            if (m68k_write_watches[i] != 0)
+            {
+                setPageAttr68k(m68k_write_watches[i], m68k_write_watches[i] + 1, MEM_PAGE_DEBUG);
+            }
+        }
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Select the memory checks of the production or the debug core
+ *
+ * @param[in] bDebug    true: do all checks, including write watches
+ *
+ * @note Must be called while the 68k emulator is not running, also after
+ *       changing m68k_write_watches[].
+ *
+ ************************************************************************************************/
+void setDebugMem68k(bool bDebug)
+{
+    memDebug68k = bDebug;
+    initPageTable68k();
+}
+
+
+#if M68K_BLOCK_CACHE == OPT_ON
+
+// remove cached 68k opcodes, if the memory page is overwritten
+#define INVALIDATE_CODE(address, size) \
+    if (sCodePages[(address) >> M68K_CODE_PAGE_SHIFT] || \
+        sCodePages[((address) + (size) - 1) >> M68K_CODE_PAGE_SHIFT]) \
+    { \
+        m68k_InvalidateCode(address, size); \
+    }
 #else
 
-#define WATCH_68K_VECTOR_CHANGE(address, value)
+#define INVALIDATE_CODE(address, size)
 
 #endif
 
@@ -357,6 +493,12 @@ static bool is_write_watch(uint32_t address)
  ************************************************************************************************/
 m68k_data_type m68k_read_memory_8(m68k_addr_type address)
 {
+    if (MEM_READ_FAST(address))
+    {
+        // regular memory without further checks
+        return *((uint8_t *) (addrOpcodeROM + address));
+    }
+
     HANDLE_LOWMEM_READ_BUSERR(address, "read byte")
     if (address < addr68kVideo)
     {
@@ -407,6 +549,12 @@ m68k_data_type m68k_read_memory_8(m68k_addr_type address)
  ************************************************************************************************/
 m68k_data_type m68k_read_memory_16(m68k_addr_type address)
 {
+    if (MEM_READ_FAST(address))
+    {
+        // regular memory without further checks
+        return getAtariBE16(addrOpcodeROM + address);
+    }
+
     HANDLE_LOWMEM_READ_BUSERR(address, "read 16-bit")
     if (address < addr68kVideo)
     {
@@ -465,6 +613,12 @@ m68k_data_type m68k_read_memory_16(m68k_addr_type address)
  ************************************************************************************************/
 m68k_data_type m68k_read_memory_32(m68k_addr_type address)
 {
+    if (MEM_READ_FAST(address))
+    {
+        // regular memory without further checks
+        return getAtariBE32(addrOpcodeROM + address);
+    }
+
     HANDLE_LOWMEM_READ_BUSERR(address, "read 32-bit")
     if (address < addr68kVideo)
     {
@@ -521,12 +675,18 @@ m68k_data_type m68k_read_memory_32(m68k_addr_type address)
  ************************************************************************************************/
 void m68k_write_memory_8(m68k_addr_type address, m68k_data_type value)
 {
-#if defined(M68K_WRITE_WATCHES)
-    if (is_write_watch(address))
+    if (MEM_WRITE_FAST(address))
+    {
+        // regular memory without further checks
+        *((uint8_t *) (addrOpcodeROM + address)) = (uint8_t) value;
+        INVALIDATE_CODE(address, 1)
+        return;
+    }
+
+    if ((memChecks68k & MEM_CHECK_WATCHES) && is_write_watch(address))
     {
         printf("write.8 value 0x%02x to 68k addr 0x%08x\n", value, address);
     }
-#endif
 
     HANDLE_LOWMEM_WRITE_BUSERR(address, "write byte")
     WATCH_68K_VECTOR_CHANGE(address, value);       // although non-32-bit access is improbable...
@@ -536,6 +696,7 @@ void m68k_write_memory_8(m68k_addr_type address, m68k_data_type value)
     {
         // write regular memory
         *((uint8_t *) (addrOpcodeROM + address)) = (uint8_t) value;
+        INVALIDATE_CODE(address, 1)
         return;
     }
 
@@ -543,7 +704,7 @@ void m68k_write_memory_8(m68k_addr_type address, m68k_data_type value)
     {
         address -= addr68kVideo;
         *((uint8_t *) (hostVideoAddr + address)) = (uint8_t) value;
-        atomic_store(&gbAtariVideoBufChanged, true);
+        CMagiCScreen::setDirty(address, 1);
         return;
     }
 
@@ -594,12 +755,18 @@ void m68k_write_memory_8(m68k_addr_type address, m68k_data_type value)
  ************************************************************************************************/
 void m68k_write_memory_16(m68k_addr_type address, m68k_data_type value)
 {
-#if defined(M68K_WRITE_WATCHES)
-    if (is_write_watch(address))
+    if (MEM_WRITE_FAST(address))
     {
-        printf("write.8 value 0x%02x to 68k addr 0x%08x\n", value, address);
+        // regular memory without further checks
+        setAtariBE16(addrOpcodeROM + address, value);
+        INVALIDATE_CODE(address, 2)
+        return;
+    }
+
+    if ((memChecks68k & MEM_CHECK_WATCHES) && is_write_watch(address))
+    {
+        printf("write.16 value 0x%04x to 68k addr 0x%08x\n", value, address);
     }
-#endif
 
     HANDLE_LOWMEM_WRITE_BUSERR(address, "write 16-bit")
     WATCH_68K_VECTOR_CHANGE(address, value);       // although non-32-bit access is improbable...
@@ -609,6 +776,7 @@ void m68k_write_memory_16(m68k_addr_type address, m68k_data_type value)
     {
         // write regular 68k memory (big endian)
         setAtariBE16(addrOpcodeROM + address, value);
+        INVALIDATE_CODE(address, 2)
         return;
     }
 
@@ -625,7 +793,7 @@ void m68k_write_memory_16(m68k_addr_type address, m68k_data_type value)
             setAtariBE16(hostVideoAddr + address, value);
         }
 
-        atomic_store(&gbAtariVideoBufChanged, true);
+        CMagiCScreen::setDirty(address, 2);
         return;
     }
 
@@ -664,12 +832,18 @@ void m68k_write_memory_16(m68k_addr_type address, m68k_data_type value)
  ************************************************************************************************/
 void m68k_write_memory_32(m68k_addr_type address, m68k_data_type value)
 {
-#if defined(M68K_WRITE_WATCHES)
-    if (is_write_watch(address))
+    if (MEM_WRITE_FAST(address))
     {
-        printf("write.8 value 0x%02x to 68k addr 0x%08x\n", value, address);
+        // regular memory without further checks
+        setAtariBE32(addrOpcodeROM + address, value);
+        INVALIDATE_CODE(address, 4)
+        return;
+    }
+
+    if ((memChecks68k & MEM_CHECK_WATCHES) && is_write_watch(address))
+    {
+        printf("write.32 value 0x%08x to 68k addr 0x%08x\n", value, address);
     }
-#endif
 
     HANDLE_LOWMEM_WRITE_BUSERR(address, "write 32-bit")
     WATCH_68K_VECTOR_CHANGE(address, value);       // process changed 68k exception vector
@@ -679,6 +853,7 @@ void m68k_write_memory_32(m68k_addr_type address, m68k_data_type value)
     {
         // write regular 68k memory (big endian)
         setAtariBE32(addrOpcodeROM + address, value);
+        INVALIDATE_CODE(address, 4)
         return;
     }
 
@@ -695,7 +870,7 @@ void m68k_write_memory_32(m68k_addr_type address, m68k_data_type value)
             setAtariBE32(hostVideoAddr + address, value);
         }
 
-        atomic_store(&gbAtariVideoBufChanged, true);
+        CMagiCScreen::setDirty(address, 4);
         return;
     }
 
@@ -723,4 +898,227 @@ void m68k_write_memory_32(m68k_addr_type address, m68k_data_type value)
     sendBusError(address, "write long");
 }
 
+
+#if M68K_COPY_IDIOMS == OPT_ON
+
+/** **********************************************************************************************
+ *
+ * @brief Get the host address of a 68k memory range for block transfers
+ *
+ * @param[in]  address      68k start address
+ * @param[in]  len          length in bytes, not zero
+ * @param[in]  bWrite       range will be written
+ * @param[out] pbHostEndian range is video memory in host byte order
+ *
+ * @return host address, or nullptr if the range is not completely regular or video memory
+ *
+ ************************************************************************************************/
+static uint8_t *getBlockAddr68k(uint32_t address, uint32_t len, bool bWrite, bool *pbHostEndian)
+{
+    uint32_t last = address + len - 1;
+    if (last < address)
+    {
+        return nullptr;     // wrap-around
+    }
+
+    *pbHostEndian = false;
+    if ((address >= addr68kVideo) && (last < addr68kVideoEnd))
+    {
+        *pbHostEndian = gbAtariVideoRamHostEndian;
+        return hostVideoAddr + (address - addr68kVideo);
+    }
+
+    uint8_t mask = (bWrite) ? 0xff : (uint8_t) ~MEM_PAGE_WRPROT;
+    for (uint32_t page = address >> MEM_PAGE_SHIFT; page <= (last >> MEM_PAGE_SHIFT); page++)
+    {
+        if ((pageAttr68k[page] & mask) != MEM_PAGE_RAM)
+        {
+            return nullptr;
+        }
+    }
+    return addrOpcodeROM + address;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Helpers to read and write an element of a block transfer in big-endian or host order
+ *
+ ************************************************************************************************/
+static inline uint32_t getBlockElem(const uint8_t *p, unsigned size, bool bHostEndian)
+{
+    if (size == 1)
+    {
+        return *p;
+    }
+    if (size == 2)
+    {
+        return (bHostEndian) ? *((const uint16_t *) p) : getAtariBE16(p);
+    }
+    return (bHostEndian) ? *((const uint32_t *) p) : getAtariBE32(p);
+}
+
+static inline void setBlockElem(uint8_t *p, unsigned size, uint32_t value, bool bHostEndian)
+{
+    if (size == 1)
+    {
+        *p = (uint8_t) value;
+    }
+    else
+    if (size == 2)
+    {
+        if (bHostEndian)
+        {
+            *((uint16_t *) p) = (uint16_t) value;
+        }
+        else
+        {
+            setAtariBE16(p, value);
+        }
+    }
+    else
+    {
+        if (bHostEndian)
+        {
+            *((uint32_t *) p) = value;
+        }
+        else
+        {
+            setAtariBE32(p, value);
+        }
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Notify the block cache or the screen about a block write
+ *
+ ************************************************************************************************/
+static void endBlockWrite68k(uint32_t address, uint32_t len)
+{
+    if (address >= addr68kVideo)
+    {
+        CMagiCScreen::setDirty(address - addr68kVideo, len);
+    }
+    else
+    {
+        m68k_InvalidateCode(address, len);
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief 68k-Emu function: copy a block, like a "move (a0)+,(a1)+" loop
+ *
+ * @param[in] dst       68k destination address
+ * @param[in] src       68k source address
+ * @param[in] size      element size, 1, 2 or 4
+ * @param[in] count     number of elements, not zero
+ *
+ * @return 1: done, 0: must be done by single moves
+ *
+ ************************************************************************************************/
+int m68k_copy_memory(m68k_addr_type dst, m68k_addr_type src, unsigned size, unsigned count)
+{
+    uint32_t len = size * count;
+    if ((dst > src) && (dst - src < len))
+    {
+        // a forward copy to an overlapping higher address repeats a pattern
+        return 0;
+    }
+
+    bool bHostSrc, bHostDst;
+    const uint8_t *s = getBlockAddr68k(src, len, false, &bHostSrc);
+    uint8_t *d = getBlockAddr68k(dst, len, true, &bHostDst);
+    if ((s == nullptr) || (d == nullptr))
+    {
+        return 0;
+    }
+
+    if ((bHostSrc == bHostDst) || (size == 1))
+    {
+        memmove(d, s, len);
+    }
+    else
+    {
+        // between regular memory and video memory in host byte order
+        for (uint32_t i = 0; i < len; i += size)
+        {
+            setBlockElem(d + i, size, getBlockElem(s + i, size, bHostSrc), bHostDst);
+        }
+    }
+    endBlockWrite68k(dst, len);
+    return 1;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief 68k-Emu function: fill a block, like a "move d0,(a0)+" loop
+ *
+ * @param[in] dst       68k destination address
+ * @param[in] value     element value
+ * @param[in] size      element size, 1, 2 or 4
+ * @param[in] count     number of elements, not zero
+ *
+ * @return 1: done, 0: must be done by single moves
+ *
+ ************************************************************************************************/
+int m68k_fill_memory(m68k_addr_type dst, m68k_data_type value, unsigned size, unsigned count)
+{
+    uint32_t len = size * count;
+    bool bHostDst;
+    uint8_t *d = getBlockAddr68k(dst, len, true, &bHostDst);
+    if (d == nullptr)
+    {
+        return 0;
+    }
+
+    if ((value == 0) || (size == 1))
+    {
+        memset(d, (int) value, len);
+    }
+    else
+    {
+        setBlockElem(d, size, value, bHostDst);
+        for (uint32_t i = size; i < len; i += size)
+        {
+            memcpy(d + i, d, size);
+        }
+    }
+    endBlockWrite68k(dst, len);
+    return 1;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief 68k-Emu function: get direct access to regular memory, e.g. for MOVEM
+ *
+ * @param[in] address   68k start address
+ * @param[in] len       length in bytes, not zero
+ * @param[in] write     the range will be written
+ *
+ * @return host address, or nullptr if the memory access functions must be used
+ *
+ ************************************************************************************************/
+unsigned char *m68k_host_memory(m68k_addr_type address, unsigned len, int write)
+{
+    bool bHostEndian;
+    uint8_t *p = getBlockAddr68k(address, len, write != 0, &bHostEndian);
+    if ((p == nullptr) || (address >= addr68kVideo))
+    {
+        return nullptr;
+    }
+    if (write)
+    {
+        INVALIDATE_CODE(address, len)
+    }
+    return p;
+}
+
+#endif
+
 } // end extern "C"
@@ -13,6 +13,7 @@
 #include "Debug.h"
 #include "Globals.h"
 #include "MagiC.h"
+#include "EventScheduler.h"
 #include "Atari.h"
 #include "network.h"
 #include "conversion.h"
@@ -506,7 +507,8 @@ void *CNetwork::receiveFunc(void *arg)
                 break;
             case 4:
             default:
-                sendVBL();
+                // raised by the emulator thread, see CEventScheduler::poll()
+                CEventScheduler::postIrq(M68K_IRQ_4);
                 break;
             case 5:
                 /* TriggerInt5(); */
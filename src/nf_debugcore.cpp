@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 1990-2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* NF_DEBUGCORE: switch the 68k emulator between production and debug core
+*
+*   fncode 0: get_state(), returns 1 if the debug core is running
+*   fncode 1: set_state(int32 on), takes effect after the current instruction
+*
+*/
+
+#include "config.h"
+#include "MagiC.h"
+#include "Globals.h"
+#include "m68kcpu.h"
+#include "natfeat.h"
+#include "nf_debugcore.h"
+
+/******************************************************************************/
+/*** ---------------------------------------------------------------------- ***/
+/******************************************************************************/
+
+static void NF_DebugCore_init(void)
+{
+}
+
+/*** ---------------------------------------------------------------------- ***/
+
+static void NF_DebugCore_exit(void)
+{
+}
+
+/*** ---------------------------------------------------------------------- ***/
+
+static void NF_DebugCore_reset(void)
+{
+}
+
+/*** ---------------------------------------------------------------------- ***/
+
+static sint32 NF_DebugCore_dispatch(uint32 fncode, uint32 args)
+{
+    switch (fncode)
+    {
+    case 0:
+        return m68k_GetDebugCore();
+
+    case 1:
+        CMagiC::requestDebugCore(nf_getparameter(args, 0) != 0);
+        break;
+    }
+    return 0;
+}
+
+/*** ---------------------------------------------------------------------- ***/
+
+NF_Base const nf_debugcore = {
+    NF_DebugCore_init,
+    NF_DebugCore_exit,
+    NF_DebugCore_reset,
+    "NF_DEBUGCORE",
+    true,
+    NF_DebugCore_dispatch
+};
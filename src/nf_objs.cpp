@@ -28,6 +28,7 @@
 #include "natfeat.h"
 #include "nf_basicset.h"
 #include "nf_debugprintf.h"
+#include "nf_debugcore.h"
 
 
 
@@ -41,7 +42,8 @@ extern const NF_Base *const nf_objects[] = {
     /* add your NatFeat object below */
 
     /* */
-    &nf_debugprintf
+    &nf_debugprintf,
+    &nf_debugcore
 };
 
 extern unsigned int const nf_objs_cnt = sizeof(nf_objects) / sizeof(nf_objects[0]);
@@ -55,25 +55,32 @@
 #define VAR_ATARI_SCREEN_STRETCH_Y      12
 #define VAR_ATARI_SCREEN_RATE_HZ        13
 #define VAR_ATARI_SCREEN_COLOUR_MODE    14
-#define VAR_HIDE_HOST_MOUSE             15
-#define VAR_RELATIVE_MOUSE              16
-#define VAR_APP_DISPLAY_NUMBER          17
-#define VAR_APP_WINDOW_X                18
-#define VAR_APP_WINDOW_Y                19
-#define VAR_ATARI_MEMORY_SIZE           20
-#define VAR_ATARI_LANGUAGE              21
-#define VAR_SHOW_HOST_MENU              22
-#define VAR_ATARI_AUTOSTART             23
-#define VAR_ATARI_DRV_                  24
-#define VAR_ETH0_TYPE                   25
-#define VAR_ETH0_TUNNEL                 26
-#define VAR_ETH0_HOST_IP                27
-#define VAR_ETH0_ATARI_IP               28
-#define VAR_ETH0_NETMASK                29
-#define VAR_ETH0_GATEWAY                30
-#define VAR_ETH0_MAC                    31
-#define VAR_ETH0_INTLEVEL               32
-#define VAR_NUMBER                      33
+#define VAR_ATARI_SCREEN_CONV_THREADS   15
+#define VAR_ATARI_SCREEN_VSYNC          16
+#define VAR_HIDE_HOST_MOUSE             17
+#define VAR_RELATIVE_MOUSE              18
+#define VAR_APP_DISPLAY_NUMBER          19
+#define VAR_APP_WINDOW_X                20
+#define VAR_APP_WINDOW_Y                21
+#define VAR_ATARI_MEMORY_SIZE           22
+#define VAR_ATARI_LANGUAGE              23
+#define VAR_SHOW_HOST_MENU              24
+#define VAR_ATARI_AUTOSTART             25
+#define VAR_ATARI_JIT                   26
+#define VAR_ATARI_FPU                   27
+#define VAR_ATARI_CLOCK_CATCHUP         28
+#define VAR_ATARI_TICKLESS_IDLE_MS      29
+#define VAR_ATARI_CPU_LIMIT             30
+#define VAR_ATARI_DRV_                  31
+#define VAR_ETH0_TYPE                   32
+#define VAR_ETH0_TUNNEL                 33
+#define VAR_ETH0_HOST_IP                34
+#define VAR_ETH0_ATARI_IP               35
+#define VAR_ETH0_NETMASK                36
+#define VAR_ETH0_GATEWAY                37
+#define VAR_ETH0_MAC                    38
+#define VAR_ETH0_INTLEVEL               39
+#define VAR_NUMBER                      40
 
 // variable names in preferences
 static const char *var_name[VAR_NUMBER] =
@@ -96,6 +103,8 @@ static const char *var_name[VAR_NUMBER] =
     "atari_screen_stretch_y",
     "atari_screen_rate_hz",
     "atari_screen_colour_mode",
+    "atari_screen_conv_threads",
+    "atari_screen_vsync",
     "hide_host_mouse",
     "relative_mouse",
     //[SCREEN PLACEMENT]
@@ -107,6 +116,11 @@ static const char *var_name[VAR_NUMBER] =
     "atari_language",
     "show_host_menu",
     "atari_autostart",
+    "atari_jit",
+    "atari_fpu",
+    "atari_clock_catchup",
+    "atari_tickless_idle_ms",
+    "atari_cpu_limit",
     //[ADDITIONAL ATARI DRIVES]
     "atari_drv_",
     //[ETH0]
@@ -128,6 +142,11 @@ enAtariScreenColourMode Preferences::atariScreenColourMode = atariScreenMode16M;
 bool Preferences::bHideHostMouse = false;
 bool Preferences::bRelativeMouse = false;
 bool Preferences::bAutoStartMagiC = true;
+bool Preferences::bJit = true;
+unsigned Preferences::AtariFpu = 0;
+bool Preferences::bClockCatchUp = true;
+unsigned Preferences::TicklessIdleMs = 0;
+unsigned Preferences::CpuLimit = 0;
 unsigned Preferences::drvFlags[NDRIVES];    // 1 == RdOnly / 2 == 8+3 / 4 == case insensitive, ...
 const char *Preferences::drvPath[NDRIVES];
 char Preferences::AtariKernelPath[1024] = "";       // empty: used default path
@@ -147,8 +166,11 @@ unsigned Preferences::AtariScreenHeight = 768;
 unsigned Preferences::AtariScreenStretchX = 2;
 unsigned Preferences::AtariScreenStretchY = 2;
 unsigned Preferences::ScreenRefreshFrequency = 60;
+unsigned Preferences::ScreenConvThreads = 0;
+bool Preferences::bScreenVsync = false;
 const char *Preferences::AtariStartApplications[MAX_START_APPS];
 const char *Preferences::mountDriveParameter = nullptr;
+bool Preferences::bWarp = false;
 //bool Preferences::bPPC_VDI_Patch;
 struct ethernet_options Preferences::eth[MAX_ETH] =
 {
@@ -193,6 +215,7 @@ static const char *get_home()
  * @param[in] stretch_y_override        override prerence value
  * @param[in] double_vert               override vertical stretch with 2*horizontal
  * @param[in] relative_mouse_override   override prerence value
+ * @param[in] jit_override              override prerence value
  * @param[in] memsize_override          override prerence value
  * @param[in] rootfs_override           override prerence value
  * @param[in] rewrite_conf              overwrite existing configuration file with default values
@@ -213,6 +236,7 @@ int Preferences::init
     int stretch_y_override,
     bool double_vert,
     int relative_mouse_override,
+    int jit_override,
     int memsize_override,
     const char *rootfs_override,
     const char *kernel_override,
@@ -271,6 +295,10 @@ int Preferences::init
     {
         bRelativeMouse = (relative_mouse_override) ? true : false;
     }
+    if (jit_override >= 0)
+    {
+        bJit = (jit_override) ? true : false;
+    }
     if (memsize_override >= 0)
     {
         AtariMemSize = memsize_override;
@@ -527,6 +555,10 @@ int Preferences::writePreferences(const char *cfgfile)
     fprintf(f, "%s = %u\n",     var_name[VAR_ATARI_SCREEN_RATE_HZ], ScreenRefreshFrequency);
     fprintf(f, "%s = %u\n",     var_name[VAR_ATARI_SCREEN_COLOUR_MODE], atariScreenColourMode);
     fprintf(f, "# 0:24b 1:16b 2:256 3:16 4:16ip 5:4ip 6:mono\n");
+    fprintf(f, "%s = %u\n",     var_name[VAR_ATARI_SCREEN_CONV_THREADS], ScreenConvThreads);
+    fprintf(f, "# 0:automatic, otherwise number of threads converting large screens to host pixels\n");
+    fprintf(f, "%s = %s\n",     var_name[VAR_ATARI_SCREEN_VSYNC], bScreenVsync ? "YES" : "NO");
+    fprintf(f, "# YES: present the screen synchronised to the host display refresh\n");
     fprintf(f, "%s = %s\n",     var_name[VAR_HIDE_HOST_MOUSE], bHideHostMouse ? "YES" : "NO");
     fprintf(f, "%s = %s\n",     var_name[VAR_RELATIVE_MOUSE], bRelativeMouse ? "YES" : "NO");
     fprintf(f, "[SCREEN PLACEMENT]\n");
@@ -538,6 +570,15 @@ int Preferences::writePreferences(const char *cfgfile)
     fprintf(f, "%s = %s\n",     var_name[VAR_ATARI_LANGUAGE], AtariLanguage);
     fprintf(f, "%s = %s\n",     var_name[VAR_SHOW_HOST_MENU], bShowHostMenu ? "YES" : "NO");
     fprintf(f, "%s = %s\n",     var_name[VAR_ATARI_AUTOSTART], bAutoStartMagiC ? "YES" : "NO");
+    fprintf(f, "%s = %s\n",     var_name[VAR_ATARI_JIT], bJit ? "YES" : "NO");
+    fprintf(f, "%s = %u\n",     var_name[VAR_ATARI_FPU], AtariFpu);
+    fprintf(f, "# 0:none (default) 1:68882 with double precision 2:68882 with extended precision, x86 hosts only\n");
+    fprintf(f, "%s = %s\n",     var_name[VAR_ATARI_CLOCK_CATCHUP], bClockCatchUp ? "YES" : "NO");
+    fprintf(f, "# YES: deliver missed 200 Hz ticks later, NO: only correct _hz_200\n");
+    fprintf(f, "%s = %u\n",     var_name[VAR_ATARI_TICKLESS_IDLE_MS], TicklessIdleMs);
+    fprintf(f, "# 0:off, otherwise idle Atari sleeps up to this time without 200 Hz and VBL, AES timers may be late\n");
+    fprintf(f, "%s = %u\n",     var_name[VAR_ATARI_CPU_LIMIT], CpuLimit);
+    fprintf(f, "# 0:off, otherwise maximum host CPU usage of the emulator thread in percent of a core\n");
     fprintf(f, "[ADDITIONAL ATARI DRIVES]\n");
     fprintf(f, "# %s<A..T,V..Z> = flags [1:read-only, 2:8+3, 4:case-insensitive] path or image\n", var_name[VAR_ATARI_DRV_]);
     for (unsigned n = 0; n < NDRIVES; n++)
@@ -925,6 +966,14 @@ int Preferences::evaluatePreferencesLine(const char *line)
             atariScreenColourMode = (enAtariScreenColourMode) vu;
             break;
 
+        case VAR_ATARI_SCREEN_CONV_THREADS:
+            num_errors += eval_unsigned(&ScreenConvThreads, 0, ATARI_SCREEN_CONV_THREADS_MAX, &line);
+            break;
+
+        case VAR_ATARI_SCREEN_VSYNC:
+            num_errors += eval_quotated_str_bool(&bScreenVsync, &line);
+            break;
+
         case VAR_HIDE_HOST_MOUSE:
             num_errors += eval_quotated_str_bool(&bHideHostMouse, &line);
             break;
@@ -961,6 +1010,26 @@ int Preferences::evaluatePreferencesLine(const char *line)
             num_errors += eval_quotated_str_bool(&bAutoStartMagiC, &line);
             break;
 
+        case VAR_ATARI_JIT:
+            num_errors += eval_quotated_str_bool(&bJit, &line);
+            break;
+
+        case VAR_ATARI_FPU:
+            num_errors += eval_unsigned(&AtariFpu, 0, 2, &line);
+            break;
+
+        case VAR_ATARI_CLOCK_CATCHUP:
+            num_errors += eval_quotated_str_bool(&bClockCatchUp, &line);
+            break;
+
+        case VAR_ATARI_TICKLESS_IDLE_MS:
+            num_errors += eval_unsigned(&TicklessIdleMs, 0, 10000, &line);
+            break;
+
+        case VAR_ATARI_CPU_LIMIT:
+            num_errors += eval_unsigned(&CpuLimit, 0, 100, &line);
+            break;
+
         case VAR_ATARI_DRV_:
             {
                 unsigned flags;
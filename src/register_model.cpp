@@ -26,6 +26,7 @@
 #include "Debug.h"
 #include "emulation_globals.h"
 #include "MagiCScreen.h"
+#include "MagiCMfp.h"
 #include "register_model.h"
 #include <assert.h>
 
@@ -287,6 +288,7 @@ class CVideoAddress : public CRegisterModel
                 DebugWarning("    physical screen address set to 0x%08x", physaddr);
                 CMagiCScreen::m_physAddr = physaddr;
             }
+            CMagiCScreen::setAllDirty();
         }
         *p_success = true;  // never bus error, just ignore, if unhandled
     }
@@ -503,6 +505,49 @@ class CMfp : public CRegisterModel
         }
         return "";
     }
+
+    // registers are on odd addresses, a word access reaches the register in the low byte
+    virtual uint32_t read(uint32_t addr, unsigned len, bool *p_success)
+    {
+        addr -= start_addr;
+        *p_success = true;
+        if (len == 1)
+        {
+            return (addr & 1) ? CMagiCMfp::read(addr) : 0;
+        }
+        else
+        if (len == 2)
+        {
+            return CMagiCMfp::read(addr + 1);
+        }
+        else
+        {
+            return (CMagiCMfp::read(addr + 1) << 16) | CMagiCMfp::read(addr + 3);
+        }
+    }
+
+    virtual void write(uint32_t addr, unsigned len, uint32_t datum, bool *p_success)
+    {
+        addr -= start_addr;
+        *p_success = true;
+        if (len == 1)
+        {
+            if (addr & 1)
+            {
+                CMagiCMfp::write(addr, (uint8_t) datum);
+            }
+        }
+        else
+        if (len == 2)
+        {
+            CMagiCMfp::write(addr + 1, (uint8_t) datum);
+        }
+        else
+        {
+            CMagiCMfp::write(addr + 1, (uint8_t) (datum >> 16));
+            CMagiCMfp::write(addr + 3, (uint8_t) datum);
+        }
+    }
 };
 
 /** **********************************************************************************************
@@ -864,6 +864,11 @@ uint32_t CVolumeImages::AtariBlockDevice(uint32_t params, uint8_t *addrOffset68k
             }
 
             aerr = AtariRwabs(drv, flags, count, lrecno, addrOffset68k + buf);
+            if (!(flags & 1))
+            {
+                // sectors might contain code, e.g. a program that is being loaded
+                m68k_InvalidateCode(buf, count * 512);
+            }
         }
             break;
 
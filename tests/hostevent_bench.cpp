@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Benchmark: time from signalling an event to the return of the waiting thread
+*
+* Ping-pong between two threads: the main thread sets the event after a short
+* pause, the waiting thread records the time until its wait() returns and
+* hands back. The pause lets the waiting thread really go to sleep, as the
+* emulator thread does in the "idle task".
+*
+* For comparison the previous implementation of the OS_*Event() functions is
+* measured as well, i.e. flags protected by a mutex, and a second mutex with a
+* condition variable for the wakeup.
+*
+* Usage: hostevent_bench [rounds [pause_us]]
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include "HostEvent.h"
+
+#define BENCH_ROUNDS    20000
+#define BENCH_PAUSE_US  50
+
+
+// previous implementation of CMagiC::OS_SetEvent() and CMagiC::OS_WaitForEvent()
+static pthread_mutex_t oldEventMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t oldConditionMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t oldCond = PTHREAD_COND_INITIALIZER;
+static uint32_t oldEvent;
+
+static void oldSet(uint32_t flags)
+{
+    pthread_mutex_lock(&oldEventMutex);
+    oldEvent |= flags;
+    pthread_mutex_unlock(&oldEventMutex);
+
+    pthread_mutex_lock(&oldConditionMutex);
+    if (oldEvent != 0)
+    {
+        pthread_cond_signal(&oldCond);
+    }
+    pthread_mutex_unlock(&oldConditionMutex);
+}
+
+static uint32_t oldWait(void)
+{
+    uint32_t flags;
+
+    pthread_mutex_lock(&oldConditionMutex);
+    while (oldEvent == 0)
+    {
+        pthread_cond_wait(&oldCond, &oldConditionMutex);
+    }
+    pthread_mutex_unlock(&oldConditionMutex);
+
+    pthread_mutex_lock(&oldEventMutex);
+    flags = oldEvent;
+    oldEvent = 0;
+    pthread_mutex_unlock(&oldEventMutex);
+    return flags;
+}
+
+
+static CHostEvent event;
+static bool bUseHostEvent;
+static unsigned rounds = BENCH_ROUNDS;
+static std::atomic<uint64_t> setNs;
+static std::atomic<unsigned> received;
+static std::vector<uint64_t> latency;
+
+
+static void *waiter(void *param)
+{
+    (void) param;
+    for (unsigned i = 0; i < rounds; i++)
+    {
+        if (bUseHostEvent)
+        {
+            (void) event.wait();
+        }
+        else
+        {
+            (void) oldWait();
+        }
+        latency.push_back(CHostEvent::now() - setNs);
+        received = i + 1;
+    }
+    return nullptr;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Run the ping-pong and print the median and the 99th percentile
+ *
+ ************************************************************************************************/
+static void bench(const char *name, bool bHostEvent, unsigned pauseUs)
+{
+    pthread_t thread;
+
+    bUseHostEvent = bHostEvent;
+    latency.clear();
+    latency.reserve(rounds);
+    received = 0;
+    if (pthread_create(&thread, nullptr, waiter, nullptr) != 0)
+    {
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+
+    for (unsigned i = 0; i < rounds; i++)
+    {
+        struct timespec pause = { 0, (long) pauseUs * 1000 };
+        nanosleep(&pause, nullptr);
+        setNs = CHostEvent::now();
+        if (bHostEvent)
+        {
+            event.set(1);
+        }
+        else
+        {
+            oldSet(1);
+        }
+        while (received != i + 1)
+        {
+        }
+    }
+    pthread_join(thread, nullptr);
+
+    std::sort(latency.begin(), latency.end());
+    printf("%-20s median %6.2f us, p99 %6.2f us\n", name,
+            latency[rounds / 2] / 1000.0, latency[(uint64_t) rounds * 99 / 100] / 1000.0);
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned pauseUs = BENCH_PAUSE_US;
+
+    if (argc > 1)
+    {
+        rounds = (unsigned) atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        pauseUs = (unsigned) atoi(argv[2]);
+    }
+    if ((rounds == 0) || (pauseUs >= 1000000))
+    {
+        fprintf(stderr, "usage: %s [rounds [pause_us]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%u wakeups, %u us pause\n", rounds, pauseUs);
+    bench("mutex + condition", false, pauseUs);
+    bench("CHostEvent", true, pauseUs);
+
+    HostEventStats stats;
+    event.getStats(&stats);
+    printf("CHostEvent: %llu waits, %llu wakeups, avg %.2f us, max %.2f us\n",
+            (unsigned long long) stats.waits, (unsigned long long) stats.wakeups,
+            stats.wakeSumNs / 1000.0 / (stats.wakeups ? stats.wakeups : 1), stats.wakeMaxNs / 1000.0);
+    return EXIT_SUCCESS;
+}
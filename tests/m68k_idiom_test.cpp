@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Test of the copy and fill loops that the 68k core runs as a whole
+*
+* The loop is used like a memset() subroutine: a first call with a distant
+* destination lets the block cache recognise it, the second call writes
+* directly behind the code. This is in the same memory page, or in the next
+* one if the loop is at the end of a page. Both invalidate the cached loop
+* while it is running. Both calls must end
+* at the exit with the results of the single moves. The long loops are split
+* into chunks by the core.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "m68k_testenv.h"
+
+#define TEST_PAGE       0x10000     // page with the loop, 4k
+#define TEST_SRC        0x80000     // source of the copy loops
+#define TEST_WARMUP     0xa0000     // destination of the first call
+#define TEST_GUARD      16          // bytes behind the destination that must not be written
+#define TEST_FILL       0x5a5a1234  // value in d1 for the fill loops
+
+struct IdiomLoop
+{
+    const char *name;
+    uint16_t opcode;                // move or clr, followed by "dbra d0" and "jmp TESTENV_EXIT.w"
+    unsigned size;                  // operand size
+    bool bCopy;                     // source is (a1)+
+    bool bFill;                     // source is d1
+};
+
+static const IdiomLoop loops[] =
+{
+    { "clr.l (a0)+",        0x4298, 4, false, false },
+    { "clr.b (a0)+",        0x4218, 1, false, false },
+    { "move.w d1,(a0)+",    0x30c1, 2, false, true  },
+    { "move.l (a1)+,(a0)+", 0x20d9, 4, true,  false },
+    { "move.b (a1)+,(a0)+", 0x10d9, 1, true,  false },
+};
+
+static const unsigned counts[] = { 100, 5000 };
+
+
+/** **********************************************************************************************
+ *
+ * @brief Expected byte <i> of the destination
+ *
+ ************************************************************************************************/
+static uint8_t expected(const IdiomLoop &loop, unsigned i)
+{
+    if (loop.bCopy)
+    {
+        return testMem[TEST_SRC + i];
+    }
+    if (loop.bFill)
+    {
+        return (uint8_t) (TEST_FILL >> (8 * (loop.size - 1 - i % loop.size)));
+    }
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Call the loop at <code> for <count> elements at <dst>
+ *
+ * @return number of failures
+ *
+ ************************************************************************************************/
+static unsigned call(const IdiomLoop &loop, uint32_t code, uint32_t dst, unsigned count, const char *where)
+{
+    unsigned failures = 0;
+    uint32_t len = count * loop.size;
+    TestCpu cpu;
+
+    memset(testMem + dst, 0xa5, len + TEST_GUARD);
+    testenvClearCpu(&cpu);
+    cpu.d[0] = 0x77770000 | (count - 1);
+    cpu.d[1] = TEST_FILL;
+    cpu.a[0] = dst;
+    cpu.a[1] = TEST_SRC;
+    if (!testenvRun(code, &cpu) || (cpu.vector != 0))
+    {
+        printf("%s, %u elements %s: exception %u at 0x%08x\n", loop.name, count, where, cpu.vector, cpu.excPc);
+        return 1;
+    }
+
+    if ((cpu.a[0] != dst + len) || (cpu.d[0] != 0x7777ffff) || (loop.bCopy && (cpu.a[1] != TEST_SRC + len)))
+    {
+        printf("%s, %u elements %s: registers d0=0x%08x a0=0x%08x a1=0x%08x\n",
+                loop.name, count, where, cpu.d[0], cpu.a[0], cpu.a[1]);
+        failures++;
+    }
+    // condition codes of the last move or clr
+    uint8_t msb = expected(loop, len - loop.size);
+    if ((cpu.srRead & 0x0f) != (((msb & 0x80) ? 8 : 0) | ((loop.bFill || loop.bCopy) ? 0 : 4)))
+    {
+        printf("%s, %u elements %s: ccr 0x%02x\n", loop.name, count, where, cpu.srRead & 0xff);
+        failures++;
+    }
+    for (unsigned i = 0; i < len; i++)
+    {
+        if (testMem[dst + i] != expected(loop, i))
+        {
+            printf("%s, %u elements %s: wrong byte 0x%02x at offset %u\n", loop.name, count, where, testMem[dst + i], i);
+            failures++;
+            break;
+        }
+    }
+    for (unsigned i = 0; i < TEST_GUARD; i++)
+    {
+        if (testMem[dst + len + i] != 0xa5)
+        {
+            printf("%s, %u elements %s: written behind the destination\n", loop.name, count, where);
+            failures++;
+            break;
+        }
+    }
+    return failures;
+}
+
+
+int main()
+{
+    unsigned failures = 0;
+    unsigned tests = 0;
+
+    testenvInit();
+    for (unsigned i = 0; i < 0x10000; i++)
+    {
+        // all bytes non-zero, for the Z flag
+        testMem[TEST_SRC + i] = (uint8_t) ((i * 7 + 3) | 1);
+    }
+
+    for (unsigned l = 0; l < sizeof(loops) / sizeof(loops[0]); l++)
+    {
+        const IdiomLoop &loop = loops[l];
+        for (unsigned count : counts)
+        {
+            for (unsigned nextPage = 0; nextPage < 2; nextPage++)
+            {
+                // the loop at the end of the page, and "jmp" in the next one, or all in one page
+                uint32_t code = TEST_PAGE + (nextPage ? 0xffc : 0xf00);
+                uint32_t end = testenvCode(code, {
+                    loop.opcode,
+                    0x51c8, 0xfffc,                 // dbra d0,code
+                    0x4ef8, TESTENV_EXIT });        // jmp TESTENV_EXIT.w
+
+                failures += call(loop, code, TEST_WARMUP, 3, "warm-up");
+                failures += call(loop, code, end, count, nextPage ? "in the next page" : "in the same page");
+                tests++;
+            }
+        }
+    }
+
+    printf("%u loops tested, %u failures\n", tests, failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Test of translated 68k blocks and their lazily stored condition codes
+*
+* Random blocks of register instructions run in a "dbra" loop, long enough
+* to be translated (M68K_JIT), and are compared with the interpreter of the
+* debug core. Most instructions are those that are translated natively, and
+* whose condition codes may be left out (M68K_LAZY_FLAGS). In between are
+* handlers that need the condition codes:
+*   - "move sr", "scc" and "addx" read them,
+*   - "divu.w d6,Dn" divides by zero in the last iteration, the exception
+*     stacks SR,
+*   - the exit routine and m68k_get_reg() read SR after the block.
+* Some runs are stopped by a timer signal at a random point, which leaves
+* the translated block between two instructions. The registers and SR read
+* with m68k_get_reg() must then be the same as those of the interpreter
+* after the same number of instructions.
+*
+* Without M68K_JIT the test compares the block cache with the interpreter.
+*
+* Usage: m68k_jit_test [blocks]
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include "m68k_testenv.h"
+extern "C" {
+#include "m68k.h"
+}
+
+#define TEST_BLOCKS         200000  // default number of random blocks
+#define TEST_MAX_INSNS      14      // instructions per block, without the dbra
+#define TEST_ITERATIONS     60      // loop iterations, more than needed for translation
+#define TEST_STOP_EVERY     50      // every n-th block is stopped by a timer signal ...
+#define TEST_STOP_ITERATIONS 5000   // ... with this number of iterations
+#define TEST_STOP_MAX_US    200     // ... after a random time up to this
+
+static uint16_t code[TEST_MAX_INSNS + 4];
+
+
+static uint32_t rand32()
+{
+    return ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+}
+
+// d0..d5, d6 is the loop counter, d7 the destination of "move sr" and "scc"
+static unsigned reg()
+{
+    return (unsigned) rand() % 6;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Random instruction, mostly one that is translated natively
+ *
+ ************************************************************************************************/
+static uint16_t randomInsn()
+{
+    unsigned x = reg();
+    unsigned y = reg();
+    switch(rand() % 20)
+    {
+        // native
+        case 0: return (uint16_t) (0xd080 | (x << 9) | y);                  // add.l Dy,Dx
+        case 1: return (uint16_t) (0x9080 | (x << 9) | y);                  // sub.l Dy,Dx
+        case 2: return (uint16_t) (0xb080 | (x << 9) | y);                  // cmp.l Dy,Dx
+        case 3: return (uint16_t) (0x5080 | ((rand() & 7) << 9) | y);       // addq.l #q,Dy
+        case 4: return (uint16_t) (0x5180 | ((rand() & 7) << 9) | y);       // subq.l #q,Dy
+        case 5: return (uint16_t) (0x7000 | (x << 9) | (rand() & 0xff));    // moveq #i,Dx
+        case 6: return (uint16_t) (0x2000 | (x << 9) | y);                  // move.l Dy,Dx
+        case 7: return (uint16_t) (0x4a80 | y);                             // tst.l Dy
+        case 8: return (uint16_t) (0xc080 | (x << 9) | y);                  // and.l Dy,Dx
+        case 9: return (uint16_t) (0x8080 | (x << 9) | y);                  // or.l Dy,Dx
+        case 10: return (uint16_t) (0xb180 | (x << 9) | y);                 // eor.l Dx,Dy
+        case 11: return (uint16_t) (0xd080 | (x << 9) | x);                 // add.l Dx,Dx
+        case 12: return (uint16_t) (0x9080 | (x << 9) | x);                 // sub.l Dx,Dx
+        // handlers that read or write condition codes
+        case 13: return 0x40c7;                                             // move.w sr,d7
+        case 14: return (uint16_t) (0x50c7 | ((rand() & 15) << 8));         // scc d7
+        case 15: return (uint16_t) (0xd180 | (x << 9) | y);                 // addx.l Dy,Dx
+        case 16: return (uint16_t) (0x4080 | y);                            // negx.l Dy
+        case 17: return (uint16_t) (0xd040 | (x << 9) | y);                 // add.w Dy,Dx
+        case 18: return 0x44c7;                                             // move.w d7,ccr
+        default: return (uint16_t) (0x80c6 | (x << 9));                     // divu.w d6,Dx
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Write a random block and the loop around it
+ *
+ ************************************************************************************************/
+static void randomBlock()
+{
+    unsigned n = 1 + (unsigned) rand() % TEST_MAX_INSNS;
+    for (unsigned i = 0; i < n; i++)
+    {
+        code[i] = randomInsn();
+    }
+    code[n] = 0x51ce;                               // dbra d6,TESTENV_CODE
+    code[n + 1] = (uint16_t) -(2 * n + 2);
+    code[n + 2] = 0x4ef8;                           // jmp TESTENV_EXIT.w
+    code[n + 3] = TESTENV_EXIT;
+    (void) testenvCode(TESTENV_CODE, code, n + 4);
+}
+
+
+static void randomCpu(TestCpu *cpu, unsigned iterations)
+{
+    static const uint32_t special[] = { 0, 1, 0x7fffffff, 0x80000000, 0xffffffff };
+
+    testenvClearCpu(cpu);
+    for (unsigned i = 0; i < 8; i++)
+    {
+        cpu->d[i] = (rand() & 3) ? rand32() : special[rand() % 5];
+    }
+    cpu->d[6] = iterations - 1;
+    cpu->sr = (uint16_t) (0x2700 | (rand() & 0x1f));
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Compare the results of the interpreter and of the production core
+ *
+ * @return number of failures
+ *
+ ************************************************************************************************/
+static unsigned compare(const char *what, unsigned block, const TestCpu &ref, const TestCpu &cpu)
+{
+    bool bSame = (ref.vector == cpu.vector) && !memcmp(ref.d, cpu.d, sizeof(ref.d)) &&
+                 !memcmp(ref.a, cpu.a, sizeof(ref.a)) && (ref.sr == cpu.sr);
+    if (ref.vector == 0)
+    {
+        bSame = bSame && (ref.srRead == cpu.srRead);
+    }
+    else
+    if (ref.vector == TESTENV_NO_EXIT)
+    {
+        bSame = bSame && (ref.pc == cpu.pc);
+    }
+    else
+    {
+        bSame = bSame && (ref.excPc == cpu.excPc);
+    }
+    if (bSame)
+    {
+        return 0;
+    }
+
+    printf("block %u, %s after %llu instructions:", block, what, (unsigned long long) cpu.insns);
+    for (unsigned i = 0; (i < TEST_MAX_INSNS + 4) && (code[i] != 0x51ce); i++)
+    {
+        printf(" %04x", code[i]);
+    }
+    printf("\n");
+    printf("  interpreter: vector %u, sr %04x read %04x, pc %08x,", ref.vector, ref.sr, ref.srRead, ref.pc);
+    for (unsigned i = 0; i < 8; i++)
+    {
+        printf(" %08x", ref.d[i]);
+    }
+    printf("\n  translated:  vector %u, sr %04x read %04x, pc %08x,", cpu.vector, cpu.sr, cpu.srRead, cpu.pc);
+    for (unsigned i = 0; i < 8; i++)
+    {
+        printf(" %08x", cpu.d[i]);
+    }
+    printf("\n");
+    return 1;
+}
+
+
+// stop the 68k core asynchronously, as an interrupt does
+static void sigStop(int sig)
+{
+    (void) sig;
+    m68k_StopExecution();
+}
+
+static void setTimer(unsigned us)
+{
+    struct itimerval t;
+    memset(&t, 0, sizeof(t));
+    t.it_value.tv_usec = us;
+    (void) setitimer(ITIMER_REAL, &t, nullptr);
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned blocks = (argc > 1) ? (unsigned) atoi(argv[1]) : TEST_BLOCKS;
+    unsigned failures = 0;
+    unsigned exceptions = 0;
+    unsigned stopped = 0;
+
+    struct sigaction sa;
+
+    srand(4711);
+    testenvInit();
+    m68k_SetJit(1);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigStop;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, nullptr);
+
+    for (unsigned block = 0; (block < blocks) && (failures < 10); block++)
+    {
+        bool bStop = (block % TEST_STOP_EVERY) == 0;
+        TestCpu in, ref, cpu;
+
+        randomBlock();
+        randomCpu(&in, bStop ? TEST_STOP_ITERATIONS : TEST_ITERATIONS);
+
+        cpu = in;
+        m68k_SetDebugCore(0);
+        if (bStop)
+        {
+            setTimer(1 + (unsigned) rand() % TEST_STOP_MAX_US);
+        }
+        (void) testenvRun(TESTENV_CODE, &cpu);
+        // a late stop request is discarded by the next run
+        setTimer(0);
+
+        // the interpreter, stopped after the same number of instructions, if necessary
+        ref = in;
+        if ((cpu.vector == TESTENV_NO_EXIT) && (cpu.insns == 0))
+        {
+            // stopped before the first instruction, nothing to run
+            ref.vector = TESTENV_NO_EXIT;
+            ref.pc = TESTENV_CODE;
+        }
+        else
+        {
+            m68k_SetDebugCore(1);
+            (void) testenvRun(TESTENV_CODE, &ref, (cpu.vector == TESTENV_NO_EXIT) ? cpu.insns : 0);
+        }
+
+        if (cpu.vector == TESTENV_NO_EXIT)
+        {
+            stopped++;
+            failures += compare("stopped", block, ref, cpu);
+        }
+        else
+        {
+            exceptions += (cpu.vector != 0);
+            failures += compare("finished", block, ref, cpu);
+        }
+    }
+
+    printf("%u blocks tested, %u ended with an exception, %u stopped in between, %u failures\n",
+            blocks, exceptions, stopped, failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,498 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Test of MULU.L/MULS.L, DIVU.L/DIVS.L and BFFFO
+*
+* The 68k core computes these with host 64-bit arithmetic and clz
+* (M68K_USE_64_BIT). The reference here is the previous implementation
+* with 32-bit shift-and-add loops and a bit loop for BFFFO, i.e. the code
+* in the "#else" branches of m68kopdm.c. Random and edge case operands
+* must give the same registers, condition codes and exceptions.
+*
+* The intended differences, where the reference is corrected: the old code
+* flagged a DIVS.L quotient of exactly -2^31 from a 64-bit dividend as
+* overflow, although it fits into 32 bits. And "divs.l #-1,Dn" with Dn =
+* 0x80000000 stored the remainder 0 instead of the quotient. The edge cases
+* below check the exact results.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "m68k_testenv.h"
+extern "C" {
+#include "m68k.h"
+}
+
+#define TEST_RANDOM     100000      // random cases per instruction
+#define TEST_DATA       0x8000      // memory operand of BFFFO
+#define TEST_DATA_LEN   64
+
+#define CCR_X   0x10
+#define CCR_N   0x08
+#define CCR_Z   0x04
+#define CCR_V   0x02
+#define CCR_C   0x01
+
+#define EXCEPTION_ZERO_DIVIDE   5
+
+struct TestCase
+{
+    uint16_t opcode;
+    uint16_t word2;
+    uint32_t d[8];
+    uint8_t ccr;
+};
+
+
+static uint32_t rand32()
+{
+    return ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+}
+
+// random operand, often one that is special for multiplication or division
+static uint32_t randOperand()
+{
+    static const uint32_t special[] = { 0, 1, 2, 3, 0xffffffff, 0xfffffffe, 0x80000000, 0x80000001, 0x7fffffff, 0x10000, 0xffff };
+
+    switch(rand() & 7)
+    {
+        case 0:
+        case 1:
+            return special[rand() % (sizeof(special) / sizeof(special[0]))];
+        case 2:
+            return (uint32_t) (rand() & 0xfff);
+        case 3:
+            return (uint32_t) -(rand() & 0xfff);
+        default:
+            return rand32();
+    }
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Previous MULU.L/MULS.L <d2>,... (m68k_op_mull_32_d() without M68K_USE_64_BIT)
+ *
+ ************************************************************************************************/
+static unsigned refMull(TestCase *t)
+{
+    uint32_t word2 = t->word2;
+    uint32_t src = t->d[2];
+    uint32_t dst = t->d[(word2 >> 12) & 7];
+    uint32_t neg = (src ^ dst) & 0x80000000;
+    bool bSigned = (word2 & 0x0800) != 0;
+
+    t->ccr &= ~CCR_C;
+    if (bSigned)
+    {
+        if (src & 0x80000000)
+            src = -src;
+        if (dst & 0x80000000)
+            dst = -dst;
+    }
+
+    uint32_t src1 = src & 0xffff;
+    uint32_t src2 = src >> 16;
+    uint32_t dst1 = dst & 0xffff;
+    uint32_t dst2 = dst >> 16;
+    uint32_t r1 = src1 * dst1;
+    uint32_t r2 = src1 * dst2;
+    uint32_t r3 = src2 * dst1;
+    uint32_t r4 = src2 * dst2;
+    uint32_t lo = r1 + ((r2 & 0xffff) << 16) + ((r3 & 0xffff) << 16);
+    uint32_t hi = r4 + (r2 >> 16) + (r3 >> 16) + (((r1 >> 16) + (r2 & 0xffff) + (r3 & 0xffff)) >> 16);
+
+    if (bSigned && neg)
+    {
+        hi = -hi - (lo != 0);
+        lo = -lo;
+    }
+
+    t->ccr &= ~(CCR_N | CCR_Z | CCR_V);
+    if (word2 & 0x0400)
+    {
+        t->d[word2 & 7] = hi;
+        t->d[(word2 >> 12) & 7] = lo;
+        t->ccr |= ((hi & 0x80000000) ? CCR_N : 0) | (((hi | lo) == 0) ? CCR_Z : 0);
+        return 0;
+    }
+
+    t->d[(word2 >> 12) & 7] = lo;
+    t->ccr |= ((lo & 0x80000000) ? CCR_N : 0) | ((lo == 0) ? CCR_Z : 0);
+    if (bSigned)
+    {
+        t->ccr |= !(((lo & 0x80000000) && (hi == 0xffffffff)) || (!(lo & 0x80000000) && !hi)) ? CCR_V : 0;
+    }
+    else
+    {
+        t->ccr |= (hi != 0) ? CCR_V : 0;
+    }
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Previous DIVU.L/DIVS.L <d2>,... (m68k_op_divl_32_d() without M68K_USE_64_BIT)
+ *
+ * @return exception vector, or 0
+ *
+ ************************************************************************************************/
+static unsigned refDivl(TestCase *t)
+{
+    uint32_t word2 = t->word2;
+    uint32_t divisor = t->d[2];
+    uint32_t dividend_hi = t->d[word2 & 7];
+    uint32_t dividend_lo = t->d[(word2 >> 12) & 7];
+    uint32_t quotient = 0;
+    uint32_t remainder = 0;
+    bool dividend_neg = false;
+    bool divisor_neg = false;
+    bool bSigned = (word2 & 0x0800) != 0;
+
+    if (divisor == 0)
+    {
+        return EXCEPTION_ZERO_DIVIDE;
+    }
+
+    if (word2 & 0x0400)
+    {
+        // quad / long : long quotient, long remainder
+        if (bSigned)
+        {
+            if ((dividend_hi == 0) && (dividend_lo == 0x80000000) && (divisor == 0xffffffff))
+            {
+                t->d[word2 & 7] = 0;
+                t->d[(word2 >> 12) & 7] = 0x80000000;
+                t->ccr = (t->ccr & CCR_X) | CCR_N;
+                return 0;
+            }
+            if (dividend_hi & 0x80000000)
+            {
+                dividend_neg = true;
+                dividend_hi = -dividend_hi - (dividend_lo != 0);
+                dividend_lo = -dividend_lo;
+            }
+            if (divisor & 0x80000000)
+            {
+                divisor_neg = true;
+                divisor = -divisor;
+            }
+        }
+
+        // if the upper long is greater than the divisor, we're overflowing
+        if (dividend_hi >= divisor)
+        {
+            t->ccr |= CCR_V;
+            return 0;
+        }
+
+        for (int i = 31; i >= 0; i--)
+        {
+            quotient <<= 1;
+            remainder = (remainder << 1) + ((dividend_hi >> i) & 1);
+            if (remainder >= divisor)
+            {
+                remainder -= divisor;
+                quotient++;
+            }
+        }
+        for (int i = 31; i >= 0; i--)
+        {
+            quotient <<= 1;
+            uint32_t overflow = remainder & 0x80000000;
+            remainder = (remainder << 1) + ((dividend_lo >> i) & 1);
+            if ((remainder >= divisor) || overflow)
+            {
+                remainder -= divisor;
+                quotient++;
+            }
+        }
+
+        if (bSigned)
+        {
+            // corrected: a negative quotient may be -2^31
+            if (quotient > 0x7fffffffU + (dividend_neg != divisor_neg))
+            {
+                t->ccr |= CCR_V;
+                return 0;
+            }
+            if (dividend_neg)
+            {
+                remainder = -remainder;
+                quotient = -quotient;
+            }
+            if (divisor_neg)
+            {
+                quotient = -quotient;
+            }
+        }
+
+        t->d[word2 & 7] = remainder;
+        t->d[(word2 >> 12) & 7] = quotient;
+        t->ccr = (t->ccr & CCR_X) | ((quotient & 0x80000000) ? CCR_N : 0) | ((quotient == 0) ? CCR_Z : 0);
+        return 0;
+    }
+
+    // long / long: long quotient, maybe long remainder
+    if (bSigned)
+    {
+        if ((dividend_lo == 0x80000000) && (divisor == 0xffffffff))
+        {
+            // corrected: the quotient wins, if it uses the same register as the remainder
+            t->d[word2 & 7] = 0;
+            t->d[(word2 >> 12) & 7] = 0x80000000;
+            t->ccr = (t->ccr & CCR_X) | CCR_N;
+            return 0;
+        }
+        t->d[word2 & 7] = (uint32_t) ((int32_t) dividend_lo % (int32_t) divisor);
+        quotient = t->d[(word2 >> 12) & 7] = (uint32_t) ((int32_t) dividend_lo / (int32_t) divisor);
+    }
+    else
+    {
+        t->d[word2 & 7] = dividend_lo % divisor;
+        quotient = t->d[(word2 >> 12) & 7] = dividend_lo / divisor;
+    }
+    t->ccr = (t->ccr & CCR_X) | ((quotient & 0x80000000) ? CCR_N : 0) | ((quotient == 0) ? CCR_Z : 0);
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Previous BFFFO d3{..},.. or (a0){..},.. with the bit loop
+ *
+ ************************************************************************************************/
+static unsigned refBfffo(TestCase *t)
+{
+    uint32_t word2 = t->word2;
+    int32_t offset = (word2 >> 6) & 31;
+    uint32_t width = word2;
+    uint32_t data;
+
+    if (word2 & 0x0800)
+        offset = (int32_t) t->d[offset & 7];
+    if (word2 & 0x0020)
+        width = t->d[width & 7];
+    width = ((width - 1) & 31) + 1;
+
+    if ((t->opcode & 0x38) == 0)
+    {
+        offset &= 31;
+        data = t->d[3];
+        data = (offset != 0) ? ((data << offset) | (data >> (32 - offset))) : data;
+    }
+    else
+    {
+        uint32_t ea = TEST_DATA + TEST_DATA_LEN / 2 + offset / 8;     // a0
+        int32_t local_offset = offset % 8;
+        if (local_offset < 0)
+        {
+            local_offset += 8;
+            ea--;
+        }
+        data = testenvPeek32(ea) << local_offset;
+        if (local_offset + width > 32)
+        {
+            data |= (uint32_t) (testMem[ea + 4] << local_offset) >> 8;
+        }
+    }
+
+    t->ccr = (t->ccr & CCR_X) | ((data & 0x80000000) ? CCR_N : 0);
+    data >>= 32 - width;
+    t->ccr |= (data == 0) ? CCR_Z : 0;
+
+    for (uint32_t bit = 1U << (width - 1); bit && !(data & bit); bit >>= 1)
+        offset++;
+
+    t->d[(word2 >> 12) & 7] = (uint32_t) offset;
+    return 0;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Run one instruction in the core, and compare with the expected result
+ *
+ * @return number of failures
+ *
+ ************************************************************************************************/
+static unsigned check(const char *name, const TestCase &in, const TestCase &expected, unsigned vector)
+{
+    TestCpu cpu;
+
+    (void) testenvCode(TESTENV_CODE, { in.opcode, in.word2, 0x4ef8, TESTENV_EXIT });  // jmp TESTENV_EXIT.w
+    testenvClearCpu(&cpu);
+    memcpy(cpu.d, in.d, sizeof(cpu.d));
+    cpu.a[0] = TEST_DATA + TEST_DATA_LEN / 2;
+    cpu.sr = 0x2700 | in.ccr;
+    if (!testenvRun(TESTENV_CODE, &cpu))
+    {
+        printf("%s: did not finish\n", name);
+        return 1;
+    }
+
+    uint8_t ccr = (uint8_t) (((cpu.vector == 0) ? cpu.srRead : cpu.sr) & 0x1f);
+    if ((cpu.vector != vector) || (ccr != expected.ccr) || memcmp(cpu.d, expected.d, sizeof(cpu.d)))
+    {
+        printf("%s %04x %04x, ccr %02x, d0-d4 %08x %08x %08x %08x %08x:\n", name,
+                in.opcode, in.word2, in.ccr, in.d[0], in.d[1], in.d[2], in.d[3], in.d[4]);
+        printf("  expected vector %u, ccr %02x, d0 %08x d1 %08x\n", vector, expected.ccr, expected.d[0], expected.d[1]);
+        printf("  got      vector %u, ccr %02x, d0 %08x d1 %08x\n", cpu.vector, ccr, cpu.d[0], cpu.d[1]);
+        return 1;
+    }
+    return 0;
+}
+
+
+// compare with the reference
+static unsigned checkRef(const char *name, const TestCase &in, unsigned (*ref)(TestCase *))
+{
+    TestCase expected = in;
+    unsigned vector = ref(&expected);
+    return check(name, in, expected, vector);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Edge cases with known results
+ *
+ * @return number of failures
+ *
+ ************************************************************************************************/
+static unsigned testEdgeCases()
+{
+    struct Edge
+    {
+        const char *name;
+        uint16_t opcode;
+        uint16_t word2;             // d0: quotient or low part, d1: remainder or high part
+        uint32_t d1, d0, d2;        // operands, d1:d0 / d2, or d0 * d2
+        uint32_t r1, r0;            // results
+        uint8_t ccr;
+        unsigned vector;
+    };
+    static const Edge edges[] =
+    {
+        // quotient -2^31 fits into 32 bits, the previous code set V
+        { "divs.l -2^31/1",         0x4c42, 0x0c01, 0xffffffff, 0x80000000, 1,          0,          0x80000000, CCR_N, 0 },
+        { "divs.l 2^32/-2",         0x4c42, 0x0c01, 0x00000001, 0x00000000, 0xfffffffe, 0,          0x80000000, CCR_N, 0 },
+        { "divs.l 2^31/-1",         0x4c42, 0x0c01, 0x00000000, 0x80000000, 0xffffffff, 0,          0x80000000, CCR_N, 0 },
+        // the host would trap, the 68k sets V and leaves the registers unchanged
+        { "divs.l -2^63/-1",        0x4c42, 0x0c01, 0x80000000, 0x00000000, 0xffffffff, 0x80000000, 0x00000000, CCR_V, 0 },
+        { "divs.l -2^63/1",         0x4c42, 0x0c01, 0x80000000, 0x00000000, 1,          0x80000000, 0x00000000, CCR_V, 0 },
+        { "divs.l 2^31/1",          0x4c42, 0x0c01, 0x00000000, 0x80000000, 1,          0x00000000, 0x80000000, CCR_V, 0 },
+        { "divsl.l -2^31/-1",       0x4c42, 0x0801, 0x12345678, 0x80000000, 0xffffffff, 0,          0x80000000, CCR_N, 0 },
+        { "divs.l -2^31/-1",        0x4c42, 0x0800, 0x12345678, 0x80000000, 0xffffffff, 0x12345678, 0x80000000, CCR_N, 0 },
+        { "divu.l 2^32/1",          0x4c42, 0x0401, 0x00000001, 0x00000000, 1,          0x00000001, 0x00000000, CCR_V, 0 },
+        { "divu.l 0xffffffff/0",    0x4c42, 0x0001, 0x12345678, 0xffffffff, 0,          0x12345678, 0xffffffff, 0, EXCEPTION_ZERO_DIVIDE },
+        { "muls.l -2^31*-1 (32)",   0x4c02, 0x0801, 0x12345678, 0x80000000, 0xffffffff, 0x12345678, 0x80000000, CCR_N | CCR_V, 0 },
+        { "muls.l -2^31*-1",        0x4c02, 0x0c01, 0x12345678, 0x80000000, 0xffffffff, 0x00000000, 0x80000000, 0, 0 },
+        { "mulu.l max*max",         0x4c02, 0x0401, 0x12345678, 0xffffffff, 0xffffffff, 0xfffffffe, 0x00000001, CCR_N, 0 },
+    };
+
+    unsigned failures = 0;
+    for (const Edge &e : edges)
+    {
+        TestCase in, expected;
+        memset(&in, 0, sizeof(in));
+        in.opcode = e.opcode;
+        in.word2 = e.word2;
+        in.d[0] = e.d0;
+        in.d[1] = e.d1;
+        in.d[2] = e.d2;
+        expected = in;
+        expected.d[0] = e.r0;
+        expected.d[1] = e.r1;
+        expected.ccr = e.ccr;
+        failures += check(e.name, in, expected, e.vector);
+        failures += checkRef(e.name, in, (e.opcode == 0x4c02) ? refMull : refDivl);
+    }
+    return failures;
+}
+
+
+int main()
+{
+    unsigned failures = 0;
+    unsigned tests = 0;
+
+    srand(4711);
+    testenvInit();
+    // the interpreter, there is no need to cache the code that changes for each instruction
+    m68k_SetDebugCore(1);
+    failures += testEdgeCases();
+
+    for (unsigned i = 0; (i < TEST_RANDOM) && (failures < 10); i++, tests += 4)
+    {
+        TestCase t;
+        memset(&t, 0, sizeof(t));
+        for (uint32_t &d : t.d)
+        {
+            d = rand32();
+        }
+        t.ccr = (uint8_t) (rand() & 0x1f);
+
+        // muls.l/mulu.l d2,d0 or d2,d1:d0, in 32-bit form the high part register is ignored
+        t.opcode = 0x4c02;
+        t.word2 = (uint16_t) ((rand() & 0x0c00) | (rand() & 1));
+        t.d[0] = randOperand();
+        t.d[2] = randOperand();
+        failures += checkRef("mul.l", t, refMull);
+
+        // divs.l/divu.l d2,d0 or d2,d1:d0, in 32-bit form "divsl.l d2,d1:d0" or "divs.l d2,d0"
+        // the high part of the dividend is often small enough for the quotient to fit
+        t.opcode = 0x4c42;
+        t.d[0] = randOperand();
+        t.d[2] = randOperand();
+        switch(rand() % 3)
+        {
+            case 0: t.d[1] = randOperand(); break;
+            case 1: t.d[1] = (t.d[0] & 0x80000000) ? 0xffffffff : 0; break;
+            default: t.d[1] = rand32() % ((t.d[2] & 0x7fffffff) | 1); break;
+        }
+        failures += checkRef("div.l", t, refDivl);
+
+        // bfffo d3{offset:width},d0 and bfffo (a0){offset:width},d0, offset and width immediate or in d4 and d5
+        unsigned bOffsetReg = rand() & 1;
+        unsigned bWidthReg = rand() & 1;
+        t.word2 = (uint16_t) ((bOffsetReg << 11) | ((bOffsetReg ? 4 : (rand() & 31)) << 6) |
+                              (bWidthReg << 5) | (bWidthReg ? 5 : (rand() & 31)));
+        t.d[3] = (rand() & 1) ? rand32() : (rand32() >> (rand() & 31));
+        t.d[5] = (rand() & 3) ? (uint32_t) (rand() & 63) : rand32();
+        t.d[4] = rand32();
+        t.opcode = 0xedc3;
+        failures += checkRef("bfffo d3", t, refBfffo);
+
+        for (unsigned j = 0; j < TEST_DATA_LEN; j++)
+        {
+            testMem[TEST_DATA + j] = (uint8_t) ((rand() & 1) ? 0 : rand());
+        }
+        t.d[4] = (uint32_t) ((rand() % 160) - 96);
+        t.opcode = 0xedd0;
+        failures += checkRef("bfffo (a0)", t, refBfffo);
+    }
+
+    printf("%u instructions tested, %u failures\n", tests, failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Environment for tests of the 68k emulator core
+*
+* Replaces the memory access functions (mem_access_68k.cpp) and the globals
+* of the emulator that the core refers to. The memory layout:
+*
+*   0x000   exception vectors, all pointing to the exception exit
+*   0x400   regular exit: saves SR as read by the 68k code, then host call
+*   0x420   exception exit: host call, the frame is evaluated by the host
+*   0x480   SR saved by the regular exit
+*   0x490   host call descriptors, i.e. indices into jump_table[]
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "m68k_testenv.h"
+#include "emulation_globals.h"
+extern "C" {
+#include "m68k.h"
+}
+
+#define TESTENV_EXC         0x420
+#define TESTENV_SAVED_SR    0x480
+#define TESTENV_DESC_EXIT   0x490
+#define TESTENV_DESC_EXC    0x494
+#define TESTENV_BUDGET      100000      // instructions between checks for a hanging test
+#define TESTENV_MAX_POLLS   1000        // ... and the number of checks before giving up
+
+alignas(16) static uint8_t sMem[TESTENV_MEMSIZE];
+uint8_t *testMem = sMem;
+static TestCpu *sCpu;                   // registers of the running test
+static unsigned sPolls;
+static uint64_t sStartInsns;            // m68k_GetInsnCount() at the start of the run
+static uint64_t sMaxInsns;              // stop after this number of instructions, 0: no limit
+static bool sBadAccess;
+
+
+// globals of the emulator, used by the core
+uint8_t *mem68k;
+uint32_t mem68kSize;
+uint32_t addrOsRomStart;
+uint32_t addrOsRomEnd;
+uint32_t m68k_breakpoints[M68K_BREAKPOINTS][2];
+
+extern "C" {
+void *jump_table[256];
+void *self_table[32];
+
+void print_app(uint32_t addr68k)
+{
+    (void) addr68k;
+}
+
+void int68k_enable(int enable)
+{
+    (void) enable;
+}
+}
+
+
+uint16_t testenvPeek16(uint32_t addr)
+{
+    return (uint16_t) ((testMem[addr] << 8) | testMem[addr + 1]);
+}
+
+uint32_t testenvPeek32(uint32_t addr)
+{
+    return ((uint32_t) testenvPeek16(addr) << 16) | testenvPeek16(addr + 2);
+}
+
+void testenvPoke16(uint32_t addr, uint16_t value)
+{
+    testMem[addr] = (uint8_t) (value >> 8);
+    testMem[addr + 1] = (uint8_t) value;
+}
+
+void testenvPoke32(uint32_t addr, uint32_t value)
+{
+    testenvPoke16(addr, (uint16_t) (value >> 16));
+    testenvPoke16(addr + 2, (uint16_t) value);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Check a memory access, remember it if it is outside of the test memory
+ *
+ ************************************************************************************************/
+static bool validAccess(uint32_t addr, uint32_t len)
+{
+    if ((addr >= TESTENV_MEMSIZE) || (len > TESTENV_MEMSIZE - addr))
+    {
+        sBadAccess = true;
+        return false;
+    }
+    return true;
+}
+
+
+// remove cached 68k opcodes, like INVALIDATE_CODE in mem_access_68k.cpp
+static void invalidateCode(uint32_t addr, uint32_t len)
+{
+    if (sCodePages[addr >> M68K_CODE_PAGE_SHIFT] || sCodePages[(addr + len - 1) >> M68K_CODE_PAGE_SHIFT])
+    {
+        m68k_InvalidateCode(addr, len);
+    }
+}
+
+
+extern "C" {
+
+unsigned int m68k_read_memory_8(unsigned int address)
+{
+    return validAccess(address, 1) ? testMem[address] : 0;
+}
+
+unsigned int m68k_read_memory_16(unsigned int address)
+{
+    return validAccess(address, 2) ? testenvPeek16(address) : 0;
+}
+
+unsigned int m68k_read_memory_32(unsigned int address)
+{
+    return validAccess(address, 4) ? testenvPeek32(address) : 0;
+}
+
+void m68k_write_memory_8(unsigned int address, unsigned int value)
+{
+    if (validAccess(address, 1))
+    {
+        testMem[address] = (uint8_t) value;
+        invalidateCode(address, 1);
+    }
+}
+
+void m68k_write_memory_16(unsigned int address, unsigned int value)
+{
+    if (validAccess(address, 2))
+    {
+        testenvPoke16(address, (uint16_t) value);
+        invalidateCode(address, 2);
+    }
+}
+
+void m68k_write_memory_32(unsigned int address, unsigned int value)
+{
+    if (validAccess(address, 4))
+    {
+        testenvPoke32(address, value);
+        invalidateCode(address, 4);
+    }
+}
+
+// same contract as in mem_access_68k.cpp, but for regular memory only
+int m68k_copy_memory(unsigned int dst, unsigned int src, unsigned int size, unsigned int count)
+{
+    uint32_t len = size * count;
+    if (((dst > src) && (dst - src < len)) || !validAccess(src, len) || !validAccess(dst, len))
+    {
+        return 0;
+    }
+    memmove(testMem + dst, testMem + src, len);
+    m68k_InvalidateCode(dst, len);
+    return 1;
+}
+
+int m68k_fill_memory(unsigned int dst, unsigned int value, unsigned int size, unsigned int count)
+{
+    uint32_t len = size * count;
+    if (!validAccess(dst, len))
+    {
+        return 0;
+    }
+    for (uint32_t i = 0; i < len; i += size)
+    {
+        if (size == 1)
+        {
+            testMem[dst + i] = (uint8_t) value;
+        }
+        else
+        if (size == 2)
+        {
+            testenvPoke16(dst + i, (uint16_t) value);
+        }
+        else
+        {
+            testenvPoke32(dst + i, value);
+        }
+    }
+    m68k_InvalidateCode(dst, len);
+    return 1;
+}
+
+unsigned char *m68k_host_memory(unsigned int address, unsigned int len, int write)
+{
+    if (!validAccess(address, len))
+    {
+        return nullptr;
+    }
+    if (write)
+    {
+        invalidateCode(address, len);
+    }
+    return testMem + address;
+}
+
+} // end extern "C"
+
+
+/** **********************************************************************************************
+ *
+ * @brief Host call of the exits, restores a0 and d0 and leaves m68k_execute()
+ *
+ * @param[in] bException    false: regular exit, true: exception exit
+ *
+ * @return d0, as it was before the host call
+ *
+ ************************************************************************************************/
+static unsigned leave(bool bException)
+{
+    uint32_t sp = m68k_get_reg(nullptr, M68K_REG_SP);
+
+    // a0 was pushed by the exit routine
+    m68k_set_reg(M68K_REG_A0, testenvPeek32(sp));
+    sp += 4;
+    if (bException)
+    {
+        // 68020 stack frame: sr, pc, format and vector offset, for format 2 the instruction address
+        sCpu->sr = testenvPeek16(sp);
+        sCpu->excPc = testenvPeek32(sp + 2);
+        uint16_t format = testenvPeek16(sp + 6);
+        sCpu->vector = (format & 0xfff) >> 2;
+        sp += ((format >> 12) == 2) ? 12 : 8;
+    }
+    else
+    {
+        sCpu->sr = (uint16_t) m68k_get_reg(nullptr, M68K_REG_SR);
+        sCpu->srRead = testenvPeek16(TESTENV_SAVED_SR);
+        sCpu->vector = 0;
+    }
+    m68k_set_reg(M68K_REG_SP, sp);
+
+    for (unsigned i = 0; i < 8; i++)
+    {
+        sCpu->d[i] = m68k_get_reg(nullptr, (m68k_register_t) (M68K_REG_D0 + i));
+        sCpu->a[i] = m68k_get_reg(nullptr, (m68k_register_t) (M68K_REG_A0 + i));
+    }
+    m68k_StopExecution();
+    return sCpu->d[0];
+}
+
+static unsigned exitProc(unsigned a1, unsigned char *emubase)
+{
+    (void) a1;
+    (void) emubase;
+    return leave(false);
+}
+
+static unsigned excProc(unsigned a1, unsigned char *emubase)
+{
+    (void) a1;
+    (void) emubase;
+    return leave(true);
+}
+
+
+// budget expired: instruction limit reached, or the test hangs, if this happens too often
+static void pollProc()
+{
+    uint64_t insns = m68k_GetInsnCount() - sStartInsns;
+    if ((sMaxInsns != 0) && (insns >= sMaxInsns))
+    {
+        m68k_StopExecution();
+        return;
+    }
+    if (++sPolls >= TESTENV_MAX_POLLS)
+    {
+        m68k_StopExecution();
+    }
+    m68k_SetEventBudget(((sMaxInsns != 0) && (sMaxInsns - insns < TESTENV_BUDGET)) ? (unsigned) (sMaxInsns - insns) : TESTENV_BUDGET);
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Write 68k code, and remove it from the cache of the core
+ *
+ * @return address behind the code
+ *
+ ************************************************************************************************/
+uint32_t testenvCode(uint32_t addr, const uint16_t *words, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        testenvPoke16(addr + 2 * i, words[i]);
+    }
+    m68k_InvalidateCode(addr, 2 * n);
+    return addr + 2 * n;
+}
+
+uint32_t testenvCode(uint32_t addr, std::initializer_list<uint16_t> words)
+{
+    return testenvCode(addr, words.begin(), (unsigned) words.size());
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Set up memory and a 68020 core, without FPU and JIT
+ *
+ ************************************************************************************************/
+void testenvInit()
+{
+    mem68k = testMem;
+    mem68kSize = TESTENV_MEMSIZE;
+    jump_table[0] = reinterpret_cast<void *>(exitProc);
+    jump_table[1] = reinterpret_cast<void *>(excProc);
+    // indices in host byte order, see m68k_op_call_emu_proc()
+    uint32_t index = 0;
+    memcpy(testMem + TESTENV_DESC_EXIT, &index, 4);
+    index = 1;
+    memcpy(testMem + TESTENV_DESC_EXC, &index, 4);
+
+    testenvPoke32(0, TESTENV_STACK);
+    testenvPoke32(4, TESTENV_CODE);
+    for (uint32_t v = 2; v < 256; v++)
+    {
+        testenvPoke32(v * 4, TESTENV_EXC);
+    }
+    // flags are not changed before the host call
+    (void) testenvCode(TESTENV_EXIT, {
+        0x40f8, TESTENV_SAVED_SR,       // move.w sr,TESTENV_SAVED_SR.w
+        0x4850,                         // pea (a0)
+        0x41f8, TESTENV_DESC_EXIT,      // lea TESTENV_DESC_EXIT.w,a0
+        0x00c0,                         // host call
+        0x60fe });                      // bra.s *
+    (void) testenvCode(TESTENV_EXC, {
+        0x4850,                         // pea (a0)
+        0x41f8, TESTENV_DESC_EXC,       // lea TESTENV_DESC_EXC.w,a0
+        0x00c0,                         // host call
+        0x60fe });                      // bra.s *
+
+    m68k_set_cpu_type(M68K_CPU_TYPE_68020);
+    m68k_init();
+    m68k_SetBaseAddr(mem68k);
+    m68k_SetHiMem(mem68kSize);
+    m68k_SetFpu(M68K_FPU_NONE);
+    m68k_SetEventCallback(pollProc);
+    m68k_pulse_reset();
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Registers for a run: all zero, supervisor mode, interrupts disabled
+ *
+ ************************************************************************************************/
+void testenvClearCpu(TestCpu *cpu)
+{
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->a[7] = TESTENV_STACK;
+    cpu->sr = 0x2700;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Run code until it reaches one of the exits
+ *
+ * @param[in]     pc        start address
+ * @param[in,out] cpu       registers before and after the run
+ * @param[in]     maxInsns  stop after this number of instructions, 0: no limit
+ *
+ * @return false: the code did not reach an exit, e.g. was stopped by m68k_StopExecution()
+ *         from another thread, or accessed memory outside of the test memory
+ *
+ * @note If no exit was reached, the registers are those of m68k_get_reg(), and vector
+ *       is TESTENV_NO_EXIT.
+ *
+ ************************************************************************************************/
+bool testenvRun(uint32_t pc, TestCpu *cpu, uint64_t maxInsns)
+{
+    sCpu = cpu;
+    sPolls = 0;
+    sMaxInsns = maxInsns;
+    sBadAccess = false;
+    cpu->vector = TESTENV_NO_EXIT;
+    m68k_set_reg(M68K_REG_SR, cpu->sr);
+    for (unsigned i = 0; i < 8; i++)
+    {
+        m68k_set_reg((m68k_register_t) (M68K_REG_D0 + i), cpu->d[i]);
+        m68k_set_reg((m68k_register_t) (M68K_REG_A0 + i), cpu->a[i]);
+    }
+    m68k_set_reg(M68K_REG_PC, pc);
+    // a stop request from another thread that came too late for the previous run
+    sExitImmediately = 0;
+    sStartInsns = m68k_GetInsnCount();
+    m68k_SetEventBudget(((maxInsns != 0) && (maxInsns < TESTENV_BUDGET)) ? (unsigned) maxInsns : TESTENV_BUDGET);
+    m68k_execute();
+    cpu->insns = m68k_GetInsnCount() - sStartInsns;
+
+    if (cpu->vector == TESTENV_NO_EXIT)
+    {
+        cpu->sr = (uint16_t) m68k_get_reg(nullptr, M68K_REG_SR);
+        cpu->pc = m68k_get_reg(nullptr, M68K_REG_PC);
+        for (unsigned i = 0; i < 8; i++)
+        {
+            cpu->d[i] = m68k_get_reg(nullptr, (m68k_register_t) (M68K_REG_D0 + i));
+            cpu->a[i] = m68k_get_reg(nullptr, (m68k_register_t) (M68K_REG_A0 + i));
+        }
+        return false;
+    }
+    return !sBadAccess;
+}
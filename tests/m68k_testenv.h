@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Environment for tests of the 68k emulator core
+*
+* Flat regular memory without video memory, a 68020 in supervisor mode, and
+* an exit routine that returns from m68k_execute(). The code under test jumps
+* to TESTENV_EXIT when done, all exception vectors lead there as well.
+*
+*/
+
+#ifndef _M68K_TESTENV_H
+#define _M68K_TESTENV_H
+
+#include <stdint.h>
+#include <initializer_list>
+
+#define TESTENV_MEMSIZE     0x100000    // 68k memory
+#define TESTENV_EXIT        0x400       // regular end of the code under test, "jmp TESTENV_EXIT.w"
+#define TESTENV_CODE        0x1000      // free for code and data up to TESTENV_STACK
+#define TESTENV_STACK       0xf0000     // initial supervisor stack pointer
+
+struct TestCpu
+{
+    uint32_t d[8];
+    uint32_t a[8];                      // a[7] is the supervisor stack pointer
+    uint16_t sr;                        // status register, at the exception for vector != 0
+    // results
+    uint16_t srRead;                    // status register as read by "move sr" at the regular exit
+    unsigned vector;                    // 0: regular exit, otherwise the exception vector number
+    uint32_t excPc;                     // program counter on the exception stack frame
+    uint32_t pc;                        // program counter, if stopped before reaching an exit
+    uint64_t insns;                     // number of instructions executed
+};
+
+#define TESTENV_NO_EXIT     0xffffffff  // vector, if stopped before reaching an exit
+
+extern uint8_t *testMem;                // host address of 68k address 0
+
+void testenvInit();
+uint32_t testenvCode(uint32_t addr, const uint16_t *words, unsigned n);
+uint32_t testenvCode(uint32_t addr, std::initializer_list<uint16_t> words);
+void testenvClearCpu(TestCpu *cpu);
+bool testenvRun(uint32_t pc, TestCpu *cpu, uint64_t maxInsns = 0);
+uint16_t testenvPeek16(uint32_t addr);
+uint32_t testenvPeek32(uint32_t addr);
+void testenvPoke16(uint32_t addr, uint16_t value);
+void testenvPoke32(uint32_t addr, uint32_t value);
+
+#endif
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2025 Andreas Kromke, andreas.kromke@gmail.com
+ *
+ * This program is free software; you can redistribute it or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+*
+* Test of the screen conversion kernels
+*
+* Each vector kernel that the host CPU supports must produce the same pixels,
+* colour indices and used colour masks as the scalar one, for random frames
+* and palettes. The widths include an odd number of 16 pixel groups, so that
+* the tail of the vector loops is covered.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "ScreenConv.h"
+
+#define TEST_LINES      37
+#define TEST_FRAMES     8
+#define TEST_GUARD      64          // bytes behind each buffer that must not be written
+
+static const unsigned bitsPerPixel[SCREENCONV_FORMATS] = { 1, 2, 4, 4, 8, 16, 8 };
+static const char *formatName[SCREENCONV_FORMATS] = { "mono", "ip2", "packed4", "ip4", "packed8", "rgb555", "index16" };
+static const unsigned widths[] = { 16, 320, 336, 640, 1008, SCREENCONV_WIDTH_MAX };
+
+
+/** **********************************************************************************************
+ *
+ * @brief Check if the host CPU can run the kernels of an instruction set
+ *
+ * @note Instruction sets that are not compiled in fall back to the scalar kernels.
+ *
+ ************************************************************************************************/
+static bool isaSupported(ScreenConvIsa isa)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (isa == SCREENCONV_SSE2)
+    {
+        return __builtin_cpu_supports("sse2");
+    }
+    if (isa == SCREENCONV_AVX2)
+    {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    (void) isa;
+    return true;
+}
+
+
+/** **********************************************************************************************
+ *
+ * @brief Compare one kernel with the scalar one
+ *
+ * @return number of failures
+ *
+ ************************************************************************************************/
+static unsigned testKernel(ScreenConvFormat format, ScreenConvIsa isa, unsigned width)
+{
+    unsigned failures = 0;
+    unsigned srcPitch = width * bitsPerPixel[format] / 8;
+    unsigned dstPitch = width * 4;
+    bool bIndex = CScreenConv::storesIndex(format);
+    ScreenConvFn ref = CScreenConv::get(format, SCREENCONV_SCALAR);
+    ScreenConvFn fn = CScreenConv::get(format, isa);
+
+    std::vector<uint8_t> src(srcPitch * TEST_LINES);
+    std::vector<uint32_t> palette(256);
+    std::vector<uint8_t> dstRef(dstPitch * TEST_LINES + TEST_GUARD, 0xa5);
+    std::vector<uint8_t> dst(dstRef.size(), 0xa5);
+    std::vector<uint8_t> indexRef(width * TEST_LINES + TEST_GUARD, 0xee);
+    std::vector<uint8_t> index(indexRef.size(), 0xee);
+    std::vector<uint16_t> usedRef(TEST_LINES);
+    std::vector<uint16_t> used(TEST_LINES);
+    std::vector<uint8_t> remap(dstRef.size(), 0xa5);
+
+    for (unsigned frame = 0; (frame < TEST_FRAMES) && (failures == 0); frame++)
+    {
+        for (uint8_t &b : src)
+        {
+            // the index buffer format only has 16 colours
+            b = (uint8_t) ((format == SCREENCONV_INDEX16) ? (rand() & 15) : rand());
+        }
+        for (uint32_t &c : palette)
+        {
+            c = (uint32_t) rand() ^ ((uint32_t) rand() << 16);
+        }
+
+        // every other frame without index buffer, the used masks must not depend on it
+        bool bWithIndex = bIndex && (frame & 1);
+        ref(src.data(), srcPitch, dstRef.data(), dstPitch, width, TEST_LINES, palette.data(),
+            bIndex ? indexRef.data() : nullptr, bIndex ? usedRef.data() : nullptr);
+        fn(src.data(), srcPitch, dst.data(), dstPitch, width, TEST_LINES, palette.data(),
+           bWithIndex ? index.data() : nullptr, bIndex ? used.data() : nullptr);
+
+        for (unsigned y = 0; y < TEST_LINES; y++)
+        {
+            if (memcmp(dstRef.data() + y * dstPitch, dst.data() + y * dstPitch, dstPitch))
+            {
+                printf("%s %s width %u frame %u: pixels differ in line %u\n",
+                        formatName[format], CScreenConv::isaName[isa], width, frame, y);
+                failures++;
+                break;
+            }
+        }
+        if (memcmp(dstRef.data() + dstPitch * TEST_LINES, dst.data() + dstPitch * TEST_LINES, TEST_GUARD))
+        {
+            printf("%s %s width %u: pixels written behind the buffer\n",
+                    formatName[format], CScreenConv::isaName[isa], width);
+            failures++;
+        }
+
+        if (bIndex)
+        {
+            if (usedRef != used)
+            {
+                printf("%s %s width %u frame %u: used colours differ\n",
+                        formatName[format], CScreenConv::isaName[isa], width, frame);
+                failures++;
+            }
+
+            if (bWithIndex)
+            {
+                if (indexRef != index)
+                {
+                    printf("%s %s width %u frame %u: colour indices differ\n",
+                            formatName[format], CScreenConv::isaName[isa], width, frame);
+                    failures++;
+                }
+
+                // redraw from the index buffer, as for a palette change
+                CScreenConv::get(SCREENCONV_INDEX16, isa)(index.data(), width, remap.data(), dstPitch,
+                                                          width, TEST_LINES, palette.data(), nullptr, nullptr);
+                if (memcmp(dstRef.data(), remap.data(), dstPitch * TEST_LINES))
+                {
+                    printf("%s %s width %u frame %u: remapped pixels differ\n",
+                            formatName[format], CScreenConv::isaName[isa], width, frame);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    return failures;
+}
+
+
+int main()
+{
+    unsigned failures = 0;
+    unsigned tests = 0;
+
+    srand(4711);
+    for (unsigned isa = SCREENCONV_SCALAR; isa < SCREENCONV_ISAS; isa++)
+    {
+        if (!isaSupported((ScreenConvIsa) isa))
+        {
+            printf("%s: not supported by the host CPU, skipped\n", CScreenConv::isaName[isa]);
+            continue;
+        }
+        for (unsigned format = 0; format < SCREENCONV_FORMATS; format++)
+        {
+            for (unsigned width : widths)
+            {
+                failures += testKernel((ScreenConvFormat) format, (ScreenConvIsa) isa, width);
+                tests++;
+            }
+        }
+    }
+
+    printf("%u kernels tested, %u failures, best instruction set %s\n",
+            tests, failures, CScreenConv::isaName[CScreenConv::bestIsa()]);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}